@@ -0,0 +1,343 @@
+/*
+ * ChapRReceiver.cpp
+ *
+ *   See ChapRReceiver.h.  Everything here mirrors Firmware/ChapR/RIO.cpp
+ *   (createPacket() and friends) - if that changes, this has to follow.
+ */
+
+#include <string.h>
+#include "ChapRReceiver.h"
+
+/* command byte bits (see RIO.h) */
+
+#define RRIO_AUTO_BIT	0x02
+#define RRIO_ENABLE_BIT	0x04
+#define CRIO_AUTO_BIT	0x10
+#define CRIO_ENABLE_BIT	0x20
+
+static unsigned char crc8(const unsigned char *data, int size)
+{
+  unsigned char crc = 0;
+
+  for (; size > 0; size--, data++){
+    crc ^= *data;
+    for (int i = 0; i < 8; i++){
+      crc = (crc & 0x80)? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+/* cobsDecode() - returns the decoded size, or -1 if it isn't valid COBS */
+
+static int cobsDecode(const unsigned char *src, int size, unsigned char *dst)
+{
+  int in = 0;
+  int out = 0;
+
+  while (in < size){
+    int code = src[in++];
+    if (code == 0 || in + code - 1 > size){
+      return -1;
+    }
+    for (int i = 1; i < code; i++){
+      dst[out++] = src[in++];
+    }
+    if (code < 0xff && in < size){
+      dst[out++] = 0;
+    }
+  }
+  return out;
+}
+
+/* tophat conversions - v1 sends degrees with 0xFFFF for "not pressed" */
+
+static void tophatFromDegrees(ChapRGamepad *g, int msb, int lsb)
+{
+  if (msb == 0xff && lsb == 0xff){
+    g->tophat = 0;
+    g->pov = -1;
+  } else {
+    g->pov = (msb << 8) | lsb;
+    g->tophat = g->pov / 45 + 1;
+  }
+}
+
+static void tophatFromIndex(ChapRGamepad *g, int tophat)
+{
+  g->tophat = tophat;
+  g->pov = (tophat == 0)? -1 : (tophat - 1) * 45;
+}
+
+/* the 11 bytes of a v1 joystick: TH_m, TH_l, type, x1, y1, B1, x2, y2, B2, x3, y3 */
+
+static void v1Joystick(ChapRGamepad *g, const unsigned char *raw)
+{
+  tophatFromDegrees(g, raw[0], raw[1]);
+  g->type = raw[2];
+  g->x1 = (signed char) raw[3];
+  g->y1 = (signed char) raw[4];
+  g->x2 = (signed char) raw[6];
+  g->y2 = (signed char) raw[7];
+  g->x3 = (signed char) raw[9];
+  g->y3 = (signed char) raw[10];
+  g->buttons = (raw[5] & 0x7f) | (raw[8] << 7);
+}
+
+/* the 9 bytes of a v2 joystick: type, x1, y1, x2, y2, x3, y3, B, BTH */
+
+static void v2Joystick(ChapRGamepad *g, const unsigned char *raw)
+{
+  g->type = raw[0];
+  g->x1 = (signed char) raw[1];
+  g->y1 = (signed char) raw[2];
+  g->x2 = (signed char) raw[3];
+  g->y2 = (signed char) raw[4];
+  g->x3 = (signed char) raw[5];
+  g->y3 = (signed char) raw[6];
+  g->buttons = raw[7] | ((raw[8] & 0x0f) << 8);
+  tophatFromIndex(g, raw[8] >> 4);
+}
+
+ChapRReceiver::ChapRReceiver(int target) : target(target)
+{
+  memset(&counters, 0, sizeof(counters));
+  reset();
+}
+
+/* reset() - forget any partial packet and the negotiation (stats stay) */
+
+void ChapRReceiver::reset()
+{
+  memset(&current, 0, sizeof(current));
+  v1State = 0;
+  v1Count = 0;
+  trailerCount = -1;
+  v2Count = 0;
+  v2Seen = 0;
+  haveSeq = 0;
+  goodCount = 0;
+}
+
+int ChapRReceiver::feed(const unsigned char *data, size_t size,
+			void (*handler)(const ChapRPacket *, void *), void *rock)
+{
+  int count = 0;
+
+  for (; size > 0; size--, data++){
+    if (feed(*data)){
+      count++;
+      if (handler){
+	(*handler)(&current, rock);
+      }
+    }
+  }
+  return count;
+}
+
+/*
+ * feed() - the v1 state machine and the v2 collector both see every byte.
+ *	    The ChapR only ever sends one format at a time, so there is no
+ *	    fight over which one "wins".
+ */
+int ChapRReceiver::feed(unsigned char c)
+{
+  counters.bytes++;
+
+  if (c == 0x00){
+    int good = v2Frame();
+    v2Count = 0;
+    if (good){
+      v1State = 0;		/* a v2 frame may have looked like v1 sync */
+      trailerCount = -1;
+      return 1;
+    }
+  } else if (v2Count < CHAPR_V2_MAX_ENCODED + 1){
+    if (v2Count < CHAPR_V2_MAX_ENCODED){
+      v2Buf[v2Count] = c;
+    }
+    v2Count++;
+  }
+
+  /* the probe trailer comes right after a good v1 packet, and never has
+     a byte with the high bit set */
+
+  if (trailerCount >= 0 && v1State == 0){
+    if (c & 0x80){
+      trailerCount = -1;
+    } else {
+      trailer[trailerCount++] = c;
+      if (trailerCount == CHAPR_TRAILER_SIZE){
+	trailerCount = -1;
+	if (((trailer[0] + trailer[1] + trailer[2]) & 0x7f) == trailer[3]){
+	  counters.trailers++;
+	  sawSeq(trailer[0], (trailer[1] << 7) | trailer[2]);
+	  v2Count = 0;		/* a v2 frame may be next (see below) */
+	}
+      }
+      return 0;
+    }
+  }
+
+  switch (v1State){
+  case 0:
+  case 1:
+  case 2:
+    v1State = (c == 0xff)? v1State + 1 : 0;
+    v1Count = 0;
+    break;
+
+  case 3:
+    v1Buf[v1Count++] = c;
+    if (v1Count == CHAPR_V1_DATA_SIZE){
+      v1State = 4;
+    }
+    break;
+
+  default:			/* the checksum */
+    v1State = 0;
+    if (v1Packet(c)){
+      trailerCount = 0;		/* a trailer may follow */
+      v2Count = 0;		/* the first v2 frame after a switch has no */
+      return 1;			/*  0x00 in front of it, so start fresh here */
+    }
+    break;
+  }
+  return 0;
+}
+
+/* v1Packet() - check the completed v1 packet against its checksum, and decode it */
+
+int ChapRReceiver::v1Packet(unsigned char checksum)
+{
+  unsigned char sum = 0;
+
+  for (int i = 0; i < CHAPR_V1_DATA_SIZE; i++){
+    sum += v1Buf[i];
+  }
+  if ((sum & 0x7f) != checksum){
+    if (!v2Seen){		/* v2 frames can look like v1 sync */
+      counters.badChecksum++;
+    }
+    return 0;
+  }
+
+  current.version = 1;
+  current.cmd = v1Buf[0];
+  v1Joystick(&current.joy[0], v1Buf + 1);
+  v1Joystick(&current.joy[1], v1Buf + 13);	/* byte 12 is the zero pad */
+  cmdDecode();
+
+  counters.packets++;
+  goodCount = (goodCount + 1) & 0x7f;
+  return 1;
+}
+
+/* v2Frame() - check and decode the COBS frame collected since the last 0x00 */
+
+int ChapRReceiver::v2Frame()
+{
+  unsigned char raw[CHAPR_V2_MAX_ENCODED];
+
+  if (v2Count == 0){
+    return 0;			/* back-to-back delimiters are harmless */
+  }
+  if (v2Count > CHAPR_V2_MAX_ENCODED ||
+      cobsDecode(v2Buf, v2Count, raw) != CHAPR_V2_SIZE ||
+      raw[0] != 2 ||
+      crc8(raw, CHAPR_V2_SIZE - 1) != raw[CHAPR_V2_SIZE - 1]){
+    if (v2Seen){
+      counters.badFrames++;
+    }
+    return 0;
+  }
+
+  v2Seen = 1;
+  current.version = 2;
+  current.cmd = raw[4];
+  v2Joystick(&current.joy[0], raw + 5);
+  v2Joystick(&current.joy[1], raw + 14);
+  cmdDecode();
+  sawSeq(raw[1], ((raw[2] << 8) | raw[3]) & 0x3fff);
+
+  counters.packets++;
+  goodCount = (goodCount + 1) & 0x7f;
+  return 1;
+}
+
+void ChapRReceiver::cmdDecode()
+{
+  if (target == CHAPR_TARGET_CRIO){
+    current.enabled = (current.cmd & CRIO_ENABLE_BIT) != 0;
+    current.autonomous = (current.cmd & CRIO_AUTO_BIT) != 0;
+  } else {
+    current.enabled = (current.cmd & RRIO_ENABLE_BIT) != 0;
+    current.autonomous = (current.cmd & RRIO_AUTO_BIT) != 0;
+  }
+}
+
+void ChapRReceiver::sawSeq(int seq, int stamp)
+{
+  haveSeq = 1;
+  lastSeq = seq;
+  lastStamp = stamp;
+}
+
+int ChapRReceiver::reply(unsigned char *out)
+{
+  int size = 0;
+
+  out[size++] = 0xff;
+  out[size++] = 0xff;
+  out[size++] = 0xff;
+  out[size++] = CHAPR_PROTO_VERSION;
+  out[size++] = haveSeq? lastSeq : CHAPR_NO_ECHO;
+  out[size++] = goodCount;
+  out[size++] = haveSeq? (lastStamp >> 7) & 0x7f : 0;
+  out[size++] = haveSeq? lastStamp & 0x7f : 0;
+  out[size] = (out[3] + out[4] + out[5] + out[6] + out[7]) & 0x7f;
+  size++;
+
+  return size;
+}
+
+/*
+ * The C interface.  The handle is really just the receiver.
+ */
+
+struct ChapRHandle {
+  ChapRReceiver receiver;
+  ChapRHandle(int target) : receiver(target) {}
+};
+
+ChapRHandle *chapr_receiver_new(int target)
+{
+  return new ChapRHandle(target);
+}
+
+void chapr_receiver_free(ChapRHandle *h)
+{
+  delete h;
+}
+
+int chapr_receiver_feed(ChapRHandle *h, const unsigned char *data, int size)
+{
+  return h->receiver.feed(data, (size < 0)? 0 : (size_t) size);
+}
+
+int chapr_receiver_packet(ChapRHandle *h, ChapRPacket *out)
+{
+  *out = h->receiver.packet();
+  return out->version != 0;	/* false until the first good packet */
+}
+
+int chapr_receiver_stats(ChapRHandle *h, ChapRStats *out)
+{
+  *out = h->receiver.stats();
+  return 1;
+}
+
+int chapr_receiver_reply(ChapRHandle *h, unsigned char *out)
+{
+  return h->receiver.reply(out);
+}
@@ -0,0 +1,145 @@
+/*
+ * ChapRReceiver.h
+ *
+ *   A stand-alone decoder for the packets the ChapR sends in its RIO
+ *   personality (see Firmware/ChapR/RIO.h for the authoritative layout).
+ *   It is meant to be dropped into a robot program (or anything else
+ *   reading the FirePlug) so that teams don't have to reverse-engineer
+ *   the packet format themselves.
+ *
+ *   Bytes are fed in as they arrive, in whatever chunks read() returns.
+ *   The decoder finds sync on its own, throws out anything that fails the
+ *   checksum/CRC, and hands back a decoded packet each time a good one
+ *   completes.  It understands:
+ *
+ *	v1  - three 0xFF's, 24 data bytes, 7-bit checksum
+ *	      (optionally followed by the probe trailer)
+ *	v2  - COBS encoded, CRC-8 protected, 0x00 delimited frames
+ *
+ *   It can also build the replies that tell the ChapR to move up to the
+ *   newer formats, and that echo the probe for the ChapR's link stats.
+ *
+ *   There is a plain C interface at the bottom, which is the easy thing
+ *   to bind to from Java (JNI/JNA) or LabView (Call Library Function).
+ */
+
+#ifndef CHAPRRECEIVER_H
+#define CHAPRRECEIVER_H
+
+#include <stddef.h>
+
+#define CHAPR_V1_DATA_SIZE	24	/* cmd + both joysticks + pad */
+#define CHAPR_TRAILER_SIZE	4	/* seq, stamp MSB, stamp LSB, checksum */
+#define CHAPR_V2_SIZE		24	/* v2 frame before COBS encoding */
+#define CHAPR_V2_MAX_ENCODED	32	/* longest run between 0x00's we'll believe */
+#define CHAPR_REPLY_SIZE	9	/* sync + version, seq, count, stamp, checksum */
+#define CHAPR_NO_ECHO		0x80	/* seq value in a "hello" reply */
+#define CHAPR_PROTO_VERSION	2	/* highest version this decoder knows */
+
+/* the command byte means different things to the two targets (see RIO.h) */
+
+#define CHAPR_TARGET_ROBORIO	0
+#define CHAPR_TARGET_CRIO	1
+
+typedef struct ChapRGamepad {
+  int		type;		/* index into the ChapR drivers table */
+  int		x1, y1;		/* -128 to 127 */
+  int		x2, y2;
+  int		x3, y3;
+  unsigned int	buttons;	/* B1 is bit 0 ... B12 is bit 11 */
+  int		tophat;		/* 0 not pressed, 1 to 8 for N, NE, E... clockwise */
+  int		pov;		/* tophat in degrees, -1 if not pressed */
+} ChapRGamepad;
+
+typedef struct ChapRPacket {
+  int		version;	/* 1 or 2 - the format this packet arrived in */
+  unsigned char	cmd;		/* the raw command byte */
+  int		enabled;
+  int		autonomous;
+  ChapRGamepad	joy[2];
+} ChapRPacket;
+
+typedef struct ChapRStats {
+  unsigned long	bytes;		/* everything that went through feed() */
+  unsigned long	packets;	/* good packets (either version) */
+  unsigned long	badChecksum;	/* v1 packets that failed the checksum */
+  unsigned long	badFrames;	/* bad v2 frames (once v2 has been seen) */
+  unsigned long	trailers;	/* good probe trailers */
+} ChapRStats;
+
+#ifdef __cplusplus
+
+class ChapRReceiver
+{
+ public:
+  ChapRReceiver(int target = CHAPR_TARGET_ROBORIO);
+
+  void reset();
+
+  /* feed() returns 1 when the byte completed a good packet, which can be
+     picked up with packet() until the next one completes */
+
+  int feed(unsigned char c);
+
+  /* feeds all of the bytes, calling handler (if given) for each good
+     packet along the way.  Returns the number of good packets. */
+
+  int feed(const unsigned char *data, size_t size,
+	   void (*handler)(const ChapRPacket *, void *) = NULL, void *rock = NULL);
+
+  const ChapRPacket &packet() const { return current; }
+  const ChapRStats &stats() const { return counters; }
+
+  /* builds the next reply for the ChapR into out (which must hold
+     CHAPR_REPLY_SIZE bytes), returning its size.  Until a seq has been
+     seen this is a "hello", afterwards it echoes the latest seq/stamp.
+     Send one every few packets - there's no need to answer each one. */
+
+  int reply(unsigned char *out);
+
+ private:
+  int  v1Packet(unsigned char checksum);
+  int  v2Frame();
+  void cmdDecode();
+  void sawSeq(int seq, int stamp);
+
+  int		target;
+  ChapRPacket	current;
+  ChapRStats	counters;
+
+  int		v1State;		/* sync bytes seen, 3 means collecting data */
+  int		v1Count;
+  unsigned char	v1Buf[CHAPR_V1_DATA_SIZE];
+  int		trailerCount;		/* -1 when no trailer is expected */
+  unsigned char	trailer[CHAPR_TRAILER_SIZE];
+
+  int		v2Count;
+  unsigned char	v2Buf[CHAPR_V2_MAX_ENCODED];
+  int		v2Seen;			/* v1 packets are full of 0x00's, so */
+					/*  only count bad frames after this */
+
+  int		haveSeq;
+  int		lastSeq;
+  int		lastStamp;
+  unsigned char	goodCount;		/* rolling 7 bit count for replies */
+};
+
+extern "C" {
+#endif /* __cplusplus */
+
+/* the C interface - a ChapRReceiver behind an opaque pointer */
+
+typedef struct ChapRHandle ChapRHandle;
+
+ChapRHandle *chapr_receiver_new(int target);
+void chapr_receiver_free(ChapRHandle *);
+int  chapr_receiver_feed(ChapRHandle *, const unsigned char *data, int size);
+int  chapr_receiver_packet(ChapRHandle *, ChapRPacket *out);
+int  chapr_receiver_stats(ChapRHandle *, ChapRStats *out);
+int  chapr_receiver_reply(ChapRHandle *, unsigned char *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHAPRRECEIVER_H */
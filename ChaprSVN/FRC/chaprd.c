@@ -19,6 +19,14 @@
 #define CHAPR_DATA_SIZE 24
 #define WATCHDOG_TIMEOUT 3 // in seconds
 
+#define CHAPR_PROTO_VERSION 2 // highest ChapR protocol we know (1 = probe trailer, 2 = v2 frames)
+#define CHAPR_TRAILER_SIZE 4  // seq, stamp MSB, stamp LSB, checksum (see RIO.h)
+#define CHAPR_NO_ECHO 0x80    // seq value in a reply that just says "hello"
+#define REPLY_INTERVAL 10     // good packets between replies to the ChapR
+
+#define CHAPR_V2_SIZE 24      // decoded size of a v2 frame (see RIO.h)
+#define CHAPR_V2_MAX_ENCODED 32 // anything longer than this between 0x00's isn't a v2 frame
+
 typedef struct chapRPacket{
 int cmd;
 int joy1_TH_m; // MSB
@@ -48,6 +56,8 @@ int joy1_TH_m; // MSB
 
 int watchDogByte = 0;
 
+unsigned char goodPackets = 0; // rolling (7 bit) count of good packets, reported in replies
+
 // TODO - kill signal, logging
 
 void signalHandler(int signal)
@@ -88,6 +98,136 @@ int timeval_subtract(struct timeval *result, struct timeval *t2, struct timeval
   return (diff<0);
 }
 
+/*
+sendChapRReply() - sends a reply back to the ChapR over the FirePlug. The reply
+                   echoes the seq/stamp of a probe trailer so the ChapR can work
+                   out round-trip time and loss. A seq of CHAPR_NO_ECHO is just
+                   a "hello" that tells the ChapR we understand the trailer.
+*/
+void sendChapRReply(int fd, unsigned char seq, unsigned char stamp_m, unsigned char stamp_l)
+{
+  unsigned char reply[9];
+  int size = 0;
+
+  reply[size++] = 0xff;
+  reply[size++] = 0xff;
+  reply[size++] = 0xff;
+  reply[size++] = CHAPR_PROTO_VERSION;
+  reply[size++] = seq;
+  reply[size++] = goodPackets;
+  reply[size++] = stamp_m;
+  reply[size++] = stamp_l;
+  reply[size] = (reply[3] + reply[4] + reply[5] + reply[6] + reply[7]) & 0x7f;
+  size++;
+
+  if (write(fd, (void *) reply, size) != size){
+    debug_int("reply write errno: ", errno);
+  }
+}
+
+/*
+crc8() - the same CRC-8 (polynomial 0x07) the ChapR puts on v2 frames
+*/
+unsigned char crc8(unsigned char *data, int size)
+{
+  unsigned char crc = 0;
+  int i;
+
+  for (; size > 0; size--, data++){
+    crc ^= *data;
+    for (i = 0; i < 8; i++){
+      crc = (crc & 0x80)? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+/*
+cobsDecode() - undo the COBS encoding of a v2 frame (without its 0x00 delimiter).
+               Returns the decoded size, or -1 if the data isn't valid COBS.
+*/
+int cobsDecode(unsigned char *src, int size, unsigned char *dst)
+{
+  int in = 0;
+  int out = 0;
+  int i;
+
+  while (in < size){
+    int code = src[in++];
+    if (code == 0 || in + code - 1 > size){
+      return -1;
+    }
+    for (i = 1; i < code; i++){
+      dst[out++] = src[in++];
+    }
+    if (code < 0xff && in < size){
+      dst[out++] = 0;
+    }
+  }
+  return out;
+}
+
+/*
+decodeV2Joystick() - fills in one joystick of the (v1 shaped) ChapR packet from the
+                     nine bytes of a v2 frame, so the rest of chaprd doesn't care
+                     which version came in
+*/
+void decodeV2Joystick(unsigned char *raw, int *type, int *x1, int *y1, int *x2, int *y2,
+		      int *x3, int *y3, int *B1, int *B2, int *TH_m, int *TH_l)
+{
+  int buttons = raw[7] | ((raw[8] & 0x0f) << 8);
+  int tophat = raw[8] >> 4;
+
+  *type = (int) raw[0];
+  *x1 = (int) raw[1];
+  *y1 = (int) raw[2];
+  *x2 = (int) raw[3];
+  *y2 = (int) raw[4];
+  *x3 = (int) raw[5];
+  *y3 = (int) raw[6];
+  *B1 = buttons & 0x7f;
+  *B2 = (buttons >> 7) & 0xff;
+  if (tophat == 0){ // same special case as RIO_xlateTH()
+    *TH_m = 0xff;
+    *TH_l = 0xff;
+  } else {
+    *TH_m = ((tophat - 1) * 45) >> 8;
+    *TH_l = ((tophat - 1) * 45) & 0xff;
+  }
+}
+
+/*
+decodeV2Packet() - checks and decodes a COBS encoded v2 frame into the ChapR packet.
+                   Returns 1 if it was good, 0 otherwise.  The seq/stamp are handed
+                   back so they can be echoed.
+*/
+int decodeV2Packet(unsigned char *encoded, int size, chapRPacket *cp, unsigned char *seq,
+		   unsigned char *stamp_m, unsigned char *stamp_l)
+{
+  unsigned char raw[CHAPR_V2_MAX_ENCODED];
+  unsigned int stamp;
+
+  if (cobsDecode(encoded, size, raw) != CHAPR_V2_SIZE){
+    return 0;
+  }
+  if (raw[0] != 2 || crc8(raw, CHAPR_V2_SIZE - 1) != raw[CHAPR_V2_SIZE - 1]){
+    return 0;
+  }
+
+  // the stamp is echoed back in the 7+7 bit form of the v1 reply
+  stamp = (raw[2] << 8) | raw[3];
+  *seq = raw[1];
+  *stamp_m = (stamp >> 7) & 0x7f;
+  *stamp_l = stamp & 0x7f;
+
+  cp->cmd = (int) raw[4];
+  decodeV2Joystick(raw + 5, &cp->joy1_type, &cp->joy1_x1, &cp->joy1_y1, &cp->joy1_x2, &cp->joy1_y2,
+		   &cp->joy1_x3, &cp->joy1_y3, &cp->joy1_B1, &cp->joy1_B2, &cp->joy1_TH_m, &cp->joy1_TH_l);
+  decodeV2Joystick(raw + 14, &cp->joy2_type, &cp->joy2_x1, &cp->joy2_y1, &cp->joy2_x2, &cp->joy2_y2,
+		   &cp->joy2_x3, &cp->joy2_y3, &cp->joy2_B1, &cp->joy2_B2, &cp->joy2_TH_m, &cp->joy2_TH_l);
+  return 1;
+}
+
 /*
 readChapRPacket() - formats data from the USB into a ChapR packet
                     (waits until it finds one if USB present)
@@ -101,6 +241,19 @@ chapRPacket *readChapRPacket(int fd)
   unsigned char checkSum = 0;
   int count = 0;
 
+  // the probe trailer (if any) shows up right after the packet that was
+  // returned last time, so its state has to live across calls
+  static int trailerWanted = 0;
+  static int trailerCount = 0;
+  static unsigned char trailer[CHAPR_TRAILER_SIZE];
+  static int sawTrailer = 0;
+  static int sinceReply = 0;
+
+  // v2 frames are collected in parallel with the v1 state machine - whichever
+  // one finds a good packet first wins
+  static unsigned char v2buf[CHAPR_V2_MAX_ENCODED];
+  static int v2count = 0;
+
   static struct timespec sleepTime;
   sleepTime.tv_sec = 0;
   sleepTime.tv_nsec = 200000L; // operate at 5K BAUD (a little slower, because of processing time)
@@ -131,6 +284,48 @@ chapRPacket *readChapRPacket(int fd)
       sleep(2);
       execv("/proc/self/exe", args);
     } else if (rval > 0){
+      if (rawData != 0x00){
+	if (v2count < CHAPR_V2_MAX_ENCODED){
+	  v2buf[v2count] = rawData;
+	}
+	v2count++;
+      } else {
+	unsigned char seq, stamp_m, stamp_l;
+	int good = (v2count <= CHAPR_V2_MAX_ENCODED &&
+		    decodeV2Packet(v2buf, v2count, &cp, &seq, &stamp_m, &stamp_l));
+	v2count = 0;
+	if (good){
+	  goodPackets = (goodPackets + 1) & 0x7f;
+	  trailerWanted = 0;
+	  sawTrailer = 1;
+	  if (++sinceReply >= REPLY_INTERVAL){
+	    sendChapRReply(fd, seq, stamp_m, stamp_l);
+	    sinceReply = 0;
+	  }
+	  return &cp;
+	}
+      }
+      if (state == 0 && trailerWanted){
+	if (rawData == 0xff){ // no trailer - this is the next packet's sync
+	  trailerWanted = 0;
+	  sawTrailer = 0;
+	} else {
+	  trailer[trailerCount++] = rawData;
+	  if (trailerCount == CHAPR_TRAILER_SIZE){
+	    trailerWanted = 0;
+	    if (((trailer[0] + trailer[1] + trailer[2]) & 0x7f) == trailer[3]){
+	      sawTrailer = 1;
+	      v2count = 0; // the first v2 frame after a switch has no 0x00 in front of it
+	      if (++sinceReply >= REPLY_INTERVAL){
+		sendChapRReply(fd, trailer[0], trailer[1], trailer[2]);
+		sinceReply = 0;
+	      }
+	    }
+	  }
+	  nanosleep(&sleepTime, &timeLeft);
+	  continue;
+	}
+      }
       switch (state){
       case 0:
       case 1:
@@ -180,6 +375,17 @@ chapRPacket *readChapRPacket(int fd)
 	  cp.joy2_x3    = (int) buf[22];
 	  cp.joy2_y3    = (int) buf[23];
 	  // zero
+
+	  goodPackets = (goodPackets + 1) & 0x7f;
+	  trailerWanted = 1;
+	  trailerCount = 0;
+	  v2count = 0;
+
+	  // until the ChapR starts sending trailers, keep saying hello so it knows it can
+	  if (!sawTrailer && ++sinceReply >= REPLY_INTERVAL){
+	    sendChapRReply(fd, CHAPR_NO_ECHO, 0, 0);
+	    sinceReply = 0;
+	  }
 	  return &cp;
 	} else {
 	  debug_string("g", "");
@@ -538,7 +744,7 @@ int TCP_init(struct hostent *hp)
 }
 
 
-/* openUSBPort() - opens the appropriate USB port (the one with the FirePlug). Returns an open file descriptor (read-only) for the USB port. Blocks while waiting for an appropriate USB port.
+/* openUSBPort() - opens the appropriate USB port (the one with the FirePlug). Returns an open file descriptor (read-write, replies go back to the ChapR) for the USB port. Blocks while waiting for an appropriate USB port.
 */
 int openUSBPort(){
   struct stat buf;
@@ -556,7 +762,7 @@ int openUSBPort(){
       // TODO - check if it has FirePlug connected
       if (stat(ports[i], &buf) == 0){
 	syslog(LOG_INFO, "opened port: %s",ports[i]);
-	fd = open(ports[i], O_RDONLY, O_NOCTTY);				
+	fd = open(ports[i], O_RDWR, O_NOCTTY);				
 	debug_int("open USB errno: ", errno);
 	debug_int("stat: ", buf.st_dev);
 	tcsetattr(fd, TCSANOW, &t);
@@ -0,0 +1,138 @@
+/*
+ * chaprmon.cpp
+ *
+ *   Watches the ChapR packets coming in on a serial port (the FirePlug,
+ *   or anything else that looks like a tty - a pty works fine too) using
+ *   the ChapRReceiver library, and prints what it decodes along with the
+ *   byte/packet rates and error counts once a second.
+ *
+ *	usage: chaprmon [-v] [-r] [device]
+ *
+ *	  -v  print every packet, not just the once-a-second summary
+ *	  -r  send replies, so the ChapR moves up to the newest protocol
+ *	      (don't do this while chaprd is running - it replies too)
+ *
+ *   The device defaults to /dev/ttyUSB0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <termios.h>
+#include <sys/time.h>
+#include "ChapRReceiver.h"
+
+#define REPLY_INTERVAL 10	// good packets between replies (same as chaprd)
+
+static void printPacket(const ChapRPacket *cp, void *rock)
+{
+  (void) rock;
+
+  printf("v%d cmd %02x %s %s", cp->version, cp->cmd,
+	 cp->enabled? "enabled " : "disabled",
+	 cp->autonomous? "auto" : "tele");
+  for (int i = 0; i < 2; i++){
+    const ChapRGamepad *g = &cp->joy[i];
+    printf(" | t%d %4d %4d %4d %4d %4d %4d b%03x pov %d",
+	   g->type, g->x1, g->y1, g->x2, g->y2, g->x3, g->y3, g->buttons, g->pov);
+  }
+  printf("\n");
+}
+
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+  const char *device = "/dev/ttyUSB0";
+  int verbose = 0;
+  int replies = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "vr")) != -1){
+    switch (opt){
+    case 'v': verbose = 1; break;
+    case 'r': replies = 1; break;
+    default:
+      fprintf(stderr, "usage: %s [-v] [-r] [device]\n", argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (optind < argc){
+    device = argv[optind];
+  }
+
+  int fd = open(device, (replies? O_RDWR : O_RDONLY) | O_NOCTTY);
+  if (fd < 0){
+    perror(device);
+    exit(EXIT_FAILURE);
+  }
+
+  // the same settings chaprd uses - errors are expected on a pipe or file
+  struct termios t;
+  memset(&t, 0, sizeof(t));
+  t.c_iflag = IGNBRK | IGNPAR;
+  t.c_cflag = CS8 | CREAD | CLOCAL | B38400;
+  t.c_cc[VMIN] = 1;
+  tcsetattr(fd, TCSANOW, &t);
+
+  ChapRReceiver receiver;
+  ChapRStats last;
+  memset(&last, 0, sizeof(last));
+  double lastReport = now();
+  int sinceReply = 0;
+
+  while (1){
+    unsigned char buf[256];
+    int rval = read(fd, buf, sizeof(buf));
+
+    if (rval < 0){
+      if (errno == EINTR){
+	continue;
+      }
+      perror("read");
+      break;
+    }
+    if (rval == 0){
+      break;			// end of file (or the pty closed)
+    }
+
+    int count = receiver.feed(buf, rval, verbose? printPacket : NULL, NULL);
+
+    if (replies && count > 0 && (sinceReply += count) >= REPLY_INTERVAL){
+      unsigned char reply[CHAPR_REPLY_SIZE];
+      int size = receiver.reply(reply);
+      if (write(fd, reply, size) != size){
+	perror("write");
+      }
+      sinceReply = 0;
+    }
+
+    double t = now();
+    if (t - lastReport >= 1.0){
+      const ChapRStats &s = receiver.stats();
+      double span = t - lastReport;
+
+      printf("%.0f bytes/s %.1f packets/s (v%d) bad checksum %lu bad frames %lu trailers %lu\n",
+	     (s.bytes - last.bytes) / span, (s.packets - last.packets) / span,
+	     receiver.packet().version, s.badChecksum, s.badFrames, s.trailers);
+      fflush(stdout);
+      last = s;
+      lastReport = t;
+    }
+  }
+
+  const ChapRStats &s = receiver.stats();
+  printf("total: %lu bytes %lu packets, bad checksum %lu, bad frames %lu\n",
+	 s.bytes, s.packets, s.badChecksum, s.badFrames);
+
+  close(fd);
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,524 @@
+/*
+ * test_receiver.cpp
+ *
+ *   Tests for the ChapRReceiver library, run on the Linux host ("make test").
+ *   Everything goes through a pty, the same way the FirePlug bytes come in,
+ *   so the decoder sees the chunking that read() really hands it.
+ *
+ *	golden	- frames built by Firmware/ChapR/RIO.cpp createPacket() (v1,
+ *		  v1 with the probe trailer, and v2) must decode to the gamepads
+ *		  they were built from, in one chunk or a byte at a time
+ *	switch	- v1, then trailers, then v2 in one stream (the negotiation)
+ *	fuzz	- streams with flipped, dropped and extra bytes must never
+ *		  decode to anything that wasn't sent (v2), and must resync
+ *		  right after the damage (v1 and v2)
+ *	bench	- decode rate in bytes/sec, in memory and through the pty
+ *
+ *   Exits non-zero if anything fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <termios.h>
+#include <pty.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "ChapRReceiver.h"
+
+#define FUZZ_FRAMES	20000
+
+/*
+ * Golden frames.  These are the bytes RIO::createPacket() puts out (RIO.cpp
+ * compiled on the host with millis() stuck at 0x2345) for the gamepads in
+ * padsA/B/C below.  If createPacket() changes, make new ones the same way.
+ */
+
+/* pads A: neutral, disabled teleop, roboRIO */
+static const unsigned char v1A[] = {
+  0xff,0xff,0xff,0x00,0xff,0xff,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0xff,0xff,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7c };
+
+/* pads B: full deflection, all buttons, tophat NE and W, enabled auto, roboRIO */
+static const unsigned char v1B[] = {
+  0xff,0xff,0xff,0x06,0x00,0x2d,0x01,0x80,0x7f,0x7f,0xff,0x01,0x1f,0xff,
+  0xff,0x00,0x01,0x0e,0x03,0x7f,0x80,0x55,0xff,0xff,0x14,0x40,0xc0,0x47 };
+
+/* pads C: enabled teleop, cRIO */
+static const unsigned char v1C[] = {
+  0xff,0xff,0xff,0x60,0x00,0x00,0x02,0x0a,0xec,0x01,0x1e,0xd8,0x01,0x00,
+  0x00,0x00,0x01,0x3b,0x00,0xff,0xff,0x00,0xff,0xff,0x10,0xff,0xff,0x16 };
+
+/* pads B with the probe trailer, seq 5 */
+static const unsigned char v1T[] = {
+  0xff,0xff,0xff,0x06,0x00,0x2d,0x01,0x80,0x7f,0x7f,0xff,0x01,0x1f,0xff,
+  0xff,0x00,0x01,0x0e,0x03,0x7f,0x80,0x55,0xff,0xff,0x14,0x40,0xc0,0x47,
+  0x05,0x46,0x45,0x10 };
+
+/* v2 frames, seq 9, 10 and 11 */
+static const unsigned char v2B[] = {
+  0x19,0x02,0x09,0x23,0x45,0x06,0x01,0x80,0x7f,0xff,0x01,0xff,0xff,
+  0xff,0x2f,0x03,0x7f,0x80,0xff,0xff,0x40,0xc0,0x55,0x7a,0x33,0x00 };
+static const unsigned char v2A[] = {
+  0x05,0x02,0x0a,0x23,0x45,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+  0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x02,0x61,0x00 };
+static const unsigned char v2C[] = {
+  0x0b,0x02,0x0b,0x23,0x45,0x60,0x02,0x0a,0xec,0x1e,0xd8,0x01,0x03,
+  0x81,0x10,0x07,0xff,0xff,0xff,0xff,0xff,0xff,0x03,0x88,0x2f,0x00 };
+
+/* what the frames were built from - type, x1, y1, x2, y2, x3, y3, buttons, tophat */
+
+static const ChapRGamepad padsA[2] = {
+  { 0,    0,    0,  0,   0,  0,   0, 0x000, 0, -1 },
+  { 0,    0,    0,  0,   0,  0,   0, 0x000, 0, -1 } };
+static const ChapRGamepad padsB[2] = {
+  { 1, -128,  127, -1,   1, -1,  -1, 0xfff, 2, 45 },
+  { 3,  127, -128, -1,  -1, 64, -64, 0xa55, 7, 270 } };
+static const ChapRGamepad padsC[2] = {
+  { 2,   10,  -20, 30, -40,  0,   0, 0x081, 1, 0 },
+  { 0,   -1,   -1, -1,  -1, -1,  -1, 0x800, 8, 315 } };
+
+typedef struct Golden {
+  const char		*name;
+  const unsigned char	*bytes;
+  int			size;
+  int			version;
+  unsigned char		cmd;
+  const ChapRGamepad	*pads;
+} Golden;
+
+#define GOLDEN(n, v, cmd, pads)	{ #n, n, sizeof(n), v, cmd, pads }
+
+static const Golden golden[] = {
+  GOLDEN(v1A, 1, 0x00, padsA),
+  GOLDEN(v1B, 1, 0x06, padsB),
+  GOLDEN(v1C, 1, 0x60, padsC),
+  GOLDEN(v1T, 1, 0x06, padsB),
+  GOLDEN(v2B, 2, 0x06, padsB),
+  GOLDEN(v2A, 2, 0x00, padsA),
+  GOLDEN(v2C, 2, 0x60, padsC),
+};
+
+#define GOLDEN_COUNT	(int) (sizeof(golden) / sizeof(golden[0]))
+#define V1_FIRST	0		/* golden[0..3] are v1, without/with trailer */
+#define V1_COUNT	4
+#define V2_FIRST	4
+#define V2_COUNT	3
+
+static int failures = 0;
+
+#define CHECK(cond, ...)						\
+  do {									\
+    if (!(cond)){							\
+      printf("  FAIL %s:%d: ", __FILE__, __LINE__);			\
+      printf(__VA_ARGS__);						\
+      printf("\n");							\
+      failures++;							\
+    }									\
+  } while (0)
+
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/*
+ * The pty - bytes written to master come out of slave, which is set up raw
+ * like chaprd sets up the FirePlug.
+ */
+
+static int ptyMaster, ptySlave;
+
+static void ptyOpen()
+{
+  struct termios t;
+
+  if (openpty(&ptyMaster, &ptySlave, NULL, NULL, NULL) < 0){
+    perror("openpty");
+    exit(EXIT_FAILURE);
+  }
+  tcgetattr(ptySlave, &t);
+  cfmakeraw(&t);
+  t.c_cc[VMIN] = 0;
+  t.c_cc[VTIME] = 0;
+  tcsetattr(ptySlave, TCSANOW, &t);
+}
+
+static void ptyWrite(const unsigned char *data, int size)
+{
+  while (size > 0){
+    int n = write(ptyMaster, data, size);
+    if (n < 0){
+      perror("write");
+      exit(EXIT_FAILURE);
+    }
+    data += n;
+    size -= n;
+  }
+}
+
+/* ptyDrain() - read what has come through, in chunks of at most chunk bytes,
+		into the receiver.  Returns the number of good packets. */
+
+static int ptyDrain(ChapRReceiver *rx, int chunk,
+		    void (*handler)(const ChapRPacket *, void *) = NULL, void *rock = NULL)
+{
+  unsigned char buf[4096];
+  int packets = 0;
+  int idle = 0;
+
+  if (chunk > (int) sizeof(buf)){
+    chunk = sizeof(buf);
+  }
+  while (idle < 20){		/* nothing for 20ms - the writer is done */
+    int n = read(ptySlave, buf, chunk);
+    if (n > 0){
+      packets += rx->feed(buf, n, handler, rock);
+      idle = 0;
+    } else {
+      usleep(1000);
+      idle++;
+    }
+  }
+  return packets;
+}
+
+static int sameGamepad(const ChapRGamepad *a, const ChapRGamepad *b)
+{
+  return (a->type == b->type && a->x1 == b->x1 && a->y1 == b->y1 &&
+	  a->x2 == b->x2 && a->y2 == b->y2 && a->x3 == b->x3 && a->y3 == b->y3 &&
+	  a->buttons == b->buttons && a->tophat == b->tophat && a->pov == b->pov);
+}
+
+static int matchesGolden(const ChapRPacket *p, const Golden *g)
+{
+  return (p->version == g->version && p->cmd == g->cmd &&
+	  sameGamepad(&p->joy[0], &g->pads[0]) && sameGamepad(&p->joy[1], &g->pads[1]));
+}
+
+/* collects the good packets from a feed */
+
+#define MAX_SEEN	(FUZZ_FRAMES * 2)
+
+typedef struct Seen {
+  int		count;
+  int		max;		/* room in packets - the rest are only counted */
+  ChapRPacket	*packets;
+} Seen;
+
+static void collect(const ChapRPacket *p, void *rock)
+{
+  Seen *seen = (Seen *) rock;
+
+  if (seen->count < seen->max){
+    seen->packets[seen->count] = *p;
+  }
+  seen->count++;
+}
+
+static int whichGolden(const ChapRPacket *p)
+{
+  for (int i = 0; i < GOLDEN_COUNT; i++){
+    if (matchesGolden(p, &golden[i])){
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*
+ * golden - each frame on its own, in one chunk and a byte at a time.
+ */
+
+static void testGolden()
+{
+  printf("golden frames\n");
+
+  for (int chunk = 1; chunk <= 4096; chunk *= 64){
+    for (int i = 0; i < GOLDEN_COUNT; i++){
+      const Golden *g = &golden[i];
+      ChapRReceiver rx(g->cmd == 0x60? CHAPR_TARGET_CRIO : CHAPR_TARGET_ROBORIO);
+
+      ptyWrite(g->bytes, g->size);
+      int packets = ptyDrain(&rx, chunk);
+
+      CHECK(packets == 1, "%s (chunk %d): %d packets", g->name, chunk, packets);
+      CHECK(matchesGolden(&rx.packet(), g), "%s (chunk %d): decoded wrong", g->name, chunk);
+      CHECK(rx.stats().badChecksum == 0 && rx.stats().badFrames == 0,
+	    "%s (chunk %d): errors counted", g->name, chunk);
+    }
+  }
+
+  /* the command bits, for each target */
+
+  ChapRReceiver rrio(CHAPR_TARGET_ROBORIO);
+  rrio.feed(v1B, sizeof(v1B));
+  CHECK(rrio.packet().enabled && rrio.packet().autonomous, "v1B: not enabled auto");
+  rrio.feed(v2A, sizeof(v2A));
+  CHECK(!rrio.packet().enabled && !rrio.packet().autonomous, "v2A: not disabled teleop");
+
+  ChapRReceiver crio(CHAPR_TARGET_CRIO);
+  crio.feed(v2C, sizeof(v2C));
+  CHECK(crio.packet().enabled && !crio.packet().autonomous, "v2C: not enabled teleop");
+
+  /* the probe trailer is echoed in the replies, v2 seq/stamp too */
+
+  unsigned char reply[CHAPR_REPLY_SIZE];
+  ChapRReceiver probe;
+
+  probe.reply(reply);
+  CHECK(reply[4] == CHAPR_NO_ECHO, "hello reply has seq %02x", reply[4]);
+  probe.feed(v1T, sizeof(v1T));
+  probe.reply(reply);
+  CHECK(probe.stats().trailers == 1, "trailer not seen");
+  CHECK(reply[3] == CHAPR_PROTO_VERSION && reply[4] == 5 &&
+	reply[6] == 0x46 && reply[7] == 0x45, "trailer echo %02x %02x %02x", reply[4], reply[6], reply[7]);
+  probe.feed(v2C, sizeof(v2C));
+  probe.reply(reply);
+  CHECK(reply[4] == 11 && ((reply[6] << 7) | reply[7]) == 0x2345,
+	"v2 echo %02x %02x %02x", reply[4], reply[6], reply[7]);
+}
+
+/*
+ * switch - the ChapR starts in v1, adds the trailer once it hears a hello,
+ *	    then moves to v2 once it hears a v2 reply.  Nothing may be lost at
+ *	    either step, including the first v2 frame (which has no 0x00 in
+ *	    front of it).
+ */
+
+static void testSwitch()
+{
+  static const Golden *order[] = {
+    &golden[0], &golden[1], &golden[3], &golden[3], &golden[4], &golden[5], &golden[6], &golden[5]
+  };
+  const int count = sizeof(order) / sizeof(order[0]);
+  ChapRPacket packets[count + 1];
+  Seen seen = { 0, count + 1, packets };
+
+  printf("v1 -> trailer -> v2\n");
+
+  for (int chunk = 1; chunk <= 4096; chunk *= 64){
+    ChapRReceiver rx;
+
+    seen.count = 0;
+    for (int i = 0; i < count; i++){
+      ptyWrite(order[i]->bytes, order[i]->size);
+    }
+    ptyDrain(&rx, chunk, collect, &seen);
+
+    CHECK(seen.count == count, "chunk %d: %d of %d packets", chunk, seen.count, count);
+    for (int i = 0; i < count && i < seen.count; i++){
+      CHECK(matchesGolden(&packets[i], order[i]), "chunk %d: packet %d is wrong", chunk, i);
+    }
+  }
+}
+
+/*
+ * fuzz - a long stream of golden frames (v1 or v2), with some of them
+ *	  damaged.  A damaged frame may take the frame after it down too (the
+ *	  sync or delimiter can be eaten), but every clean frame after that
+ *	  has to come through.  v2 must never let a damaged frame through - a
+ *	  single bit error always changes the CRC-8.  The v1 checksum can't
+ *	  see a flipped top bit, so v1 packets that don't match what was sent
+ *	  are only counted.
+ */
+
+static unsigned long fuzzRandom = 1;
+
+static unsigned long fuzzNext()
+{
+  fuzzRandom = fuzzRandom * 1103515245 + 12345;
+  return (fuzzRandom >> 16) & 0x7fff;
+}
+
+static void fuzz(int first, int count, int version)
+{
+  static unsigned char stream[FUZZ_FRAMES * 40];
+  static ChapRPacket packets[MAX_SEEN];
+  Seen seen = { 0, MAX_SEEN, packets };
+  int size = 0;
+  int expected = 0;
+  int damaged = 0;
+  int lastDamaged = 0;
+
+  for (int i = 0; i < FUZZ_FRAMES; i++){
+    const Golden *g = &golden[first + fuzzNext() % count];
+    int at = size;
+
+    memcpy(stream + size, g->bytes, g->size);
+    size += g->size;
+
+    if (fuzzNext() % 10 == 0){			/* damage one frame in ten */
+      int where = at + fuzzNext() % g->size;
+
+      switch (fuzzNext() % 3){
+      case 0:					/* flip a bit */
+	stream[where] ^= 1 << (fuzzNext() % 8);
+	break;
+      case 1:					/* drop a byte */
+	memmove(stream + where, stream + where + 1, size - where - 1);
+	size--;
+	break;
+      case 2:					/* an extra byte */
+	memmove(stream + where + 1, stream + where, size - where);
+	stream[where] = fuzzNext() & 0xff;
+	size++;
+	break;
+      }
+      damaged++;
+      lastDamaged = 1;
+    } else {
+      if (!lastDamaged){
+	expected++;
+      }
+      lastDamaged = 0;
+    }
+  }
+
+  /* the stream goes through the pty from a child, so the pty never fills */
+
+  ChapRReceiver rx;
+  pid_t child = fork();
+
+  if (child == 0){
+    ptyWrite(stream, size);
+    _exit(0);
+  }
+  ptyDrain(&rx, 4096, collect, &seen);
+  waitpid(child, NULL, 0);
+
+  int good = 0;
+  int wrong = 0;
+
+  for (int i = 0; i < seen.count && i < MAX_SEEN; i++){
+    if (whichGolden(&packets[i]) >= 0){
+      good++;
+    } else {
+      wrong++;
+    }
+  }
+
+  printf("  v%d: %d frames, %d damaged, %d clean decoded (%d needed), %d wrong, "
+	 "%lu bad checksums, %lu bad frames\n",
+	 version, FUZZ_FRAMES, damaged, good, expected, wrong,
+	 rx.stats().badChecksum, rx.stats().badFrames);
+
+  CHECK(good >= expected, "v%d: only %d of %d clean frames decoded", version, good, expected);
+  if (version == 2){
+    CHECK(wrong == 0, "v2: %d damaged frames got through", wrong);
+  }
+}
+
+static void garbage()
+{
+  static unsigned char stream[1 << 20];
+  ChapRReceiver rx;
+
+  for (int i = 0; i < (int) sizeof(stream); i++){
+    stream[i] = fuzzNext() & 0xff;
+  }
+  int packets = rx.feed(stream, sizeof(stream));
+
+  /* a v1 false sync gets through 1 time in 128, so a few is fine */
+
+  printf("  1MB of noise: %d packets\n", packets);
+  CHECK(packets < 100, "%d packets out of noise", packets);
+
+  /* and it still works afterwards */
+
+  rx.feed(v1C, sizeof(v1C));
+  CHECK(rx.feed(v1C, sizeof(v1C)) == 1 && matchesGolden(&rx.packet(), &golden[2]),
+	"no packet after the noise");
+}
+
+static void testFuzz()
+{
+  printf("fuzz\n");
+  fuzz(V1_FIRST, V1_COUNT, 1);
+  fuzz(V2_FIRST, V2_COUNT, 2);
+  garbage();
+}
+
+/*
+ * bench - decode rate.  The ChapR sends about 28 bytes every 50ms, so
+ *	   anything past a few KB/sec is plenty - this is to catch the
+ *	   decoder getting much slower.
+ */
+
+#define BENCH_BYTES	(32 << 20)
+
+static void bench(int first, int count, int version)
+{
+  static unsigned char stream[1 << 20];
+  int size = 0;
+
+  for (int i = 0; size + 40 < (int) sizeof(stream); i++){
+    const Golden *g = &golden[first + i % count];
+    memcpy(stream + size, g->bytes, g->size);
+    size += g->size;
+  }
+
+  /* in memory */
+
+  ChapRReceiver rx;
+  long packets = 0;
+  double start = now();
+
+  for (long done = 0; done < BENCH_BYTES; done += size){
+    packets += rx.feed(stream, size);
+  }
+  double elapsed = now() - start;
+
+  printf("  v%d in memory: %.1f MB/sec, %.0f packets/sec\n", version,
+	 BENCH_BYTES / elapsed / 1e6, packets / elapsed);
+
+  /* through the pty */
+
+  ChapRReceiver prx;
+  pid_t child = fork();
+
+  start = now();
+  if (child == 0){
+    for (long done = 0; done < BENCH_BYTES / 8; done += size){
+      ptyWrite(stream, size);
+    }
+    _exit(0);
+  }
+  packets = ptyDrain(&prx, 4096);
+  elapsed = now() - start;
+  waitpid(child, NULL, 0);
+
+  printf("  v%d through the pty: %.1f MB/sec, %.0f packets/sec\n", version,
+	 prx.stats().bytes / elapsed / 1e6, packets / elapsed);
+
+  CHECK(prx.stats().badChecksum == 0 && prx.stats().badFrames == 0,
+	"v%d: errors through the pty", version);
+}
+
+static void testBench()
+{
+  printf("decode throughput\n");
+  bench(V1_FIRST, V1_COUNT, 1);
+  bench(V2_FIRST, V2_COUNT, 2);
+}
+
+int main()
+{
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  ptyOpen();
+
+  testGolden();
+  testSwitch();
+  testFuzz();
+  testBench();
+
+  if (failures){
+    printf("%d FAILED\n", failures);
+    return EXIT_FAILURE;
+  }
+  printf("all passed\n");
+  return EXIT_SUCCESS;
+}
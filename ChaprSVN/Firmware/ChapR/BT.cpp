@@ -2,6 +2,7 @@
 #include "config.h"
 #include "BT.h"
 #include "SoftwareSerial.h"
+#include "watchdog.h"
 
 //
 // delay30() - a replacement for delay(30) that, becuase it is used so much in this
@@ -163,7 +164,7 @@ void BT::configMode(char *name)
 
      reset();
 
-     btSend("$$$");		// get into command mode
+     btSend(F("$$$"));		// get into command mode
 
      delay30();
 
@@ -177,19 +178,19 @@ void BT::configMode(char *name)
 //#define btV477
 
 #ifdef btV615
-     btSend("SA,4");            // tells the RN-42 to use simple pin mode authentication
-     btSend("\r");
+     btSend(F("SA,4"));            // tells the RN-42 to use simple pin mode authentication
+     btSend(F("\r"));
 
      delay30();
 
-     btSend("SY,000C\r");	// set power to 12 db
+     btSend(F("SY,000C\r"));	// set power to 12 db
 #endif
 #ifdef btV477
-     btSend("SY,0004\r");	// set power to 12 db
+     btSend(F("SY,0004\r"));	// set power to 12 db
 #endif
      delay30();
 
-     btSend(BT_SU_BAUD_STRING);	// set appropriate baud
+     btSend(F(BT_SU_BAUD_STRING));	// set appropriate baud
 
 //     btSend("SU,");		// old way
 //     btSend(BT_SU_BAUD);
@@ -197,24 +198,24 @@ void BT::configMode(char *name)
 
      delay30();
 
-     btSend("SN,");		// set the appropriate name
+     btSend(F("SN,"));		// set the appropriate name
      btSend(name);
-     btSend("\r");
+     btSend(F("\r"));
 
      delay30();
 
-     btSend("SM,4");		// auto connect mode
-     btSend("\r");
+     btSend(F("SM,4"));		// auto connect mode
+     btSend(F("\r"));
 
      delay30();
 
-     btSend("SR,Z");		// erased previously stored connection
-     btSend("\r");
+     btSend(F("SR,Z"));		// erased previously stored connection
+     btSend(F("\r"));
 
      delay30();
 
-     btSend("SX,1");		// set bonding mode (only stored device can attach)
-     btSend("\r");
+     btSend(F("SX,1"));		// set bonding mode (only stored device can attach)
+     btSend(F("\r"));
 
      delay(50);			// this command takes a little more time
 
@@ -222,9 +223,9 @@ void BT::configMode(char *name)
 //     btSend("\r");
 //     delay30();		// no reason to do this any more - we do it manually
 
-     btSend("U,");		// do an immediate baud rate setting
-     btSend(BT_U_BAUD);		// to eliminate the need for a reboot
-     btSend(",N\r");		// (exits command mode too)
+     btSend(F("U,"));		// do an immediate baud rate setting
+     btSend(F(BT_U_BAUD));		// to eliminate the need for a reboot
+     btSend(F(",N\r"));		// (exits command mode too)
 
      baud9600mode(false);	// get out of 9600 mode, but leave auto connect off
      
@@ -241,16 +242,16 @@ void BT::setRemoteAddress(char *address)
 
   reset();
 
-  btSend("$$$");		// get into command mode
+  btSend(F("$$$"));		// get into command mode
   delay30();
 
-  btSend("SR,");
+  btSend(F("SR,"));
   btSend(address);
-  btSend("\r");
+  btSend(F("\r"));
   delay30();
 
-  btSend("---");		// and out of command mode
-  btSend("\r");
+  btSend(F("---"));		// and out of command mode
+  btSend(F("\r"));
   delay30();
 
   baud9600mode(false);	// get out of 9600 mode, but leave auto connect off
@@ -274,17 +275,17 @@ void BT::opMode()
 
      // we're in 38400 baud in this case, or should be
 
-     btSend("$$$");		// get into command mode
+     btSend(F("$$$"));		// get into command mode
 
      delay30();
 
-     btSend("Q,1");		// make the chapr undiscoverable (don't know if this works)
-     btSend("\r");
+     btSend(F("Q,1"));		// make the chapr undiscoverable (don't know if this works)
+     btSend(F("\r"));
 
      delay30();
 
-     btSend("---");		// and out of command mode
-     btSend("\r");
+     btSend(F("---"));		// and out of command mode
+     btSend(F("\r"));
     
      flushReturnData();
 }
@@ -340,9 +341,16 @@ void BT::btSend(char *string)
      write(string);		// may end-up with a delay in here
 }
 
+void BT::btSend(const __FlashStringHelper *string)
+{
+     print(string);		// the commands are constant, so they stay in flash
+}
+
 void BT::btWrite(byte *buffer, int size)
 {
+     crumbs.bt |= WD_BT_WRITING;		// for the watchdog (see watchdog.h)
      write(buffer,size);
+     crumbs.bt &= ~WD_BT_WRITING;
 }
 
 //
@@ -481,20 +489,20 @@ bool BT::checkVersion()
   begin(BT_CONFIG_BAUD);      // set the SoftwareSerial baud rate appropriately
   reset();
 
-  btSend("$$$");
+  btSend(F("$$$"));
   delay(200);
   recv(buf, 1000);
   delay(100);
 
   // are we connected at all?
 
-  if (strcmp(buf, "CMD") != 0){
+  if (strcmp_P(buf, PSTR("CMD")) != 0){
        return(false);
   }
 
   // seems to be talking to us, ask for its version
 
-  btSend("ver\r");
+  btSend(F("ver\r"));
   delay(200);
 
   // can get up to three lines back, so print them out
@@ -538,17 +546,17 @@ void BT::zombieMode()
 
      // we're in 38400 baud in this case, or should be
 
-     btSend("$$$");		// get into command mode
+     btSend(F("$$$"));		// get into command mode
 
      delay30();
 
-     btSend("K,");		// disconnects any connection
-     btSend("\r");
+     btSend(F("K,"));		// disconnects any connection
+     btSend(F("\r"));
 
      delay30();
 
-     btSend("Z");              //enters deep sleep mode
-     btSend("\r");
+     btSend(F("Z"));              //enters deep sleep mode
+     btSend(F("\r"));
 
     flushReturnData();
 }
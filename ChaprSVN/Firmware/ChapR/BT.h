@@ -78,6 +78,7 @@ private:
      void autoConnectMode(bool);
      void specialPin(int,int);
      void btSend(char *string);
+     void btSend(const __FlashStringHelper *string);
 };
 
 #endif /* BT_h */
@@ -16,14 +16,15 @@
 #include "gamepad.h"
 #include "matchmode.h"
 #include "personality.h"
-#include "personality_0.h"		// NXT-RobotC
-#include "personality_1.h"		// NXT-G
-#include "personality_2.h"              // NXT-LabView
-#include "personality_3.h"		// RIO (roboRIO in particular)
+#include "RIO.h"
 #include "power.h"
 #include "watchdog.h"
 
 #include "debug.h"
+#include "logger.h"
+#include "battery.h"
+#include "console.h"
+#include "hostlink.h"
 
 /****************************************************************************************/
 /* OBJECTS										*/
@@ -36,8 +37,8 @@
 /*	start, the better.								*/
 /*											*/
 /*	Some "special" objects are the "personalities".  they govern how the ChapR	*/
-/*	interacts with the rest of the world.  they are polymorphic so that the given	*/
-/*	personality can be chosen, and used.						*/
+/*	interacts with the rest of the world.  Only the chosen one is built (see	*/
+/*	personality.h) and it is called through the personalityXXX() routines.	*/
 /****************************************************************************************/
 
 blinky	powerLED(LED_POWER);
@@ -53,13 +54,10 @@ button	powerButton(POWER_BUTTON,true);
 
 settings myEEPROM;
 
-Personality_0	p0;
-Personality_1	p1;
-Personality_2   p2;
-Personality_3	p3;
-Personality	*personalities[] = { &p0, &p1, &p2, &p3 };
 int		current_personality;
 
+extern RIO	RIO;		// lives with personality_3, but its link stats are shown here
+
 Gamepad		g1(1);		// I'm gamepad #1!
 Gamepad		g2(2);		// I'm gamepad #2!
 
@@ -93,15 +91,17 @@ void setup()
      powerLED.fast();			// flash the power LED during boot
      
      Serial.begin(LOCAL_SERIAL_BAUD);	// the serial monitor operates at this BAUD
-     Serial.print("ChapR ");
+     Serial.print(F("ChapR "));
      Serial.print(CODEVERSION);
-     Serial.println(" up!");
+     Serial.println(F(" up!"));
 
      // EEPROM starts off unitialized - if this is the case, set the basic defaults
      //	and cause the user to have to go through basic settings - normally this is
      // only used when bringing up a board.  See settings.h for the order of the
      // arguments in setDefaults().  See config.h for the defaults.
 
+     myEEPROM.loadCache();
+
      if (!myEEPROM.isInitialized()){
      	  myEEPROM.boardBringUp();
 	  myEEPROM.setDefaults(DEF_NAME, DEF_TIMEOUT, DEF_PERSON, DEF_LAG, DEF_MODE,
@@ -109,8 +109,6 @@ void setup()
 	  myEEPROM.setFromConsole();
      }		
 
-     myEEPROM.loadCache();
-
      // checks to see if the ChapR has undergone a software reset, making sure it remembers that
      // the power button had already been pressed (this makes sure the kill switch works the first
      // time).
@@ -141,6 +139,7 @@ void setup()
      g2.deviceUpdate(&vdip);
 
      current_personality = myEEPROM.getPersonality();
+     personalityActivate(current_personality);
      
      g1.clear();
      g2.clear();
@@ -158,6 +157,8 @@ void setup()
 
      beeper.confirm();
 
+     batteryStart();
+     button::start();
      watchdogOn();
 
      // from this point forward, we have to "feed the dog" or the watchdog timer will turn
@@ -179,6 +180,18 @@ void software_Reset() // Restarts program from beginning but does not reset the
     asm volatile ("  jmp 0");  
 }
 
+//
+// settingsApply() - put the settings to use after they have been changed from the
+//		     console (see console.cpp).
+//
+void settingsApply()
+{
+     current_personality = myEEPROM.getPersonality();	// in case the personality changed
+     personalityActivate(current_personality);
+     powerTimeout = 60000 * (long) myEEPROM.getTimeout();
+     lag = myEEPROM.getSpeed();
+}
+
 #define DEVICE_UPDATE_LOOP_COUNT	50
 
 void loop()
@@ -193,20 +206,16 @@ void loop()
      bool               wfs = false;
      bool               pb = false;
      bool		lowBattery = false;
+     bool		rescan;
+     unsigned long	loopStart = micros();
+     unsigned long	personalityTime;
+     unsigned long	idleStart;
 
      watchdogFeed();
+     crumbs.loops++;
+     PHASE(PHASE_LOOP);
 
-    if (Serial.available() > 0){
-	 watchdogOff();
-	 if(Serial.read() == '!') {
-	      myEEPROM.boardBringUp();
-	 }
-	 myEEPROM.setFromConsole();
-	 current_personality = myEEPROM.getPersonality();	// in case the personality changed
-	 powerTimeout = 60000 * (long) myEEPROM.getTimeout();
-	 lag = myEEPROM.getSpeed();
-	 watchdogOn();
-    }
+     consolePoll();			// the serial console (see console.cpp)
     
      // when we first boot, the power button is pressed in, so ensure that it changes before monitoring it for shutdown
      if(powerButton.hasChanged()) {
@@ -216,7 +225,8 @@ void loop()
        } else {
 	    if (powerButton.isPressed()) {
 		 // only call kill on the downstroke of the button
-		 personalities[current_personality-1]->Kill(&bt);
+		 personalityKill(&bt);
+		 logEvent(LOG_KILL, 0, (micros() - powerButton.changedAt()) / 100);
 		 pb = true; 
 	    }
        }
@@ -230,34 +240,50 @@ void loop()
        }
      }
 
-     // check the battery - it is "low" if less than this amount
+     // check the battery - it is sampled in the background, this just picks up the
+     // latest (filtered) reading.  See battery.h for what "low" is.
 
-     lowBattery = (BATTERY_VOLTAGE < 65);		// 6.5 volts
+     batteryUpdate();
+     lowBattery = batteryLow();
+     logBattery(batteryVoltage());
 
      // check each joystick that is connected, and grab a packet of information from it if there is any
+     PHASE(PHASE_GAMEPAD);
      if (g2.update(&vdip)) {
 	  js2 = true;
-	  personalities[current_personality-1]->ChangeInput(&bt, 2,&g2_prev,&g2);
+	  personalityChangeInput(&bt, 2,&g2_prev,&g2);
 	  g2_prev = g2;
      }
 
      if (g1.update(&vdip)) {
 	  js1 = true;
-	  personalities[current_personality-1]->ChangeInput(&bt,1,&g1_prev,&g1);
+	  personalityChangeInput(&bt,1,&g1_prev,&g1);
 	  g1_prev = g1;
 
      }
 
      if (theButton.hasChanged()){
 	  wfs = true;
-	  personalities[current_personality-1]->ChangeButton(&bt,theButton.isPressed());
+	  personalityChangeButton(&bt,theButton.isPressed());
      }
 
-     if((loopCount % DEVICE_UPDATE_LOOP_COUNT) == 0) {
-	  if(vdip.deviceCheck()) {
+     // the host link can ask for the USB devices to be looked at again (see hostlink.h)
+
+     rescan = hostlinkRescan();
+     if(rescan || (loopCount % DEVICE_UPDATE_LOOP_COUNT) == 0) {
+	  PHASE(PHASE_DEVICE);
+	  if (rescan) {
+	       vdip.rescan();
+	  }
+	  if(rescan || vdip.deviceCheck()) {
 	       if(vdip.deviceUpdate()) {
 		    g1.deviceUpdate(&vdip);
 		    g2.deviceUpdate(&vdip);
+
+		    // a flash drive may have changed the personality
+
+		    current_personality = myEEPROM.getPersonality();
+		    personalityActivate(current_personality);
 	       }
 	  }
      }
@@ -269,24 +295,37 @@ void loop()
             software_Reset();          //does not initialize the IO lines, just resets master/slave pairing
           }
 
-	  lowBattery?powerLED.fast():powerLED.on();
+	  if (lowBattery) {
+	       powerLED.fast();
+	  } else if (batteryRunningOut()) {
+	       powerLED.slow();		// not low yet, but won't last much longer
+	  } else {
+	       powerLED.on();
+	  }
 	  indicateLED.on();
 
 	  if (!wasConnected) {
 	       wasConnected = true;
+	       logEvent(LOG_CONNECT);
 	       beeper.squeep();
 	  }
      } else {
 	  if(!inConfigMode && lowBattery) {
 	       powerLED.fast();
+	  } else if (!inConfigMode && batteryRunningOut()) {
+	       powerLED.slow();
 	  }
 	  if (wasConnected) {
 	      wasConnected = false;
+	      logEvent(LOG_DISCONNECT);
 	  }
 	  indicateLED.slow();
      }
 
-     personalities[current_personality-1]->Loop(&bt,&g1,&g2);
+     PHASE(PHASE_PERSONALITY);
+     personalityTime = micros();
+     personalityLoop(&bt,&g1,&g2);
+     personalityTime = micros() - personalityTime;
      
      //checks to see if we should enter a power saving mode (if 5 min has passed)
      if (js1 || js2 || wfs || pb){ //if something has happened, make note of the time since boot
@@ -301,8 +340,19 @@ void loop()
      powerLED.update();
      indicateLED.update();
      
-     // the "5" allow only a certain number of updates - saves battery
-     delay(5 + lag);
+     // the "5" allow only a certain number of updates - saves battery, more so since
+     // the CPU sleeps through the wait.  A button press cuts the wait short, so the
+     // kill doesn't depend on the lag.  Any logging to the flash drive happens here,
+     // and its time comes out of the wait.
+
+     PHASE(PHASE_IDLE);
+     logLoop(micros() - loopStart, personalityTime);
+     hostlinkLoop(&g1, &g2, micros() - loopStart, personalityTime);
+     idleStart = millis();
+     logIdle();
+     if (millis() - idleStart < (unsigned long) (5 + lag)) {
+	  idleFor(5 + lag - (millis() - idleStart));
+     }
 
      loopCount++;
 }
@@ -3,17 +3,64 @@
 //
 
 #include <Arduino.h>
+#include <SoftwareSerial.h>
 #include "VDIP.h"
+#include "BT.h"
 #include "gamepad.h"
 #include "RIO.h"
+#include "crc.h"
 #include "settings.h"
 
+RIO::RIO()
+{
+  resetStats();
+  linkReset();
+}
+
+//
+// resetStats() - start the link statistics over (from the console).
+//
+void RIO::resetStats()
+{
+  framesSent = framesCovered = framesLost = 0;
+  replies = badReplies = 0;
+  rttLast = rttMax = 0;
+  rttMin = 0xffff;
+  rttTotal = 0;
+  jitter = 0;
+  haveEcho = false;		// the next echo starts the counts over
+}
+
+//
+// linkReset() - forget what we know about the receiver on the other end
+//		 of the link.  Called when BT drops, because the next
+//		 connection may well be to an older robot.  The stats are
+//		 NOT cleared.
+//
+void RIO::linkReset()
+{
+  replyState = 0;
+  robotVersion = RIO_PROTO_LEGACY;
+  haveEcho = false;
+  killPending = false;
+  killEchoed = false;
+}
+
+//
+// RIO_xlateTH() - the tophat in degrees, from a table instead of a multiply on every
+//		   frame.  Not pressed (0) is 0xFFFF - anything past 8 is taken as
+//		   not pressed too.
+//
+static const unsigned int RIO_TH_DEGREES[] PROGMEM = {
+  0xFFFF, 0, 45, 90, 135, 180, 225, 270, 315
+};
+
 byte RIO::RIO_xlateTH(byte th, char c)
 {
-  if (th == 0){
-    return 0xFF; // special case
+  if (th > 8){
+    th = 0;
   }
-  int th_new  = (th-1)*45;
+  unsigned int th_new = pgm_read_word(&RIO_TH_DEGREES[th]);
   switch(c){
   case 'm': // MSB
     return th_new>>8;
@@ -51,6 +98,10 @@ int RIO::createPacket(byte *msgbuff, bool enable, Gamepad *g1, Gamepad *g2, bool
     cmd = CRIO_ESTOP(false) | CRIO_ENABLE(enable) | CRIO_TELEOP(mode);
   }
 
+  if (robotVersion >= RIO_PROTO_V2){
+    return(createPacketV2(msgbuff, (byte) cmd, g1, g2));
+  }
+
   uint8_t size = 0;
 
   msgbuff[size++] = (byte) 0xff;                                  // 1st of 3 sync bytes
@@ -84,9 +135,147 @@ int RIO::createPacket(byte *msgbuff, bool enable, Gamepad *g1, Gamepad *g2, bool
   byte cs = checksum(msgbuff + 3, size - 3);
   msgbuff[size++] = cs;
 
+  // the probe trailer only goes out once the robot has told us it
+  // knows what to do with it
+
+  if (robotVersion >= RIO_PROTO_PROBE){
+    unsigned int stamp = nextStamp();
+
+    msgbuff[size++] = seq;
+    msgbuff[size++] = (byte) (stamp >> 7);
+    msgbuff[size++] = (byte) (stamp & 0x7f);
+    msgbuff[size] = checksum(msgbuff + size - 3, 3);
+    size++;
+
+    seq = (seq + 1) & RIO_SEQ_MASK;
+  }
+
   return(size);			// total size of the message going over BT
 }
 
+//
+// createKillPacket() - create a disabled packet, with neutral gamepads, to be
+//			sent right away when the kill button is pressed (see
+//			RIO.h).  The first one of a bunch is the one remembered
+//			for killConfirmed().
+//
+int RIO::createKillPacket(byte *msgbuff, bool mode, bool isRoboRIO)
+{
+  Gamepad neutral(0);
+
+  neutral.clear();
+  neutral.type = 0;
+
+  if (!killPending && robotVersion >= RIO_PROTO_PROBE){
+    killPending = true;
+    killEchoed = false;
+    killSeq = seq;
+  }
+
+  return(createPacket(msgbuff, false, &neutral, &neutral, mode, isRoboRIO));
+}
+
+//
+// killConfirmed() - true (once) when the robot has echoed a kill frame.
+//
+bool RIO::killConfirmed()
+{
+  if (killEchoed){
+    killEchoed = false;
+    return(true);
+  }
+  return(false);
+}
+
+//
+// nextStamp() - return the stamp for the frame being built, counting it
+//		 as sent along the way.
+//
+unsigned int RIO::nextStamp()
+{
+  framesSent++;
+  return(millis() & RIO_STAMP_MASK);
+}
+
+//
+// createPacketV2() - create a v2 frame (see RIO.h) in msgbuff, returning
+//		      the number of bytes to send.  The frame is built in
+//		      the clear first, and then COBS encoded into msgbuff.
+//
+int RIO::createPacketV2(byte *msgbuff, byte cmd, Gamepad *g1, Gamepad *g2)
+{
+  byte raw[RIO_V2_RAW_SIZE];
+  byte *ptr = raw;
+  unsigned int stamp = nextStamp();
+
+  *ptr++ = RIO_PROTO_V2;
+  *ptr++ = seq;
+  *ptr++ = (byte) (stamp >> 8);
+  *ptr++ = (byte) (stamp & 0xff);
+  *ptr++ = cmd;
+  ptr = packGamepad(ptr, g1);
+  ptr = packGamepad(ptr, g2);
+  *ptr = crc8(CRC8_INIT, raw, RIO_V2_RAW_SIZE - 1);
+
+  seq = (seq + 1) & RIO_SEQ_MASK;
+
+  int size = cobsEncode(raw, RIO_V2_RAW_SIZE, msgbuff);
+  msgbuff[size++] = 0x00;		// the frame delimiter
+
+  return(size);
+}
+
+//
+// packGamepad() - put the RIO_V2_GAMEPAD_SIZE bytes for the gamepad at ptr,
+//		   returning the pointer to the next byte.
+//
+byte *RIO::packGamepad(byte *ptr, Gamepad *g)
+{
+  *ptr++ = (byte) g->type;
+  *ptr++ = (byte) g->x1;
+  *ptr++ = (byte) g->y1;
+  *ptr++ = (byte) g->x2;
+  *ptr++ = (byte) g->y2;
+  *ptr++ = (byte) g->x3;
+  *ptr++ = (byte) g->y3;
+  *ptr++ = (byte) (g->buttons & 0xff);				// B1 to B8
+  *ptr++ = (byte) (((g->buttons >> 8) & 0x0f) | (g->tophat << 4));	// B9 to B12, tophat
+
+  return(ptr);
+}
+
+//
+// cobsEncode() - Consistent Overhead Byte Stuffing.  Each run of non-zero
+//		  bytes is preceded by a count of (run length + 1), and the
+//		  zero that ended the run is dropped.  The encoded data in
+//		  dst is never more than size + 1 bytes (for size < 254),
+//		  and never contains a 0x00.  Returns the encoded size.
+//
+int RIO::cobsEncode(byte *src, int size, byte *dst)
+{
+  int codeAt = 0;			// where the count for this run goes
+  int out = 1;
+  byte code = 1;
+
+  for (int i = 0; i < size; i++){
+    if (src[i] == 0){
+      dst[codeAt] = code;
+      codeAt = out++;
+      code = 1;
+    } else {
+      dst[out++] = src[i];
+      if (++code == 0xff){		// max run - start another one
+	dst[codeAt] = code;
+	codeAt = out++;
+	code = 1;
+      }
+    }
+  }
+  dst[codeAt] = code;
+
+  return(out);
+}
+
 byte RIO::checksum(byte *msgbuff, int size)
 {
   byte cs = 0;
@@ -100,4 +289,141 @@ byte RIO::checksum(byte *msgbuff, int size)
 
   return(cs);
 }
-
+
+
+//
+// processReplies() - drain whatever the robot has sent back to us over
+//		      BT.  Replies are found the same way the robot finds
+//		      our packets - three 0xFF's followed by the data.  Note
+//		      that SoftwareSerial can't receive while it is sending,
+//		      so replies that land on top of one of our packets get
+//		      mangled; the checksum catches those.
+//
+//		      NOTE - a reply can sit in the receive buffer for up to
+//		      one trip through loop() before it is seen here, so the
+//		      RTT includes that too.
+//
+void RIO::processReplies(BT *bt)
+{
+  while (bt->available() > 0){
+    byte c = bt->read();
+
+    if (replyState < 3){		// still looking for the sync bytes
+      replyState = (c == 0xff)? replyState + 1 : 0;
+      continue;
+    }
+
+    if (c == 0xff){			// no reply byte is ever FF, so resync
+      replyState = 1;
+      continue;
+    }
+
+    replyBuff[replyState - 3] = c;
+    replyState++;
+
+    if (replyState == 3 + RIO_REPLY_SIZE){
+      replyState = 0;
+      replyReceived();
+    }
+  }
+}
+
+//
+// replyReceived() - a full reply is sitting in replyBuff, so check it and
+//		     fold it into the link statistics.
+//
+void RIO::replyReceived()
+{
+  if (checksum(replyBuff, RIO_REPLY_SIZE - 1) != replyBuff[RIO_REPLY_SIZE - 1]){
+    badReplies++;
+    return;
+  }
+
+  robotVersion = replyBuff[0];		// v2 frames start with the next packet
+
+  if (replyBuff[1] & RIO_NO_ECHO){	// just a hello - nothing to measure
+    return;
+  }
+
+  byte echoSeq = replyBuff[1];
+  byte echoCount = replyBuff[2];
+  unsigned int stamp = (replyBuff[3] << 7) | replyBuff[4];
+  unsigned int rtt = ((millis() & RIO_STAMP_MASK) - stamp) & RIO_STAMP_MASK;
+
+  // the robot tells us the last seq it saw and how many good frames it
+  // has seen, so anything we sent in between that it didn't count was lost
+
+  if (haveEcho){
+    byte sent = (echoSeq - lastEchoSeq) & RIO_SEQ_MASK;
+    byte got = (echoCount - lastEchoCount) & RIO_SEQ_MASK;
+
+    framesCovered += sent;
+    if (sent > got){
+      framesLost += sent - got;
+    }
+    jitter += abs((int)(rtt - rttLast)) - (jitter >> 4);
+  }
+
+  // the echo is of the kill frame (or one after it) when it isn't behind
+  // killSeq - seq's wrap, so "behind" is more than half way around
+
+  if (killPending && ((echoSeq - killSeq) & RIO_SEQ_MASK) < (RIO_SEQ_MASK + 1) / 2){
+    killPending = false;
+    killEchoed = true;
+  }
+
+  haveEcho = true;
+  lastEchoSeq = echoSeq;
+  lastEchoCount = echoCount;
+
+  replies++;
+  rttLast = rtt;
+  rttTotal += rtt;
+  if (rtt < rttMin){
+    rttMin = rtt;
+  }
+  if (rtt > rttMax){
+    rttMax = rtt;
+  }
+}
+
+//
+// printStats() - dump the link statistics to the serial console.
+//
+void RIO::printStats()
+{
+  Serial.print(F("RIO link: "));
+  if (robotVersion == RIO_PROTO_LEGACY){
+    Serial.println(F("legacy (no replies)"));
+  } else {
+    Serial.print(F("v"));
+    Serial.println(robotVersion);
+  }
+
+  Serial.print(F(" sent "));
+  Serial.print(framesSent);
+  Serial.print(F(" replies "));
+  Serial.print(replies);
+  Serial.print(F(" bad "));
+  Serial.println(badReplies);
+
+  Serial.print(F(" lost "));
+  Serial.print(framesLost);
+  Serial.print(F(" of "));
+  Serial.println(framesCovered);
+
+  if (replies == 0){
+    return;
+  }
+
+  Serial.print(F(" rtt(ms) last "));
+  Serial.print(rttLast);
+  Serial.print(F(" min "));
+  Serial.print(rttMin);
+  Serial.print(F(" max "));
+  Serial.print(rttMax);
+  Serial.print(F(" avg "));
+  Serial.print(rttTotal / replies);
+  Serial.print(F(" jitter "));
+  Serial.println(jitter >> 4);
+}
@@ -11,7 +11,8 @@
 #include "VDIP.h"
 #include "gamepad.h"
 
-// General Structure - 30 bytes total
+// General Structure - 28 bytes total (32 with the probe trailer)
+//   (this is "v1" - see the bottom of the file for v2 frames)
 // sync bytes - three 0xFFs (the following data is organized so that 
 //              it is "impossible" to ever get three FFs in a row (if
 //              this ever occurs, the packet should be thrown out
@@ -90,16 +91,139 @@
 //------------------------------------------------------------------------
 //                                                         24 bytes total
 
+// Probe Trailer (protocol v1 with RTT probe)
+//------------------------------------------------------------------------
+// Once the robot has announced (with a reply, see below) that it knows
+// about the probe, four more bytes are tacked on after the checksum.
+// Every one of them has its high bit clear, so a legacy receiver that
+// is hunting for the next three 0xFF's will simply skip over them.
+//
+// seq        : rolling sequence number (0 to 127)         : 0
+// stamp_m    : bits 13-7 of the ChapR millis() at send    : 1
+// stamp_l    : bits 6-0 of the ChapR millis() at send     : 2
+// checksum   : 7-bit sum of the three bytes above         : 3
+//------------------------------------------------------------------------
+
+#define RIO_TRAILER_SIZE	4
+#define RIO_SEQ_MASK		0x7f
+#define RIO_STAMP_MASK		0x3fff		// stamps wrap every 16.4 seconds
+
+// Reply Format (robot to ChapR)
+//------------------------------------------------------------------------
+// The robot side sends these back over the same BT link, with the same
+// three 0xFF sync bytes in front.  It may send them as often as it likes
+// (chaprd sends one every few frames).  Before it has seen a trailer it
+// sends "hello" replies with RIO_NO_ECHO in the seq field, which is how
+// the ChapR learns that the trailer won't confuse the receiver.
+//
+// version    : highest protocol version the robot knows   : 0
+// seq        : last seq received, or RIO_NO_ECHO          : 1
+// count      : rolling count (7 bits) of good frames      : 2
+// stamp_m    : echo of stamp_m from that frame            : 3
+// stamp_l    : echo of stamp_l from that frame            : 4
+// checksum   : 7-bit sum of the five bytes above          : 5
+//------------------------------------------------------------------------
+
+#define RIO_REPLY_SIZE		6
+#define RIO_NO_ECHO		0x80
+#define RIO_PROTO_LEGACY	0		// never heard from the robot
+#define RIO_PROTO_PROBE		1		// robot echoes the probe trailer
+#define RIO_PROTO_V2		2		// robot understands v2 frames
+
+// Version 2 Frames
+//------------------------------------------------------------------------
+// When the robot's replies say it knows v2, the packet above is replaced
+// by a COBS encoded frame followed by a 0x00 delimiter.  COBS guarantees
+// that the encoded frame never contains a zero, so a receiver resyncs at
+// the very next 0x00 instead of needing sync bytes and zero padding.
+// Before encoding, the frame looks like this:
+//
+// version    : RIO_PROTO_V2                             : 0
+// seq        : rolling sequence number (0 to 127)       : 1
+// stamp_m    : MSB of the 14 bit millis() stamp         : 2
+// stamp_l    : LSB of the stamp                         : 3
+// cmd        : same command byte as the v1 packet       : 4
+// joy1_type  : (based on index in drivers table)        : 5
+// joy1_x1    : (-128 to 127)                            : 6
+// joy1_y1    : (-128 to 127)                            : 7
+// joy1_x2    : (-128 to 127)                            : 8
+// joy1_y2    : (-128 to 127)                            : 9
+// joy1_x3    : (-128 to 127)                            : 10
+// joy1_y3    : (-128 to 127)                            : 11
+// joy1_B     : bitmap of B1 to B8, where B1 is bit 0    : 12
+// joy1_BTH   : B9 to B12 in bits 0-3, tophat in 4-7     : 13
+// joy2_...   : same nine bytes for joystick 2           : 14 - 22
+// crc        : CRC-8 (see crc.h) of bytes 0 to 22       : 23
+//------------------------------------------------------------------------
+//                         24 bytes, 26 on the wire after COBS and 0x00
+//
+// The tophat is sent as it comes from the gamepad: 0 when not pressed,
+// then 1 to 8 for N, NE, E... clockwise.  Degrees are (tophat-1)*45.
+
+#define RIO_V2_RAW_SIZE		24
+#define RIO_V2_GAMEPAD_SIZE	9
+
+// Kill
+//------------------------------------------------------------------------
+// When the kill button is pressed, the personality doesn't wait for the
+// next Loop() - it sends RIO_KILL_SENDS disabled frames right away, with
+// the gamepads neutral.  There is no special "kill" frame (the robot would
+// need to know about it) so the e-stop bit is NOT used - it latches on the
+// roboRIO until it is rebooted.  Once a reply echoes the seq of one of the
+// kill frames (or a later one), the robot is known to have seen it and
+// killConfirmed() goes true, once.  Legacy robots never echo, so a kill
+// is never confirmed for them.
+
+#define RIO_KILL_SENDS		3
+
+class BT;
+
 class RIO
 {
  public:
+  RIO();
   int createPacket(byte *msgbuff, bool enable, Gamepad *g1, Gamepad *g2, bool mode, bool isRoboRIO);
+  int createKillPacket(byte *msgbuff, bool mode, bool isRoboRIO);
+  bool killConfirmed();
   bool firePlugBT_ID(VDIP *vdip, int usbDev, char **btAddress);
+  void processReplies(BT *bt);
+  void linkReset();
+  void printStats();
+  void resetStats();
 
  private:
   byte RIO_xlateTH(byte th, char c);
   byte checksum(byte *msgbuff, int size);
+  void replyReceived();
+  int  createPacketV2(byte *msgbuff, byte cmd, Gamepad *g1, Gamepad *g2);
+  byte *packGamepad(byte *ptr, Gamepad *g);
+  int  cobsEncode(byte *src, int size, byte *dst);
+  unsigned int nextStamp();
+
+  byte		 replyBuff[RIO_REPLY_SIZE];
+  byte		 replyState;		// sync bytes seen, then bytes of the reply
+  byte		 robotVersion;		// what the robot said it can handle
+  byte		 seq;			// next sequence number to go out
+  bool		 haveEcho;		// true once lastEchoSeq/Count are valid
+  byte		 lastEchoSeq;
+  byte		 lastEchoCount;
+  bool		 killPending;		// a kill frame went out, no echo of it yet
+  bool		 killEchoed;		// ...and now there is
+  byte		 killSeq;		// seq of the first kill frame
+
+  // link statistics - these survive a reconnect so they can be read after a run
+
+  unsigned int	 framesSent;		// frames that carried a seq/stamp
+  unsigned int	 framesCovered;		// frames accounted for by echoes
+  unsigned int	 framesLost;
+  unsigned int	 replies;
+  unsigned int	 badReplies;
+  unsigned int	 rttLast;
+  unsigned int	 rttMin;
+  unsigned int	 rttMax;
+  unsigned long	 rttTotal;
+  unsigned int	 jitter;		// smoothed |rtt delta|, scaled by 16
 };
 
 #endif RIO_H
-
+
@@ -8,6 +8,12 @@
 #include "config.h"
 #include "settings.h"
 #include "watchdog.h"
+#include "logger.h"
+#include "drivers.h"
+
+#if VDIP_JOYSTICK != MAXTRANSLATE
+#error VDIP_JOYSTICK must match MAXTRANSLATE
+#endif
 
 extern void software_Reset();
 
@@ -24,13 +30,13 @@ extern sound beeper;
 #ifdef DEBUG
 void DEBUG_PORT_CONFIG(portConfig *config)
 {
-     Serial.print("port: ");
+     Serial.print(F("port: "));
      Serial.print(config->port);
-     Serial.print(" - logical dev: ");
+     Serial.print(F(" - logical dev: "));
      Serial.print(config->usbDev);
-     Serial.print(" - type: ");
+     Serial.print(F(" - type: "));
      Serial.print(config->type);
-     Serial.println("");
+     Serial.println();
 }
 /*
 void VDIP::debug_port_config()
@@ -42,7 +48,7 @@ void VDIP::debug_port_config()
 void DEBUG_HEX_BYTE(unsigned char c)
 {
      if(c < 16) {
-	  Serial.print("0");
+	  Serial.print('0');
      }
      Serial.print(c,HEX);
 }
@@ -52,29 +58,29 @@ void DEBUG_HEX_BYTE(unsigned char c)
 //
 void DEBUG_USB_QD(int dev, unsigned char *buffer)
 {
-     Serial.print("UA (");
+     Serial.print(F("UA ("));
      Serial.print(dev);
-     Serial.print("): ");
-     DEBUG_HEX_BYTE(buffer[0]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[1]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[2]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[3]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[4]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[5]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[6]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[7]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[8]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[9]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[10]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[11]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[12]); Serial.print(" ");
-     DEBUG_HEX_BYTE(buffer[13]); Serial.print(" ");
+     Serial.print(F("): "));
+     DEBUG_HEX_BYTE(buffer[0]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[1]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[2]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[3]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[4]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[5]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[6]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[7]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[8]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[9]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[10]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[11]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[12]); Serial.print(' ');
+     DEBUG_HEX_BYTE(buffer[13]); Serial.print(' ');
      DEBUG_HEX_BYTE(buffer[15]);
-     DEBUG_HEX_BYTE(buffer[14]); Serial.print(" ");
+     DEBUG_HEX_BYTE(buffer[14]); Serial.print(' ');
      DEBUG_HEX_BYTE(buffer[17]);
-     DEBUG_HEX_BYTE(buffer[16]); Serial.print(" ");
+     DEBUG_HEX_BYTE(buffer[16]); Serial.print(' ');
      DEBUG_HEX_BYTE(buffer[19]);
-     DEBUG_HEX_BYTE(buffer[18]); Serial.print(" ");
+     DEBUG_HEX_BYTE(buffer[18]); Serial.print(' ');
      Serial.println();
 }
 
@@ -126,6 +132,9 @@ bool VDIP::deviceUpdate()
      int		i;
      bool		changed = false;
      
+     _joyPending = 0;		// a kept report may be for a device that is gone
+     _notPolled = 0;		// ...and a new device may be one DRA covers
+
      // mark the two ports so we know when they've been assigned
 
      for(i=2; i--; ) {
@@ -198,7 +207,7 @@ bool VDIP::deviceUpdate()
 
         if(portConfigBuffer.type == DEVICE_KC_4134) {
           watchdogOff();
-          Serial.println("About to process");
+          Serial.println(F("About to process"));
           processKC4134(&portConfigBuffer);
           watchdogOn();
         }
@@ -231,6 +240,18 @@ bool VDIP::deviceUpdate()
      return(changed);
 }
 
+//
+// rescan() - forget what is in the ports, so that the next deviceUpdate() treats
+//	      everything as newly plugged in (the host link asks for this).
+//
+void VDIP::rescan()
+{
+     for(int i=2; i--; ) {
+	  ports[i].port = -1;
+	  ports[i].usbDev = -1;
+     }
+}
+
 //
 // portConnection() - returns the type, the VID, and the PID of the device connected to 
 //		      the given port (either 0 or 1).  This "port" refers to the ChapR/VDIP
@@ -283,18 +304,18 @@ void VDIP::mapDevice(int dev, char *deviceReport, portConfig *returnPortConfig)
      }
 
      #ifdef DEBUG
-          Serial.print("vid 0x");
+          Serial.print(F("vid 0x"));
           Serial.print(returnPortConfig->vid,HEX);
-          Serial.print(" pid 0x");
+          Serial.print(F(" pid 0x"));
 	  Serial.print(returnPortConfig->pid,HEX);
-	  Serial.print(" usbDev 0x");
+	  Serial.print(F(" usbDev 0x"));
 	  Serial.print(returnPortConfig->usbDev,HEX);
 
-          Serial.print(" type 0x");
+          Serial.print(F(" type 0x"));
 	  Serial.print(returnPortConfig->type,HEX);
-	  Serial.print(" (0x");
+	  Serial.print(F(" (0x"));
 	  Serial.print(deviceReport[DEV_TYPE],HEX);
-	  Serial.println(")");
+	  Serial.println(')');
      #endif
 }
 
@@ -355,6 +376,8 @@ int VDIP::cmd(vdipcmd cmd, char *buf, int timeout, int arg /* = 0 */)
      int	rbytes = 0;		// how many bytes to expect
      bool	twoStage = false;	// true if return has a number of bytes as the first stage
      int	sendingCmd = false;	// true if the command sends out data
+
+     crumbs.vdip = (uint8_t)cmd | WD_VDIP_BUSY;	// for the watchdog (see watchdog.h)
      
      sync();
 
@@ -403,6 +426,14 @@ int VDIP::cmd(vdipcmd cmd, char *buf, int timeout, int arg /* = 0 */)
 	  }
 	  break;
 
+     case VDIP_DRA:		// "data read all" - only the number of reports is read here,
+	  rbytes = 1;		//   readJoysticks() reads the reports themselves
+	  twoStage = true;
+	  {
+	       cbuf[i++] = '\x9B';
+	  }
+	  break;
+
      case VDIP_QP:		// "query port" command
 	  rbytes = 2;		// two bytes back for the QP commands
 	  {
@@ -437,6 +468,34 @@ int VDIP::cmd(vdipcmd cmd, char *buf, int timeout, int arg /* = 0 */)
           }
           break;
           
+    case VDIP_OPW:
+        rbytes = 0;
+          {
+            cbuf[i++] = '\x09';
+            cbuf[i++] = ' ';
+            for (uint8_t x = 0; x < 15; x++){
+                 if (buf[x] == '\0'){
+                   break;
+                 }
+                 cbuf[i] = buf[x];
+                 i++;
+               }
+          }
+	  break;
+
+    case VDIP_WRF:		// the data follows the command, like DSD
+        rbytes = 0;
+        sendingCmd = true;
+          {
+              cbuf[i++] = '\x08';
+              cbuf[i++] = ' ';
+              cbuf[i++] = '\x0';
+              cbuf[i++] = '\x0';
+              cbuf[i++] = (char) (arg >> 8);
+              cbuf[i++] = (char) arg;
+          }
+          break;
+
     case VDIP_CLF:
         rbytes = 0;
           {
@@ -501,23 +560,28 @@ int VDIP::cmd(vdipcmd cmd, char *buf, int timeout, int arg /* = 0 */)
 	       rbytes = cbuf[0];
 
 	       // there seems to be the possibility that either "Bad Command" (BC) or "Command Failed" (CF)
-	       // comes back.  In this case, ignore it and return zero.
+	       // comes back.  In this case, ignore it and return zero - except that a "BC" for DRA
+	       // returns -1, since it means the VDIP firmware doesn't have DRA.
 
 	       switch(rbytes) {
 	       case '\r':
 	       case 'B':
 	       case 'C':		// any of these indicates zero
 		    flush();		// so flush the rest and return
-		    return(0);
+		    crumbs.vdip &= ~WD_VDIP_BUSY;
+		    return((rbytes == 'B' && (uint8_t)cmd == VDIP_DRA)? -1 : 0);
 
 	       default:	
 		    readBytes(1,cbuf,timeout);		// consume the '\r'
-		    readBytes(rbytes,buf,timeout);	// then return the real bytes
+		    if ((uint8_t)cmd != VDIP_DRA) {
+			 readBytes(rbytes,buf,timeout);	// then return the real bytes
+		    }
 		    break;
 	       }
 	  }
      }
 
+     crumbs.vdip &= ~WD_VDIP_BUSY;
      return(rbytes);
 }
 
@@ -528,6 +592,7 @@ int VDIP::cmd(vdipcmd cmd, char *buf, int timeout, int arg /* = 0 */)
 //		the entire contents of the file, but only up to the "numToRead"
 //		number of bytes.  If "lineOnly" is set true, the only the first
 //		line is returned (up to the return or newline) - defaults to false.
+//		The name is in flash (PSTR()) - it is only copied to RAM here.
 //
 //	RETURNS:  true if there was SOMETHING read, false if nothing
 //	NOTE: this routine counts on the fact that if the file doesn't exist,
@@ -535,8 +600,12 @@ int VDIP::cmd(vdipcmd cmd, char *buf, int timeout, int arg /* = 0 */)
 //		check the return of the first open, and not do anything
 //		if the file can't be found.
 //
-bool VDIP::readFile(char *filename, char *buf, byte numToRead, bool lineOnly)
+bool VDIP::readFile(PGM_P name, char *buf, byte numToRead, bool lineOnly)
 {
+     char	filename[VDIP_FILENAME];
+
+     strcpy_P(filename, name);
+
      // open the file for reading, then read, then close
      
      cmd(VDIP_OPR, filename, DEFAULTTIMEOUT, 0);
@@ -564,6 +633,277 @@ bool VDIP::readFile(char *filename, char *buf, byte numToRead, bool lineOnly)
 
 //insert defines here for maxes and mins!!!!!!!!!!!!!!!!!!!!!!!!!!! (TODO)
 
+//
+// FLASH DRIVE SETTINGS - everything can be set from a single "chapr.cfg" file of
+//   key=value lines, like this:
+//
+//	# comments start with a hash
+//	name=ChapR42
+//	person=1
+//	timeout=10
+//	lag=0
+//	mode=1
+//	canMMode=1
+//	auto=30
+//	tele=90
+//	endgame=30
+//	tether=0
+//	log=0
+//	targetID=00165300C332
+//
+//   Keys can be in any order (or left out) and are case insensitive.  A person= resets the
+//   match lengths to that personality's defaults, but not any of them given with auto=,
+//   tele= or endgame= in the same file (before or after it).  The console "set" works
+//   the same way, with everything set since the last file counting as one file.
+//
+//   When there is no chapr.cfg on the drive, the old one-file-per-setting names (name.txt, lag.txt...)
+//   are still read.  The config file is read in CFG_CHUNK byte pieces, and parsed as it
+//   goes, so it costs one OPR/CLF no matter how many settings are in it.
+//
+#define CFG_CHUNK	32		// bytes per RDF
+#define CFG_LINE	40		// longest line that is paid attention to
+#define CFG_MAXCHUNKS	64		// stop after this much (2K) - it isn't a config file
+
+typedef enum {
+     CFG_NAME, CFG_PERSON, CFG_TIMEOUT, CFG_LAG, CFG_MODE, CFG_MATCHMODE,
+     CFG_AUTO, CFG_TELE, CFG_END, CFG_TETHER, CFG_TARGETID, CFG_LOG,
+     CFG_COUNT
+} cfgSetting;
+
+#define CFG_LENBIT(s)	(1 << ((s) - CFG_AUTO))	// for _lengthsSet - only CFG_AUTO..CFG_END
+
+static const char cfgKeyName[] PROGMEM = "name";
+static const char cfgKeyPerson[] PROGMEM = "person";
+static const char cfgKeyTimeout[] PROGMEM = "timeout";
+static const char cfgKeyLag[] PROGMEM = "lag";
+static const char cfgKeyMode[] PROGMEM = "mode";
+static const char cfgKeyMatchMode[] PROGMEM = "canMMode";
+static const char cfgKeyAuto[] PROGMEM = "auto";
+static const char cfgKeyTele[] PROGMEM = "tele";
+static const char cfgKeyEnd[] PROGMEM = "endgame";
+static const char cfgKeyTether[] PROGMEM = "tether";
+static const char cfgKeyTargetID[] PROGMEM = "targetID";
+static const char cfgKeyLog[] PROGMEM = "log";
+
+static const char * const cfgKeys[CFG_COUNT] PROGMEM = {	// in cfgSetting order
+     cfgKeyName, cfgKeyPerson, cfgKeyTimeout, cfgKeyLag, cfgKeyMode, cfgKeyMatchMode,
+     cfgKeyAuto, cfgKeyTele, cfgKeyEnd, cfgKeyTether, cfgKeyTargetID, cfgKeyLog
+};
+
+//
+// applySetting() - set one setting from its (text) value, checking it along the way.
+//		    This is shared by chapr.cfg and the old individual files.
+//
+void VDIP::applySetting(int which, char *value)
+{
+     int	num = atoi(value);
+
+     switch(which) {
+     case CFG_NAME:
+	  if (strlen(value) < EEPROM_NAMELENGTH) {
+	       myEEPROM.setName(value);
+	  }
+	  break;
+
+     case CFG_PERSON:
+	  if (num > 0 && num <= EEPROM_LASTPERSON){
+	       byte autoLen = 0, teleLen = 0, endLen = 0;
+
+	       myEEPROM.setPersonality(num);
+	       if (num == 1 || num == 3){ // is an FTC personality
+		    autoLen = DEF_FTCAUTOLEN;
+		    teleLen = DEF_FTCTELELEN;
+		    endLen = DEF_FTCENDLEN;
+	       }
+	       if (num == 4){ // is an FRC personality
+		    autoLen = DEF_FRCAUTOLEN;
+		    teleLen = DEF_FRCTELELEN;
+		    endLen = DEF_FRCENDLEN;
+	       }
+
+	       // reset to defaults - but lengths that were given explicitly stay put
+
+	       if (autoLen) {
+		    if (!(_lengthsSet & CFG_LENBIT(CFG_AUTO))) myEEPROM.setAutoLen(autoLen);
+		    if (!(_lengthsSet & CFG_LENBIT(CFG_TELE))) myEEPROM.setTeleLen(teleLen);
+		    if (!(_lengthsSet & CFG_LENBIT(CFG_END)))  myEEPROM.setEndLen(endLen);
+	       }
+	  }
+	  break;
+
+     case CFG_TIMEOUT:	myEEPROM.setTimeout((byte) num);	break;
+     case CFG_LAG:	myEEPROM.setSpeed((byte) num);		break;
+     case CFG_MODE:	myEEPROM.setMode((byte) num);		break;
+
+     case CFG_AUTO:	myEEPROM.setAutoLen((byte) num);	_lengthsSet |= CFG_LENBIT(which);	break;
+     case CFG_TELE:	myEEPROM.setTeleLen((byte) num);	_lengthsSet |= CFG_LENBIT(which);	break;
+     case CFG_END:	myEEPROM.setEndLen((byte) num);		_lengthsSet |= CFG_LENBIT(which);	break;
+
+     case CFG_MATCHMODE:
+	  if (num == 0 || num == 1){
+	       myEEPROM.setMatchModeEnable(num);
+	  }
+	  break;
+
+     case CFG_TETHER:
+	  if (num == 0 || num == 1){
+	       myEEPROM.setTether(num);
+	  }
+	  break;
+
+     case CFG_LOG:
+	  if (num == 0 || num == 1){
+	       myEEPROM.setLogging(num);
+	  }
+	  break;
+
+     // a target bluetooth connection ID means connect to it.  Note that this data
+     // IS NOT stored in the EEPROM - instead, it is just used as the current paired
+     // device and will be reset (like normal) whenever a new pairing is done.
+
+     case CFG_TARGETID:
+	  if (bt.addressFilter(value,strlen(value)+1)) {	// useful address?
+	       bt.setRemoteAddress(value);
+	       delay(100);
+	  }
+	  break;
+     }
+}
+
+//
+// configLine() - deal with one line of chapr.cfg.  Returns true if it was a setting.
+//
+bool VDIP::configLine(char *line)
+{
+     char	*key;
+     char	*value;
+     char	*end;
+
+     for (key = line; *key == ' ' || *key == '\t'; key++)
+	  ;
+
+     if (*key == '#' || (value = strchr(key,'=')) == NULL) {
+	  return(false);
+     }
+
+     // trim the spaces from around the key and the value
+
+     for (end = value; end > key && (end[-1] == ' ' || end[-1] == '\t'); end--)
+	  ;
+     *end = '\0';
+
+     for (value++; *value == ' ' || *value == '\t'; value++)
+	  ;
+     for (end = value + strlen(value); end > value && (end[-1] == ' ' || end[-1] == '\t'); end--)
+	  ;
+     *end = '\0';
+
+     for (int i = 0; i < CFG_COUNT; i++) {
+	  if (strcasecmp_P(key, (PGM_P) pgm_read_word(&cfgKeys[i])) == 0) {
+	       applySetting(i,value);
+	       return(true);
+	  }
+     }
+
+     return(false);
+}
+
+//
+// printConfig() - print the settings as chapr.cfg lines (so they could be pasted into one),
+//		   all of them, or just the one with the given key.  The target ID isn't
+//		   kept, so it isn't printed.  Returns false if there was no such key.
+//
+bool VDIP::printConfig(char *key)
+{
+     bool	found = false;
+
+     for (int i = 0; i < CFG_COUNT; i++) {
+	  PGM_P	name = (PGM_P) pgm_read_word(&cfgKeys[i]);
+
+	  if (i == CFG_TARGETID || (key && *key && strcasecmp_P(key, name) != 0)) {
+	       continue;
+	  }
+	  found = true;
+
+	  Serial.print((const __FlashStringHelper *) name);
+	  Serial.print(F("="));
+	  switch(i) {
+	  case CFG_NAME:	Serial.println(myEEPROM.getName());		break;
+	  case CFG_PERSON:	Serial.println(myEEPROM.getPersonality());	break;
+	  case CFG_TIMEOUT:	Serial.println(myEEPROM.getTimeout());		break;
+	  case CFG_LAG:		Serial.println(myEEPROM.getSpeed());		break;
+	  case CFG_MODE:	Serial.println(myEEPROM.getMode());		break;
+	  case CFG_MATCHMODE:	Serial.println(myEEPROM.matchModeIsEnabled());	break;
+	  case CFG_AUTO:	Serial.println(myEEPROM.getAutoLen());		break;
+	  case CFG_TELE:	Serial.println(myEEPROM.getTeleLen());		break;
+	  case CFG_END:		Serial.println(myEEPROM.getEndLen());		break;
+	  case CFG_TETHER:	Serial.println(myEEPROM.tetherIsEnabled());	break;
+	  case CFG_LOG:		Serial.println(myEEPROM.loggingIsEnabled());	break;
+	  }
+     }
+
+     return(found);
+}
+
+//
+// readConfigFile() - read the given config file, a chunk at a time, handing each line
+//		      to configLine() as it completes.  Returns the number of settings
+//		      found (zero if the file isn't there).
+//
+//	NOTE: like readFile(), this counts on the VDIP returning \xFE's when reading past
+//		the end of the file.  The chunk is filled with them before each read so that
+//		a read that times out looks the same.
+//
+int VDIP::readConfigFile(PGM_P name)
+{
+     char	filename[VDIP_FILENAME];
+     char	chunk[CFG_CHUNK];
+     char	line[CFG_LINE];
+     int	size = 0;		// characters in the line so far
+     int	found = 0;
+     bool	eof = false;
+
+     strcpy_P(filename, name);
+     cmd(VDIP_OPR, filename, DEFAULTTIMEOUT, 0);
+
+     _lengthsSet = 0;			// a new file gets the personality defaults again
+
+     for (int n = 0; !eof && n < CFG_MAXCHUNKS; n++) {
+
+	  memset(chunk, '\xFE', CFG_CHUNK);
+	  cmd(VDIP_RDF, chunk, DEFAULTTIMEOUT, CFG_CHUNK);
+
+	  for (int i = 0; i < CFG_CHUNK; i++) {
+	       char c = chunk[i];
+
+	       if (c == '\xFE' || c == '\0') {		// the end of the file
+		    eof = true;
+		    c = '\n';
+	       }
+
+	       if (c == '\r' || c == '\n') {
+		    if (size > 0 && size < CFG_LINE) {
+			 line[size] = '\0';
+			 found += configLine(line);
+		    }
+		    size = 0;
+		    if (eof) {
+			 break;
+		    }
+	       } else if (size < CFG_LINE) {
+		    if (size < CFG_LINE - 1) {
+			 line[size] = c;
+		    }
+		    size++;			// too long lines end up ignored
+	       }
+	  }
+     }
+
+     cmd(VDIP_CLF, filename, DEFAULTTIMEOUT, 0);
+
+     return(found);
+}
+
 //
 // processDisk() - called when a disk is discovered and properly located
 //                 on P2.  This routine does everything that the Chapr can
@@ -572,104 +912,78 @@ bool VDIP::readFile(char *filename, char *buf, byte numToRead, bool lineOnly)
 void VDIP::processDisk(portConfig *portConfigBuffer)
 {    
      char buf[BIGENOUGH];
+     unsigned long start = millis();
 
      // check that it's in port two (beep annoyingly otherwise)
 
      if(portConfigBuffer->port == 1) {
 
-       // read through VDIP stuff looking for a text file with the name, personality etc.
-
        // PLEASE NOTE -- FILE NAMES MUST BE FEWER THAN 8 CHARACTERS
 
-       // get the new name of the ChapR
+       if (readConfigFile(PSTR("chapr.cfg")) == 0) {
 
-       if(readFile("name.txt", buf, BIGENOUGH)){
-         if (buf[EEPROM_NAMELENGTH - 1] == '\0'){
-           myEEPROM.setName(buf);
-         }
-       }
-
-       // get the new personality
+	 // no chapr.cfg, so read through VDIP stuff looking for a text file for
+	 // each of the name, personality etc.
 
-       if(readFile("person.txt", buf, BIGENOUGH)){
-         byte newNum = (byte) atoi(buf);
-         if (newNum > 0 && newNum <= EEPROM_LASTPERSON){
-           myEEPROM.setPersonality(newNum);
-	   if (newNum == 1 || newNum == 3){ // is an FTC personality
-	     myEEPROM.setAutoLen(DEF_FTCAUTOLEN); // reset to defaults
-	     myEEPROM.setTeleLen(DEF_FTCTELELEN);
-	     myEEPROM.setEndLen(DEF_FTCENDLEN);
-	   }
-	   if (newNum == 4){ // is an FTC personality
-	     myEEPROM.setAutoLen(DEF_FRCAUTOLEN); // reset to defaults
-	     myEEPROM.setTeleLen(DEF_FRCTELELEN);
-	     myEEPROM.setEndLen(DEF_FRCENDLEN);
+	 if(readFile(PSTR("name.txt"), buf, BIGENOUGH)){
+	   if (buf[EEPROM_NAMELENGTH - 1] == '\0'){
+	     myEEPROM.setName(buf);
 	   }
 	 }
-       }
-
-       // get the power-down timeout
 
-       if(readFile("timeout.txt", buf, BIGENOUGH)){
-         byte newNum = (byte) atoi(buf);
-         myEEPROM.setTimeout(newNum);
-       }
-
-       // get the lag time
-
-       if(readFile("lag.txt", buf, BIGENOUGH)){
-	 myEEPROM.setSpeed((byte) atoi(buf));
-       }
+	 if(readFile(PSTR("person.txt"), buf, BIGENOUGH)){
+	   applySetting(CFG_PERSON, buf);
+	 }
 
-       // get the user mode
+	 if(readFile(PSTR("timeout.txt"), buf, BIGENOUGH)){
+	   applySetting(CFG_TIMEOUT, buf);
+	 }
 
-       if(readFile("mode.txt", buf, BIGENOUGH)){
-         byte newNum = (byte) atoi(buf);
-         myEEPROM.setMode(newNum);
-       }
+	 if(readFile(PSTR("lag.txt"), buf, BIGENOUGH)){
+	   applySetting(CFG_LAG, buf);
+	 }
 
-       // enable or disable match mode cycling
+	 if(readFile(PSTR("mode.txt"), buf, BIGENOUGH)){
+	   applySetting(CFG_MODE, buf);
+	 }
 
-       if(readFile("canMMode.txt", buf, BIGENOUGH)){
-         if (atoi(buf) == 0 || atoi(buf) == 1){
-	   myEEPROM.setMatchModeEnable(atoi(buf));
-	 } 
-       }
+	 if(readFile(PSTR("canMMode.txt"), buf, BIGENOUGH)){
+	   applySetting(CFG_MATCHMODE, buf);
+	 }
        
-       // allows user to determine number of seconds in autonomous, teleOp and endgame (ChapR3 of EEPROM)
-       // zero for either mode skips the mode
-
-       if(readFile("mConfig.txt",buf, BIGENOUGH)){
-	 char *ptr = buf;
-	 for (int i = 0; i < 3; i++){
-	   switch(i){
-	   case 0: myEEPROM.setAutoLen(atoi(ptr));break;
-	   case 1: myEEPROM.setTeleLen(atoi(ptr));break;
-	   case 2: myEEPROM.setEndLen(atoi(ptr));break;
-	   }
-	   while (*ptr != '\r' && *ptr != '\0' && *ptr != '\n'){
-	     ptr++;
-	   }
-	   while (*ptr == '\r' || *ptr == '\n'){
-	     ptr++;
-	   }
-	   if (*ptr == '\0'){
-	     break;
+	 // allows user to determine number of seconds in autonomous, teleOp and endgame (ChapR3 of EEPROM)
+	 // zero for either mode skips the mode
+
+	 if(readFile(PSTR("mConfig.txt"),buf, BIGENOUGH)){
+	   char *ptr = buf;
+	   for (int i = 0; i < 3; i++){
+	     switch(i){
+	     case 0: myEEPROM.setAutoLen(atoi(ptr));break;
+	     case 1: myEEPROM.setTeleLen(atoi(ptr));break;
+	     case 2: myEEPROM.setEndLen(atoi(ptr));break;
+	     }
+	     while (*ptr != '\r' && *ptr != '\0' && *ptr != '\n'){
+	       ptr++;
+	     }
+	     while (*ptr == '\r' || *ptr == '\n'){
+	       ptr++;
+	     }
+	     if (*ptr == '\0'){
+	       break;
+	     }
 	   }
 	 }
-       }
 
-       // get a target bluetooth connection name/ID AND connect if it is there
-       // this MAY need to be changed to do the connection AFTER getting
-       // done with the flash drive.  Note that this data IS NOT stored in
-       // the EEPROM - instead, it is just used as the current paired device
-       // and will be reset (like normal) whenever a new pairing is done.
+	 if(readFile(PSTR("tether.txt"), buf, BIGENOUGH)){
+	   applySetting(CFG_TETHER, buf);
+	 }
 
-       if(readFile("targetID.txt", buf, BIGENOUGH,true)){
-	    if (bt.addressFilter(buf,BIGENOUGH)) {	// useful address?
-		 bt.setRemoteAddress(buf);
-		 delay(100);
-	    }
+	 // this MAY need to be changed to do the connection AFTER getting
+	 // done with the flash drive.
+
+	 if(readFile(PSTR("targetID.txt"), buf, BIGENOUGH,true)){
+	   applySetting(CFG_TARGETID, buf);
+	 }
        }
 
 // TODO: make target.txt work - it should take a NAME and find the BT ID for it
@@ -684,11 +998,26 @@ void VDIP::processDisk(portConfig *portConfigBuffer)
 //	    }
 //       }
 
+       // everything read above only changed the settings in RAM, so they
+       // all go to EEPROM together here
+
+       myEEPROM.commit();
+
+       // logging goes to this same drive, once it has been read
+
+       if (myEEPROM.loggingIsEnabled()) {
+	    logAttach(this);
+       }
+
        // the confirm beep indicates that all files that existed were read
        // it doesn't confirm that all data was cool
 
        beeper.confirm();			 
 
+       Serial.print(F("flash drive read in "));
+       Serial.print(millis() - start);
+       Serial.println(F("ms"));
+
      } else {
 
        // the disk was put in the wrong USB port!
@@ -701,15 +1030,26 @@ void VDIP::processDisk(portConfig *portConfigBuffer)
 void VDIP::ejectDisk()
 {
   //Serial.println("ejected disk");
-  // we'll do interesting stuff here one day...
+  logDetach();
 }
 
+//
+// processNXT() - an NXT was plugged in.  Normally this means "pair with this NXT" - its
+//		  BT address is grabbed and the ChapR resets.  But with the USB tether
+//		  on, the NXT is simply driven over USB from now on (see nxt.cpp).
+//
 void VDIP::processNXT(portConfig *portConfigBuffer)
 {
 	  char *name;
 	  char *btAddress;
 	  long	freeMemory;
 
+	  if (myEEPROM.tetherIsEnabled()) {
+	       nxtTetherAttach(this,portConfigBuffer->usbDev);
+	       beeper.confirm();
+	       return;
+	  }
+
           if (myEEPROM.getResetStatus() == (byte) 0 && 
 	    nxtQueryDevice(this,portConfigBuffer->usbDev,&name,&btAddress,&freeMemory)){
               bt.setRemoteAddress(btAddress);
@@ -722,6 +1062,7 @@ void VDIP::processNXT(portConfig *portConfigBuffer)
 
 void VDIP::ejectNXT()
 {  
+     nxtTetherDetach();
      myEEPROM.setResetStatus(0);
 }
 
@@ -758,7 +1099,7 @@ void VDIP::ejectNXT()
 #define FTDIBAUD_115200	2
 
 // note that this table is tied directly to the defines above
-static char divisors[][2] = {
+static const char divisors[][2] PROGMEM = {
      { '\x38', '\x41' },	// 9600
      { '\x4E', '\xC0' },	// 38400
      { '\x1A', '\x00' }		// 115200
@@ -771,8 +1112,8 @@ int VDIP::tryFirePlugBaud(portConfig *portConfigBuffer, int rate)
 
      delay(100);	// a bit of time between loops for sure
 
-     cbuf[0] = divisors[rate][0];
-     cbuf[1] = divisors[rate][1];
+     cbuf[0] = pgm_read_byte(&divisors[rate][0]);
+     cbuf[1] = pgm_read_byte(&divisors[rate][1]);
 
      cmd(VDIP_FBD,cbuf,100,portConfigBuffer->usbDev);
 
@@ -798,7 +1139,7 @@ void VDIP::processKC4134(portConfig *portConfigBuffer)
      char    cbuf[50];   // arbritarily large buffer for command and response
      int    i;
 
-  Serial.println("now processing");
+  Serial.println(F("now processing"));
 
      if (myEEPROM.getResetStatus() != (byte) 0){
     // if we are being reset, then don't REprocess the FirePlug
@@ -940,20 +1281,119 @@ void VDIP::ejectFirePlug()
      myEEPROM.setResetStatus(0);
 }
 
+//
+// readJoysticks() - does a DRA, which gets the latest report from every HID device in
+//		     one go (the ChapR VDIP firmware polls them in the background).  Each
+//		     report comes as the device, a count of its reports, the size and then
+//		     the report - the size is zero if nothing new has come in.  The report
+//		     for the given port goes into databuf, and the one for the other port
+//		     is kept in _joyData for its getJoystick().
+//
+//	RETURNS: the size of the report for the port, -1 if the VDIP firmware doesn't
+//		 have DRA, -2 if the port's device isn't polled (not a HID device), or
+//		 -3 if the reports stopped coming in part way through.  For -3 the rest
+//		 of the reply is flushed, and nothing is kept for the other port.
+//
+int VDIP::readJoysticks(int num, char *databuf)
+{
+     int	entries;
+     int	count = -2;
+     int	other = 1 - num;
+     char	header[3];		// device, report count, size
+     char	scratch;
+     char	*target;
+     uint8_t	x;
+     bool	complete = true;
+
+     entries = cmd(VDIP_DRA,NULL,100);
+     if (entries < 0) {
+	  return(-1);
+     }
+
+     crumbs.vdip = VDIP_DRA | WD_VDIP_BUSY;
+
+     _joyPending &= ~(1 << other);
+
+     while (complete && entries--) {
+	  if (!readBytes(3,header,100)) {
+	       complete = false;
+	       break;
+	  }
+
+	  target = NULL;
+	  if ((uint8_t)header[0] == ports[num].usbDev) {
+	       target = databuf;
+	       count = (uint8_t)header[2];
+	  } else if ((uint8_t)header[0] == ports[other].usbDev) {
+	       target = _joyData;
+	       _joyCount = (uint8_t)header[2];
+	       _joyPending |= (1 << other);
+	  }
+
+	  // anything past VDIP_JOYSTICK is dropped, but the size is left alone so the
+	  // translator turns the report down
+
+	  for (x = 0; x < (uint8_t)header[2]; x++) {
+	       if (!readBytes(1,(target && x < VDIP_JOYSTICK)? target + x : &scratch,100)) {
+		    complete = false;
+		    break;
+	       }
+	  }
+     }
+
+     if (!complete) {
+	  _joyPending &= ~(1 << other);
+	  flush();
+	  count = -3;
+     }
+
+     crumbs.vdip &= ~WD_VDIP_BUSY;
+     return(count);
+}
+
 //
 // getJoyStick() - try to read data from the given joystick.  Assumes
-//		   that it is a Joystick!  (for now)
+//		   that it is a Joystick!  (for now)  databuf must have room for
+//		   VDIP_JOYSTICK bytes.
+//
+//		   With the ChapR VDIP firmware, one DRA gets both gamepads - the
+//		   report for the other one is kept for its call, since loop() asks
+//		   for both each time through.  Otherwise (or for a device the VDIP
+//		   doesn't poll) it is SC and DRD for each gamepad.  A port whose
+//		   device isn't polled (an Xbox 360 pad, say - it isn't HID) is
+//		   remembered, so it doesn't cost a useless DRA every time through
+//		   the loop - until deviceUpdate() sees the devices change.
 //
 
 int VDIP::getJoystick(int num, char *databuf)
 {
+     int	count;
+
 //     if (ports[num].usbDev >= 0 && ports[num].type == DEVICE_CONTROLLER) {
-     if (ports[num].usbDev >= 0) {
-	  cmd(VDIP_SC,NULL,100,ports[num].usbDev);
-	  return(cmd(VDIP_DRD,databuf,100));
-     } else {
+     if (ports[num].usbDev < 0) {
 	  return(0);		// if not a controller, return zero bytes
      }
+
+     if (!_noDRA && !(_notPolled & (1 << num))) {
+	  if (_joyPending & (1 << num)) {		// came in with the other gamepad's DRA
+	       _joyPending &= ~(1 << num);
+	       memcpy(databuf,_joyData,min(_joyCount,VDIP_JOYSTICK));
+	       return(_joyCount);
+	  }
+
+	  count = readJoysticks(num,databuf);
+	  if (count >= 0) {
+	       return(count);
+	  }
+	  if (count == -1) {
+	       _noDRA = true;
+	  } else if (count == -2) {
+	       _notPolled |= (1 << num);
+	  }				// -3 (a short read) is SC and DRD this time only
+     }
+
+     cmd(VDIP_SC,NULL,100,ports[num].usbDev);
+     return(cmd(VDIP_DRD,databuf,100));
 }
 
 //
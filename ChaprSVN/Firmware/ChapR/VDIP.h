@@ -48,6 +48,8 @@
 
 
 #define DEFAULTTIMEOUT 100
+#define VDIP_FILENAME	13	// 8.3 file name plus the null
+#define VDIP_JOYSTICK	20	// biggest gamepad report kept - MAXTRANSLATE in drivers.h
 
 
 #define CLASS_NONE      0x00
@@ -69,8 +71,11 @@ typedef enum vcmd {
      VDIP_OPR,                  // open a file for reading
      VDIP_RDF,                  // read from file (specifies how many bytes)
      VDIP_CLF,                  // closes the currently open file
+     VDIP_OPW,                  // open a file for writing (appends if it exists)
+     VDIP_WRF,                  // write to file - the arg is how many bytes from the buffer
      VDIP_FBD,                	// change the BAUD rate for FTDI (FirePlug)
-     VDIP_FWV                   // determine the firmware version of the VDIP
+     VDIP_FWV,                  // determine the firmware version of the VDIP
+     VDIP_DRA			// Data Read All - latest report from each HID device (ChapR VDIP firmware)
 } vdipcmd;
 
 typedef enum _deviceType {
@@ -103,6 +108,7 @@ public:
      VDIP(uint8_t clockPin, uint8_t mosiPin, uint8_t misoPin, uint8_t csPin, uint8_t csReset);
      bool deviceUpdate();
      bool deviceCheck();
+     void rescan();
      bool sync();
      void flush(int = 100);
      int getJoystick(int, char *);
@@ -112,6 +118,8 @@ public:
      void reset();
      bool portConnection(int,int*,unsigned short *,unsigned short *);
      bool firePlugBtId(VDIP *vdip, int usbDev, char **btAddress);
+     bool configLine(char *line);
+     bool printConfig(char *key);
 
 private:
      uint8_t _resetPin;
@@ -121,10 +129,19 @@ private:
      int  _resetDelay;	// we've been reset, and are still in reset mode (set by reset())
      unsigned long _resetTarget;	// target time before out of reset (set by reset())
 
+     bool _noDRA;			// the VDIP firmware answered DRA with "BC" - use SC and DRD
+     uint8_t _joyPending;		// ports (bit 0 is port 1) with a report waiting in _joyData
+     uint8_t _notPolled;		// ports whose device DRA doesn't cover (not HID) - use SC and DRD
+     int  _joyCount;
+     char _joyData[VDIP_JOYSTICK];
+     uint8_t _lengthsSet;		// match lengths (bits by cfgSetting) set since the last config file
+
      bool readBytes(int count, char *, int);
      bool sendBytes(int count, const char *, int);
-     bool readFile(char *name, char *buf, byte numToRead, bool lineOnly = false);
+     bool readFile(PGM_P name, char *buf, byte numToRead, bool lineOnly = false);
      void processDisk(portConfig *portConfigBuffer);
+     int  readConfigFile(PGM_P name);
+     void applySetting(int which, char *value);
      void ejectDisk();
      void processFirePlug(portConfig *portConfigBuffer);
      void processKC4134(portConfig *portConfigBuffer);
@@ -132,6 +149,7 @@ private:
      void processNXT(portConfig *);
      void ejectNXT();
      void init();
+     int  readJoysticks(int, char *);
 
 #ifdef DEBUG
      void DEBUG_PORT_CONFIG(portConfig *);
@@ -153,4 +171,4 @@ private:
 
 
 
-
+
@@ -18,7 +18,11 @@
 VDIP::VDIP(uint8_t clockPin, uint8_t mosiPin, uint8_t misoPin, uint8_t csPin, uint8_t resetPin) :
     VDIPSPI(clockPin,mosiPin,misoPin,csPin),
     _resetPin(resetPin),
-    _resetDelay(false)
+    _resetDelay(false),
+    _noDRA(false),
+    _joyPending(0),
+    _notPolled(0),
+    _lengthsSet(0)
 {
      digitalWrite(_resetPin,HIGH);   // low is reset, done before shifting to output mode
      pinMode(_resetPin,OUTPUT);
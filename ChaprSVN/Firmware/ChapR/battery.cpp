@@ -0,0 +1,184 @@
+//
+// battery.cpp
+//
+//   The battery is on BATTERY_MONITOR, through a resistor network that divides
+//   it by two.  Instead of an analogRead() (110us, blocking) every loop, the
+//   ADC is set to start a conversion on its own every time timer0 overflows
+//   (about 1000 times a second - timer0 is always running for millis()) and
+//   the ADC interrupt adds each reading into a block of BATTERY_BLOCK readings.
+//
+//   The interrupt does nothing else, to stay short (SoftwareSerial doesn't
+//   like to be held up).  batteryUpdate(), called from loop(), picks up the
+//   finished blocks and runs them through an exponential moving average with
+//   a time constant of about a second, which smooths out the dips when the BT
+//   module transmits.  Going "low" has hysteresis so that the power LED
+//   doesn't flicker between normal and fast as the battery sags.
+//
+//   The runtime estimate comes from how fast the (filtered) voltage is
+//   dropping, measured every BATTERY_SLOPE_EVERY and itself averaged.  It is
+//   only an estimate - 9v batteries don't discharge in a straight line - but
+//   it is good enough to swap a battery before a match instead of during one.
+//
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include "config.h"
+#include "battery.h"
+
+#define BATTERY_BLOCK		64		// readings per block (64 x 1023 fits an unsigned int)
+#define BATTERY_EMA_SHIFT	4		// average over 16 blocks - about a second
+#define BATTERY_SLOPE_EVERY	60000		// ms between slope measurements
+#define BATTERY_SLOPE_SHIFT	2		// average the slope over 4 of them
+#define BATTERY_SLOPE_MIN	3		// measurements before there is an estimate
+
+static volatile unsigned int	batterySum;	// the block being added up (ISR only)
+static volatile byte		batteryCount;
+static volatile unsigned int	batteryBlock;	// the last finished block
+static volatile bool		batteryFresh;	// batteryBlock hasn't been picked up yet
+
+static long	filtered = -1;			// filtered block << BATTERY_EMA_SHIFT (-1 until the first)
+static int	millivolts;
+static bool	low = false;
+
+static unsigned long	lastSlope;
+static int		lastMillivolts;
+static long		slope;			// mV/minute << BATTERY_SLOPE_SHIFT
+static byte		slopeCount;
+
+//
+// The conversions are kicked off by timer0 overflowing - the ADC triggers on the
+// overflow flag going up, and the timer0 overflow interrupt (millis()) clears it.
+//
+ISR(ADC_vect)
+{
+     batterySum += ADC;
+     if (++batteryCount == BATTERY_BLOCK) {
+	  batteryBlock = batterySum;
+	  batteryFresh = true;
+	  batterySum = 0;
+	  batteryCount = 0;
+     }
+}
+
+//
+// batteryStart() - start the ADC sampling the battery.  After this, analogRead() must
+//		    not be used, it would fight with the interrupt over the ADC.
+//
+void batteryStart()
+{
+     ADMUX = (1<<REFS0) | ((BATTERY_MONITOR - A0) & 0x07);		// AVcc reference
+     ADCSRB = (1<<ADTS2);						// trigger: timer0 overflow
+     ADCSRA = (1<<ADEN) | (1<<ADATE) | (1<<ADIE) | (1<<ADPS2) | (1<<ADPS1) | (1<<ADPS0); // 125kHz
+}
+
+//
+// batteryUpdate() - called every loop() to pick up a new block if there is one.  Most of
+//		     the time there isn't, and this returns right away.
+//
+void batteryUpdate()
+{
+     unsigned int	block;
+
+     if (!batteryFresh) {
+	  return;
+     }
+
+     cli();
+     block = batteryBlock;
+     batteryFresh = false;
+     sei();
+
+     if (filtered < 0) {
+	  filtered = (long) block << BATTERY_EMA_SHIFT;
+	  lastSlope = millis();
+     } else {
+	  filtered += block - (filtered >> BATTERY_EMA_SHIFT);
+     }
+
+     // a block is BATTERY_BLOCK readings of 5v/1024, of half the battery voltage
+
+     millivolts = (int) (((filtered >> BATTERY_EMA_SHIFT) * 10000L) >> 16);
+
+     if (low) {
+	  low = (millivolts <= BATTERY_OK * 100);
+     } else {
+	  low = (millivolts < BATTERY_LOW * 100);
+     }
+
+     if (millis() - lastSlope >= BATTERY_SLOPE_EVERY) {
+	  long drop = (long) (lastMillivolts - millivolts) << BATTERY_SLOPE_SHIFT;
+
+	  if (slopeCount == 1) {			// the first drop starts the average
+	       slope = drop;
+	  } else if (slopeCount > 1) {
+	       slope += (drop - slope) >> BATTERY_SLOPE_SHIFT;
+	  }
+	  if (slopeCount < BATTERY_SLOPE_MIN) {
+	       slopeCount++;
+	  }
+	  lastMillivolts = millivolts;
+	  lastSlope = millis();
+     }
+}
+
+//
+// batteryVoltage() - the filtered voltage (x10), 0 for the first few ms after start.
+//
+int batteryVoltage()
+{
+     return(millivolts / 100);
+}
+
+int batteryMillivolts()
+{
+     return(millivolts);
+}
+
+bool batteryLow()
+{
+     return(low);
+}
+
+//
+// batteryMinutesLeft() - until the battery is down to BATTERY_EMPTY at the rate it has
+//			  been dropping.  -1 if there isn't an estimate (yet), or the
+//			  voltage isn't dropping.
+//
+int batteryMinutesLeft()
+{
+     long	left;
+
+     if (slopeCount < BATTERY_SLOPE_MIN || slope <= 0) {
+	  return(-1);
+     }
+
+     left = ((long) (millivolts - BATTERY_EMPTY * 100) << BATTERY_SLOPE_SHIFT) / slope;
+     return((left < 0)? 0 : (int) min(left, 32767L));
+}
+
+bool batteryRunningOut()
+{
+     int	left = batteryMinutesLeft();
+
+     return(left >= 0 && left < BATTERY_WARN_MINUTES);
+}
+
+void batteryPrint()
+{
+     int	left = batteryMinutesLeft();
+
+     Serial.print(F("battery "));
+     Serial.print(millivolts / 1000);
+     Serial.print(F("."));
+     Serial.print((millivolts / 100) % 10);
+     Serial.print(F("v"));
+     if (low) {
+	  Serial.print(F(" (low)"));
+     }
+     if (left >= 0) {
+	  Serial.print(F(", about "));
+	  Serial.print(left);
+	  Serial.print(F(" min left"));
+     }
+     Serial.println();
+}
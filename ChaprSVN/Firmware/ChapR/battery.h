@@ -0,0 +1,27 @@
+//
+// battery.h
+//
+//   Background battery monitoring (see battery.cpp).  The ADC samples the
+//   battery on its own, so checking the battery costs nothing in loop().
+//   Voltages are in tenths of a volt (90 is 9 volts), like they always
+//   have been on the ChapR.
+//
+
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#define BATTERY_LOW		64	// the battery goes "low" under 6.4 volts...
+#define BATTERY_OK		66	// ...and stays low until it is back over 6.6
+#define BATTERY_EMPTY		60	// where the runtime estimate counts down to
+#define BATTERY_WARN_MINUTES	15	// batteryRunningOut() with less than this left
+
+extern void batteryStart();
+extern void batteryUpdate();
+extern int  batteryVoltage();
+extern int  batteryMillivolts();
+extern bool batteryLow();
+extern int  batteryMinutesLeft();
+extern bool batteryRunningOut();
+extern void batteryPrint();
+
+#endif BATTERY_H
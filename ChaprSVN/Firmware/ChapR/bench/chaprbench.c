@@ -0,0 +1,850 @@
+//
+// chaprbench.c
+//
+//   A test bench that runs the real ChapR image (the pro5v328 build with -DSIMAVR,
+//   see simavr.c and the "bench" target in ../Makefile) in simavr, with models of
+//   what is wired to it on the V02 board (see config.h):
+//
+//	VDIP	- the SPI slave on pins 6-10 that VDIPSPI bit-bangs, answering the
+//		  short command set (E, SCS, QP, QD, SC, DRD, DRA, DSD, FWV, SUM).
+//		  One Logitech F310 is plugged into port 1, and the VDIP polls it in
+//		  the background, so it comes back in DRA like with the ChapR VDIP
+//		  firmware.  There is no flash drive, so the file commands fail.
+//	RN-42	- the UART on pins 12 (to the ChapR) and 13 (from it), at 9600 or
+//		  38400 baud as BT_9600BAUD says, with its command mode ($$$ to ---)
+//		  and the BT_CONNECTED line, which goes up at the -c time.  Once
+//		  connected, NXT direct commands that want a reply get a short one,
+//		  as if a brick was there (MessageRead always finds the mailbox empty).
+//
+//   The buttons are held up and the battery at 9V.  The settings are put in the
+//   EEPROM in the legacy layout (see settings.h), which the firmware migrates when
+//   it boots.  At the end it reports, with cycle accuracy:
+//
+//	- the loop() period, from the PHASE() markers in GPIOR0 (see debug.h), and
+//	  how that time is split among the phases
+//	- how much of the time the CPU was asleep (SLEEP_MODE_IDLE in idleFor(),
+//	  see power.cpp), in each phase and overall
+//	- the time from one BT frame to the next once connected (a frame is a
+//	  burst of bytes with at least BT_FRAME_IDLE between them)
+//
+//   Everything is measured from the first time through loop(), so setup() isn't
+//   counted.
+//
+//   The models and the measurements are checked on the host by "make check" (see
+//   check.c), which drives them the way the image would through a stand-in for the
+//   simavr calls used here.
+//
+//   Usage: chaprbench [-c ms] [-m ms] [-p personality] [-v] ChapR.elf
+//
+//	-c	when BT connects (default 3500, after setup() is done)
+//	-m	run this long (default 10000)
+//	-p	personality to put in the EEPROM (default 4, as in config.h)
+//	-v	show the ChapR's serial console output
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef BENCH_CHECK			// check.c has its own stand-ins for these
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "sim_cycle_timers.h"
+#include "avr_ioport.h"
+#include "avr_adc.h"
+#include "avr_eeprom.h"
+#include "avr_uart.h"
+#endif
+
+#define GPIOR0_ADDR		0x3E	// data space address of GPIOR0 on the 328
+
+#define PHASE_COUNT		5	// PHASE_IDLE through PHASE_PERSONALITY (see debug.h)
+#define PHASE_LOOP		1
+
+static const char *phaseNames[PHASE_COUNT] = {	// in PHASE_ order
+     "idle", "loop", "gamepad", "device", "personality"
+};
+
+#define HID_PERIOD		8000	// us - an F310 sends a report every 8ms
+#define HID_REPORT		8	// bytes in an F310 report
+#define BT_FRAME_IDLE		500	// us - quiet this long on the BT line ends a frame
+#define VDIP_QUEUE		512	// bytes the VDIP can have waiting to be read
+#define BT_QUEUE		256	// bytes the RN-42 can have waiting to go to the ChapR
+
+static avr_t	*avr;
+
+//
+// measure - min/average/max of a measurement
+//
+typedef struct {
+     long	count;
+     double	min, max, sum;
+} measure;
+
+static void measureAdd(measure *s, double value)
+{
+     if (s->count == 0 || value < s->min) {
+	  s->min = value;
+     }
+     if (s->count == 0 || value > s->max) {
+	  s->max = value;
+     }
+     s->sum += value;
+     s->count++;
+}
+
+static void measurePrint(const char *name, measure *s, const char *units)
+{
+     if (s->count == 0) {
+	  printf("%-18s none\n", name);
+	  return;
+     }
+     printf("%-18s min %8.3f  avg %8.3f  max %8.3f %s  (%ld)\n",
+	    name, s->min, s->sum / s->count, s->max, units, s->count);
+}
+
+static double cyclesToMs(avr_cycle_count_t cycles)
+{
+     return(cycles * 1000.0 / avr->frequency);
+}
+
+static avr_cycle_count_t usToCycles(unsigned long us)
+{
+     return((avr_cycle_count_t) avr->frequency * us / 1000000);
+}
+
+//
+// pin() - the simavr IRQ for a port pin, which is how the models see and drive it
+//
+static avr_irq_t *pin(char port, int bit)
+{
+     return(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(port), bit));
+}
+
+//
+// THE MEASUREMENTS
+//
+static avr_cycle_count_t measureFrom;		// the first time through loop(), 0 before
+
+static struct {
+     int		current;		// the phase now
+     avr_cycle_count_t	since;			// when it started
+     avr_cycle_count_t	lastLoop;		// when loop() last started
+     avr_cycle_count_t	time[PHASE_COUNT];	// total time spent in each phase
+     avr_cycle_count_t	asleep[PHASE_COUNT];	// and how much of it the CPU was asleep
+     measure		period;			// ms from one loop() to the next
+} phase;
+
+//
+// phaseWrite() - GPIOR0 was written by PHASE()
+//
+static void phaseWrite(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+     avr_cycle_count_t	now = avr->cycle;
+
+     if (measureFrom) {
+	  phase.time[phase.current] += now - phase.since;
+     }
+
+     if (value == PHASE_LOOP) {
+	  if (!measureFrom) {
+	       measureFrom = now;
+	  } else {
+	       measureAdd(&phase.period, cyclesToMs(now - phase.lastLoop));
+	  }
+	  phase.lastLoop = now;
+     }
+
+     phase.current = (value < PHASE_COUNT)? value : 0;
+     phase.since = now;
+}
+
+//
+// phaseAsleep() - the CPU slept (idleFor() in power.cpp) for this many cycles.  Nothing
+//		   runs while it sleeps, so it's all in the phase it went to sleep in.
+//
+static void phaseAsleep(avr_cycle_count_t cycles)
+{
+     if (measureFrom) {
+	  phase.asleep[phase.current] += cycles;
+     }
+}
+
+//
+// THE GAMEPADS - one can be plugged into each port.  They are USB devices 0 and 1.
+//		  The stick and buttons stay put.
+//
+static struct {
+     int		plugged;
+     avr_cycle_count_t	pluggedAt;
+     long		lastSent;		// report number last handed to the ChapR
+     int		x, y;			// left stick, -128 to 127
+     int		buttons;		// 12 buttons, bit 0 is button 1
+} pads[2];
+
+static long padReportNumber(int port)
+{
+     return((avr->cycle - pads[port].pluggedAt) / usToCycles(HID_PERIOD) + 1);
+}
+
+static void padReport(int port, uint8_t *report)
+{
+     report[0] = pads[port].x + 128;
+     report[1] = pads[port].y + 128;
+     report[2] = 128;
+     report[3] = 128;
+     report[4] = ((pads[port].buttons & 0x0F) << 4) | 0x08;	// 0x08 - tophat not pressed
+     report[5] = pads[port].buttons >> 4;
+     report[6] = 0;
+     report[7] = 0xFF;
+}
+
+//
+// THE VDIP - each SPI transfer is a start bit, read/write, status/data, eight data bits
+//	      (MSB first) and a status bit, all clocked in on the rising edge.  The VDIP
+//	      puts its bits on MISO after the rising edge before the ChapR reads them.
+//
+static struct {
+     int	cs, mosi;
+     int	bit;				// rising edges since CS went up
+     int	read;				// ChapR is reading (rather than writing)
+     int	status;				// status register (rather than data)
+     uint8_t	in;				// byte the ChapR is writing
+     uint8_t	out;				// byte the ChapR is reading
+     int	fresh;				// out is new data
+
+     uint8_t	cmd[32];			// the command coming in
+     int	cmdSize;
+     int	dataLeft;			// DSD/WRF data still to come after the command
+     const char	*afterData;			// and what to say when it has
+
+     uint8_t	queue[VDIP_QUEUE];		// bytes waiting to be read
+     unsigned	head, tail;
+
+     int	current;			// device set by SC
+} vdip;
+
+static void vdipSend(const void *data, int size)
+{
+     const uint8_t	*p = (const uint8_t *) data;
+
+     while (size-- > 0 && vdip.tail - vdip.head < VDIP_QUEUE) {
+	  vdip.queue[vdip.tail++ % VDIP_QUEUE] = *p++;
+     }
+}
+
+static void vdipPrompt()
+{
+     vdipSend(">\r", 2);
+}
+
+//
+// vdipCmdSize() - the binary commands are a fixed size (their arguments can be a \r),
+//		   the rest end with a \r.  Returns 0 for those.
+//
+static int vdipCmdSize(uint8_t first)
+{
+     switch(first) {
+     case 0x83:				// DSD
+     case 0x85:				// QD
+     case 0x86:	return(4);		// SC
+     case 0x08:				// WRF
+     case 0x0B:	return(7);		// RDF
+     case 0x18:	return(6);		// FBD
+     }
+     return(0);
+}
+
+static void vdipCommand()
+{
+     uint8_t	*c = vdip.cmd;
+     uint8_t	buf[32];
+     uint8_t	report[HID_REPORT];
+     int	i, count;
+
+     if (vdip.cmdSize == 2 && (c[0] == 'E' || c[0] == 'e')) {	// the echo used to sync
+	  vdipSend(c, 2);
+	  return;
+     }
+     if (vdip.cmdSize == 4 && (memcmp(c, "SCS\r", 4) == 0 || memcmp(c, "ECS\r", 4) == 0)) {
+	  vdipPrompt();
+	  return;
+     }
+
+     switch(c[0]) {
+     case 0x2B:				// QP1
+     case 0x2C:				// QP2
+	  buf[0] = pads[c[0] - 0x2B].plugged? 0x08 : 0x00;	// HID
+	  buf[1] = 0;
+	  vdipSend(buf, 2);
+	  vdipPrompt();
+	  break;
+
+     case 0x85:				// QD - see DEV_ in VDIP.h
+	  memset(buf, 0, sizeof(buf));
+	  if (c[2] < 2 && pads[c[2]].plugged) {
+	       buf[0] = c[2] + 1;	// address
+	       buf[7] = 0x08;		// type - HID
+	       buf[9] = c[2] + 1;	// location - the port
+	       buf[11] = 0x03;		// class - HID
+	       buf[14] = 0x6D;		// VID 046D
+	       buf[15] = 0x04;
+	       buf[16] = 0x16;		// PID C216
+	       buf[17] = 0xC2;
+	       buf[20] = 2;		// low speed
+	  }
+	  vdipSend(buf, 32);
+	  vdipPrompt();
+	  break;
+
+     case 0x86:				// SC
+	  vdip.current = c[2];
+	  vdipPrompt();
+	  break;
+
+     case 0x84:				// DRD - the latest report, if there is a new one
+	  i = vdip.current;
+	  if (i < 2 && pads[i].plugged && padReportNumber(i) != pads[i].lastSent) {
+	       pads[i].lastSent = padReportNumber(i);
+	       padReport(i, report);
+	       vdipSend("\x08\r", 2);
+	       vdipSend(report, HID_REPORT);
+	  } else {
+	       vdipSend("\x00\r", 2);
+	  }
+	  vdipPrompt();
+	  break;
+
+     case 0x9B:				// DRA - see cmd_dra() in the VDIP firmware
+	  count = pads[0].plugged + pads[1].plugged;
+	  buf[0] = count;
+	  buf[1] = '\r';
+	  vdipSend(buf, 2);
+	  for (i = 0; i < 2; i++) {
+	       if (!pads[i].plugged) {
+		    continue;
+	       }
+	       buf[0] = i;
+	       buf[1] = padReportNumber(i);
+	       buf[2] = (padReportNumber(i) != pads[i].lastSent)? HID_REPORT : 0;
+	       vdipSend(buf, 3);
+	       if (buf[2]) {
+		    pads[i].lastSent = padReportNumber(i);
+		    padReport(i, report);
+		    vdipSend(report, HID_REPORT);
+	       }
+	  }
+	  vdipPrompt();
+	  break;
+
+     case 0x83:				// DSD - the data comes after the command
+	  vdip.dataLeft = c[2];
+	  vdip.afterData = ">\r";
+	  break;
+
+     case 0x08:				// WRF - same, but there is no disk to write to
+	  vdip.dataLeft = (c[4] << 8) | c[5];
+	  vdip.afterData = "CF\r";
+	  break;
+
+     case 0x09:				// OPW
+     case 0x0A:				// CLF
+     case 0x0B:				// RDF
+     case 0x0E:				// OPR
+	  vdipSend("CF\r", 3);
+	  break;
+
+     case 0x13:				// FWV
+	  vdipSend("\rMAIN 03.69-VDAPF\rRPRG 1.00R\r", 29);
+	  vdipPrompt();
+	  break;
+
+     case 0x17:				// SUM
+     case 0x18:				// FBD
+	  vdipPrompt();
+	  break;
+
+     default:
+	  vdipSend("BC\r", 3);
+	  break;
+     }
+
+     if (vdip.dataLeft == 0 && vdip.afterData) {
+	  vdipSend(vdip.afterData, strlen(vdip.afterData));
+     }
+     if (vdip.dataLeft == 0) {
+	  vdip.afterData = NULL;
+     }
+}
+
+//
+// vdipByte() - a byte written by the ChapR
+//
+static void vdipByte(uint8_t c)
+{
+     int	size;
+
+     if (vdip.dataLeft) {
+	  if (--vdip.dataLeft == 0) {
+	       vdipSend(vdip.afterData, strlen(vdip.afterData));
+	       vdip.afterData = NULL;
+	  }
+	  return;
+     }
+
+     if (vdip.cmdSize < (int) sizeof(vdip.cmd)) {
+	  vdip.cmd[vdip.cmdSize++] = c;
+     }
+
+     size = vdipCmdSize(vdip.cmd[0]);
+     if ((size && vdip.cmdSize == size) || (!size && c == '\r')) {
+	  vdipCommand();
+	  vdip.cmdSize = 0;
+     }
+}
+
+static void vdipMiso(int value)
+{
+     avr_raise_irq(pin('B', 0), value? 1 : 0);
+}
+
+static void vdipCs(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+     vdip.cs = value;
+     vdip.bit = 0;
+}
+
+static void vdipMosi(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+     vdip.mosi = value;
+}
+
+static void vdipClock(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+     int	bit;
+
+     if (!value || !vdip.cs) {
+	  return;			// rising edges with CS up only
+     }
+
+     bit = vdip.bit++;
+
+     if (bit == 1) {
+	  vdip.read = vdip.mosi;
+
+     } else if (bit == 2) {
+	  vdip.status = vdip.mosi;
+	  vdip.in = 0;
+	  if (vdip.read) {
+	       if (vdip.status) {
+		    vdip.out = 0;	// nothing to report in the status register
+		    vdip.fresh = 1;
+	       } else {
+		    vdip.fresh = (vdip.head != vdip.tail);
+		    vdip.out = vdip.fresh? vdip.queue[vdip.head % VDIP_QUEUE] : 0xFF;
+	       }
+	       vdipMiso(vdip.out & 0x80);
+	  }
+
+     } else if (bit >= 3 && bit <= 10) {
+	  if (vdip.read) {
+	       vdipMiso((bit < 10)? vdip.out & (0x80 >> (bit - 2)) : !vdip.fresh);
+	  } else {
+	       vdip.in = (vdip.in << 1) | vdip.mosi;
+	       if (bit == 10) {
+		    vdipMiso(0);		// always room for it
+	       }
+	  }
+
+     } else if (bit == 11) {
+	  if (vdip.read) {
+	       if (vdip.fresh && !vdip.status) {
+		    vdip.head++;
+	       }
+	  } else if (!vdip.status) {
+	       vdipByte(vdip.in);
+	  }
+     }
+}
+
+static void vdipReset(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+     if (!value) {			// low is reset
+	  vdip.head = vdip.tail = 0;
+	  vdip.cmdSize = 0;
+	  vdip.dataLeft = 0;
+	  vdip.afterData = NULL;
+	  vdipSend("Ver 03.69VDAPF On-Line:\r", 24);
+     }
+}
+
+//
+// THE RN-42 - bytes from the ChapR are sampled in the middle of each bit, and bytes
+//	       to it are clocked out on pin 12 a bit at a time.
+//
+static struct {
+     int		tx;			// the ChapR's TX line
+     int		baud9600;		// BT_9600BAUD is up
+     int		connected;
+
+     int		receiving;		// in the middle of a byte from the ChapR
+     int		inBits;
+     uint8_t		inByte;
+     avr_cycle_count_t	byteStart;
+
+     int		dollars;		// $'s in a row (three is command mode)
+     int		cmdMode;
+     char		line[64];
+     int		lineSize;
+
+     uint8_t		frame[256];		// the frame coming in once connected
+     int		frameSize;
+     avr_cycle_count_t	frameStart;
+     measure		period;			// ms from one frame to the next
+     long		frames;
+     long		bytes;
+
+     uint8_t		queue[BT_QUEUE];	// bytes going to the ChapR
+     unsigned		head, tail;
+     int		sending;
+     unsigned		outBits;
+     int		outLeft;
+} bt;
+
+static avr_cycle_count_t btBit()
+{
+     return(avr->frequency / (bt.baud9600? 9600 : 38400));
+}
+
+static avr_cycle_count_t btSendBit(struct avr_t *avr, avr_cycle_count_t when, void *param)
+{
+     if (bt.outLeft == 0) {
+	  if (bt.head == bt.tail) {
+	       bt.sending = 0;
+	       return(0);
+	  }
+	  bt.outBits = (bt.queue[bt.head++ % BT_QUEUE] << 1) | 0x200;	// start, 8 data, stop
+	  bt.outLeft = 10;
+     }
+
+     avr_raise_irq(pin('B', 4), bt.outBits & 1);
+     bt.outBits >>= 1;
+     bt.outLeft--;
+
+     return(when + btBit());
+}
+
+static void btSend(const void *data, int size)
+{
+     const uint8_t	*p = (const uint8_t *) data;
+
+     while (size-- > 0 && bt.tail - bt.head < BT_QUEUE) {
+	  bt.queue[bt.tail++ % BT_QUEUE] = *p++;
+     }
+     if (!bt.sending) {
+	  bt.sending = 1;
+	  avr_cycle_timer_register(avr, 1, btSendBit, NULL);
+     }
+}
+
+//
+// btFrameEnd() - nothing for BT_FRAME_IDLE, so the frame is done.  A direct command
+//		  that wants a reply (an NXT telegram is the size, then the type) gets a
+//		  short one with just the status.
+//
+static avr_cycle_count_t btFrameEnd(struct avr_t *avr, avr_cycle_count_t when, void *param)
+{
+     uint8_t	*f = bt.frame;
+     uint8_t	reply[5] = { 3, 0, 0x02, 0, 0x00 };
+
+     if (bt.frameSize >= 4 && f[0] + (f[1] << 8) == bt.frameSize - 2 && f[2] == 0x00) {
+	  reply[3] = f[3];
+	  if (f[3] == 0x13) {
+	       reply[4] = 0x40;		// MessageRead - the mailbox is empty
+	  }
+	  if (f[3] == 0x11) {
+	       reply[4] = 0xEC;		// GetCurrentProgramName - nothing running
+	  }
+	  btSend(reply, sizeof(reply));
+     }
+
+     bt.frameSize = 0;
+     return(0);
+}
+
+static void btFrameByte(uint8_t c)
+{
+     if (bt.frameSize == 0) {
+	  if (bt.frameStart && measureFrom) {
+	       measureAdd(&bt.period, cyclesToMs(bt.byteStart - bt.frameStart));
+	  }
+	  if (measureFrom) {
+	       bt.frames++;
+	  }
+	  bt.frameStart = bt.byteStart;
+     }
+     if (bt.frameSize < (int) sizeof(bt.frame)) {
+	  bt.frame[bt.frameSize++] = c;
+     }
+     if (measureFrom) {
+	  bt.bytes++;
+     }
+     avr_cycle_timer_register(avr, usToCycles(BT_FRAME_IDLE), btFrameEnd, NULL);
+}
+
+//
+// btByte() - a byte from the ChapR.  Until connected, only the command mode matters.
+//
+static void btByte(uint8_t c)
+{
+     if (bt.connected && !bt.cmdMode) {
+	  btFrameByte(c);
+	  return;
+     }
+
+     if (!bt.cmdMode) {
+	  bt.dollars = (c == '$')? bt.dollars + 1 : 0;
+	  if (bt.dollars == 3) {
+	       bt.dollars = 0;
+	       bt.cmdMode = 1;
+	       bt.lineSize = 0;
+	       btSend("CMD\r\n", 5);
+	  }
+	  return;
+     }
+
+     if (c != '\r' && c != '\n') {
+	  if (bt.lineSize < (int) sizeof(bt.line) - 1) {
+	       bt.line[bt.lineSize++] = c;
+	  }
+	  return;
+     }
+
+     bt.line[bt.lineSize] = '\0';
+     if (bt.lineSize == 0) {
+	  return;
+     }
+     bt.lineSize = 0;
+
+     if (strcmp(bt.line, "---") == 0) {
+	  btSend("END\r\n", 5);
+	  bt.cmdMode = 0;
+     } else {
+	  btSend("AOK\r\n", 5);
+	  if (strncmp(bt.line, "U,", 2) == 0) {
+	       bt.cmdMode = 0;		// U also leaves command mode
+	  }
+     }
+}
+
+static avr_cycle_count_t btSample(struct avr_t *avr, avr_cycle_count_t when, void *param)
+{
+     if (bt.inBits < 8) {
+	  bt.inByte |= bt.tx << bt.inBits++;
+	  return(when + btBit());
+     }
+
+     bt.receiving = 0;
+     if (bt.tx) {			// a good stop bit
+	  btByte(bt.inByte);
+     }
+     return(0);
+}
+
+static void btTx(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+     bt.tx = value? 1 : 0;
+
+     if (!bt.tx && !bt.receiving) {	// start bit
+	  bt.receiving = 1;
+	  bt.inBits = 0;
+	  bt.inByte = 0;
+	  bt.byteStart = avr->cycle;
+	  avr_cycle_timer_register(avr, btBit() * 3 / 2, btSample, NULL);
+     }
+}
+
+static void btBaud(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+     bt.baud9600 = value;
+}
+
+static void btConnect(int on)
+{
+     bt.connected = on;
+     avr_raise_irq(pin('D', 3), on);
+}
+
+//
+// THE BUTTONS AND THE BATTERY - just held where a ChapR sitting on the bench has them
+//
+static void holdInputs()
+{
+     avr_raise_irq(pin('C', 0), 0);		// WFS button (pull-down) - up
+     avr_raise_irq(pin('C', 5), 1);		// power button (inverted) - up
+     avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC6), 9000 / 2);	// half the battery
+}
+
+//
+// settingsEEPROM() - put the settings in the EEPROM in the legacy layout (see settings.h)
+//		      so the ChapR boots without the board bring-up.
+//
+static void settingsEEPROM(int personality)
+{
+     uint8_t		ee[64];
+     avr_eeprom_desc_t	desc;
+
+     memset(ee, 0, sizeof(ee));
+     strcpy((char *) ee + 0, "ChapRBench");		// EEPROM_NAME
+     ee[16] = 10;					// EEPROM_TIMEOUT (minutes)
+     ee[17] = personality;				// EEPROM_PERSONALITY
+     memcpy(ee + 18, "Chap3", 6);			// EEPROM_MAGIC, with its null
+     ee[25] = 0;					// EEPROM_SPEED (lag)
+     ee[26] = 1;					// EEPROM_MODE (teleop)
+     ee[27] = 0;					// EEPROM_TETHER
+     ee[36] = 15;					// EEPROM_AUTOLEN
+     ee[37] = 135;					// EEPROM_TELELEN
+     ee[38] = 20;					// EEPROM_ENDLEN
+     ee[39] = 1;					// EEPROM_MATCHMODE
+
+     desc.ee = ee;
+     desc.offset = 0;
+     desc.size = sizeof(ee);
+     avr_ioctl(avr, AVR_IOCTL_EEPROM_SET, &desc);
+}
+
+static void attach()
+{
+     avr_irq_register_notify(pin('D', 6), vdipClock, NULL);		// VDIP_CLOCK (6)
+     avr_irq_register_notify(pin('D', 7), vdipMosi, NULL);		// VDIP_MOSI (7)
+     avr_irq_register_notify(pin('B', 1), vdipCs, NULL);		// VDIP_CS (9)
+     avr_irq_register_notify(pin('B', 2), vdipReset, NULL);		// VDIP_RESET (10)
+     avr_irq_register_notify(pin('B', 5), btTx, NULL);			// BT_TX (13)
+     avr_irq_register_notify(pin('D', 5), btBaud, NULL);		// BT_9600BAUD (5)
+
+     avr_irq_register_notify(avr_iomem_getirq(avr, GPIOR0_ADDR, "PHASE", 8), phaseWrite, NULL);
+
+     avr_raise_irq(pin('B', 4), 1);		// BT_RX idles high
+     bt.tx = 1;
+     btConnect(0);
+     holdInputs();
+
+     pads[0].plugged = 1;
+}
+
+static void report()
+{
+     avr_cycle_count_t	total = avr->cycle - measureFrom;
+     avr_cycle_count_t	asleep = 0;
+
+     if (!measureFrom || total == 0) {
+	  printf("loop() never ran\n");
+	  return;
+     }
+
+     printf("%.1f ms measured (%llu cycles at %lu Hz)\n\n",
+	    cyclesToMs(total), (unsigned long long) total, (unsigned long) avr->frequency);
+
+     measurePrint("loop period", &phase.period, "ms");
+     for (int i = 0; i < PHASE_COUNT; i++) {
+	  printf("    %-14s %5.1f%%  (asleep %5.1f%%)\n", phaseNames[i],
+		 100.0 * phase.time[i] / total, 100.0 * phase.asleep[i] / total);
+	  asleep += phase.asleep[i];
+     }
+     printf("    CPU asleep     %5.1f%% of the time\n", 100.0 * asleep / total);
+
+     printf("\n");
+     measurePrint("BT frame period", &bt.period, "ms");
+     if (bt.frames) {
+	  printf("    %ld frames, %.1f bytes per frame\n", bt.frames, (double) bt.bytes / bt.frames);
+     }
+}
+
+#ifndef BENCH_CHECK
+
+int main(int argc, char *argv[])
+{
+     elf_firmware_t	firmware;
+     long		connectAt = 3500;
+     long		runFor = 10000;
+     int		personality = 4;
+     int		verbose = 0;
+     int		opt;
+     int		state;
+     avr_cycle_count_t	endAt;
+
+     while ((opt = getopt(argc, argv, "c:m:p:v")) != -1) {
+	  switch(opt) {
+	  case 'c':	connectAt = atol(optarg);	break;
+	  case 'm':	runFor = atol(optarg);		break;
+	  case 'p':	personality = atoi(optarg);	break;
+	  case 'v':	verbose = 1;			break;
+	  default:
+	       fprintf(stderr, "usage: chaprbench [-c ms] [-m ms] [-p personality] [-v] ChapR.elf\n");
+	       return(2);
+	  }
+     }
+     if (optind != argc - 1) {
+	  fprintf(stderr, "usage: chaprbench [-c ms] [-m ms] [-p personality] [-v] ChapR.elf\n");
+	  return(2);
+     }
+
+     memset(&firmware, 0, sizeof(firmware));
+     if (elf_read_firmware(argv[optind], &firmware) != 0) {
+	  fprintf(stderr, "chaprbench: can't read %s\n", argv[optind]);
+	  return(1);
+     }
+     if (!firmware.mmcu[0]) {
+	  fprintf(stderr, "chaprbench: %s has no .mmcu section - build it with -DSIMAVR\n", argv[optind]);
+	  return(1);
+     }
+
+     avr = avr_make_mcu_by_name(firmware.mmcu);
+     if (!avr) {
+	  fprintf(stderr, "chaprbench: simavr doesn't know the %s\n", firmware.mmcu);
+	  return(1);
+     }
+     avr_init(avr);
+     avr_load_firmware(avr, &firmware);
+     avr->vcc = avr->avcc = avr->aref = 5000;
+
+     if (!verbose) {
+	  uint32_t	flags = 0;
+
+	  avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	  flags &= ~AVR_UART_FLAG_STDIO;
+	  avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+     }
+
+     settingsEEPROM(personality);
+     attach();
+
+     endAt = usToCycles(runFor * 1000);
+
+     while (avr->cycle < endAt) {
+	  if (!bt.connected && avr->cycle >= usToCycles(connectAt * 1000)) {
+	       btConnect(1);
+	  }
+
+	  avr_cycle_count_t	before = avr->cycle;
+	  int			sleeping = (avr->state == cpu_Sleeping);
+
+	  state = avr_run(avr);
+	  if (sleeping) {
+	       phaseAsleep(avr->cycle - before);	// simavr jumps ahead to the next timer
+	  }
+	  if (state == cpu_Done || state == cpu_Crashed) {
+	       fprintf(stderr, "chaprbench: the AVR %s at %.1f ms (pc 0x%04x)\n",
+		       (state == cpu_Crashed)? "crashed" : "stopped", cyclesToMs(avr->cycle), (unsigned) avr->pc);
+	       report();
+	       return(1);
+	  }
+     }
+
+     report();
+     return(0);
+}
+
+#endif /* BENCH_CHECK */
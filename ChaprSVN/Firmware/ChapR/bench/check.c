@@ -0,0 +1,507 @@
+//
+// check.c
+//
+//   Checks the models and the measurements in chaprbench.c on the host ("make check"),
+//   without simavr.  chaprbench.c is included here with BENCH_CHECK, which leaves out
+//   its main() and the simavr headers, and the few simavr calls it uses are stood in
+//   for below: IRQs that call their notify when raised, and cycle timers that run
+//   as the clock is moved along by hand.
+//
+//   The pins are driven the way the firmware drives them:
+//
+//	VDIP	- the bit-banging of VDIPSPI::send()/recv() (VDIPSPI.cpp), pin for pin,
+//		  with the commands VDIP.cpp sends and the replies it expects
+//	RN-42	- bytes from the ChapR are clocked out on BT_TX like SoftwareSerial
+//		  does, and what the model sends back is decoded off BT_RX
+//	PHASE	- GPIOR0 is written at known times, as PHASE() would, and the CPU is
+//		  put to sleep for part of the idle phase the way main() sees it
+//
+//   What this can't show is that simavr hands the models these same pin changes -
+//   that takes a run of the real image ("make bench" in the directory above).
+//   Exits non-zero if anything fails.
+//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+//
+// THE STAND-INS - only what chaprbench.c uses, with the same names as simavr
+//
+typedef uint64_t	avr_cycle_count_t;
+typedef uint32_t	avr_flashaddr_t;
+
+struct avr_irq_t;
+
+typedef void (*avr_irq_notify_t)(struct avr_irq_t *irq, uint32_t value, void *param);
+
+typedef struct avr_irq_t {
+     uint32_t		value;
+     avr_irq_notify_t	notify;
+     void		*param;
+} avr_irq_t;
+
+enum { cpu_Running, cpu_Sleeping };
+
+typedef struct avr_t {
+     int		state;
+     avr_cycle_count_t	cycle;
+     uint32_t		frequency;
+     avr_flashaddr_t	pc;
+     uint32_t		vcc, avcc, aref;
+} avr_t;
+
+struct avr_t;
+
+typedef avr_cycle_count_t (*avr_cycle_timer_t)(struct avr_t *avr, avr_cycle_count_t when, void *param);
+
+typedef struct {
+     uint8_t	*ee;
+     uint16_t	offset;
+     uint32_t	size;
+} avr_eeprom_desc_t;
+
+#define AVR_IOCTL_IOPORT_GETIRQ(p)	(p)
+#define AVR_IOCTL_ADC_GETIRQ		'A'
+#define AVR_IOCTL_EEPROM_SET		'E'
+#define ADC_IRQ_ADC6			6
+
+static avr_irq_t	ports[3][8];		// B, C and D
+static avr_irq_t	adc[8];
+static avr_irq_t	gpior0;
+
+avr_irq_t *avr_io_getirq(avr_t *avr, uint32_t ctl, int index)
+{
+     return((ctl == AVR_IOCTL_ADC_GETIRQ)? &adc[index] : &ports[ctl - 'B'][index]);
+}
+
+avr_irq_t *avr_iomem_getirq(avr_t *avr, uint16_t addr, const char *name, int index)
+{
+     return(&gpior0);
+}
+
+void avr_irq_register_notify(avr_irq_t *irq, avr_irq_notify_t notify, void *param)
+{
+     irq->notify = notify;
+     irq->param = param;
+}
+
+void avr_raise_irq(avr_irq_t *irq, uint32_t value)
+{
+     irq->value = value;
+     if (irq->notify) {
+	  irq->notify(irq, value, irq->param);
+     }
+}
+
+static uint8_t	eeprom[64];
+
+int avr_ioctl(avr_t *avr, uint32_t ctl, void *param)
+{
+     avr_eeprom_desc_t	*desc = (avr_eeprom_desc_t *) param;
+
+     if (ctl == AVR_IOCTL_EEPROM_SET && desc->offset + desc->size <= sizeof(eeprom)) {
+	  memcpy(eeprom + desc->offset, desc->ee, desc->size);
+     }
+     return(0);
+}
+
+#define TIMERS	16
+
+static struct {
+     avr_cycle_timer_t	fn;
+     void		*param;
+     avr_cycle_count_t	when;
+} timers[TIMERS];
+
+void avr_cycle_timer_register(avr_t *avr, avr_cycle_count_t when, avr_cycle_timer_t fn, void *param)
+{
+     int	i;
+
+     for (i = 0; i < TIMERS; i++) {			// like simavr, this replaces it
+	  if (timers[i].fn == fn && timers[i].param == param) {
+	       timers[i].fn = NULL;
+	  }
+     }
+     for (i = 0; i < TIMERS; i++) {
+	  if (!timers[i].fn) {
+	       timers[i].fn = fn;
+	       timers[i].param = param;
+	       timers[i].when = avr->cycle + when;
+	       return;
+	  }
+     }
+}
+
+#define BENCH_CHECK
+#include "chaprbench.c"
+
+static avr_t	theAvr;
+static int	failures = 0;
+
+//
+// advance() - move the clock along, running the timers that come due on the way
+//
+static void advance(avr_cycle_count_t cycles)
+{
+     avr_cycle_count_t	end = avr->cycle + cycles;
+
+     while (1) {
+	  int	next = -1;
+
+	  for (int i = 0; i < TIMERS; i++) {
+	       if (timers[i].fn && timers[i].when <= end && (next < 0 || timers[i].when < timers[next].when)) {
+		    next = i;
+	       }
+	  }
+	  if (next < 0) {
+	       break;
+	  }
+
+	  avr_cycle_timer_t	fn = timers[next].fn;
+	  void			*param = timers[next].param;
+	  avr_cycle_count_t	again;
+
+	  avr->cycle = timers[next].when;
+	  timers[next].fn = NULL;
+	  if ((again = fn(avr, avr->cycle, param)) != 0) {
+	       avr_cycle_timer_register(avr, again - avr->cycle, fn, param);
+	  }
+     }
+     avr->cycle = end;
+}
+
+static void check(int ok, const char *what)
+{
+     printf("%-50s %s\n", what, ok? "passed" : "FAILED");
+     if (!ok) {
+	  failures++;
+     }
+}
+
+//
+// THE VDIP SIDE - VDIPSPI.cpp, with digitalWrite() raising the pin's IRQ.  Each
+//		   digitalWrite() in VDIPSPI is here, in the same order.
+//
+#define CLOCK	(&ports['D' - 'B'][6])
+#define MOSI	(&ports['D' - 'B'][7])
+#define MISO	(&ports['B' - 'B'][0])
+#define CS	(&ports['B' - 'B'][1])
+#define RESET	(&ports['B' - 'B'][2])
+
+static void clockPulse()
+{
+     avr_raise_irq(CLOCK, 1);
+     avr_raise_irq(CLOCK, 0);
+}
+
+static void spiHeader(int read, int status)
+{
+     avr_raise_irq(CLOCK, 0);
+     avr_raise_irq(CS, 1);
+     avr_raise_irq(MOSI, 1);
+     clockPulse();
+     avr_raise_irq(MOSI, read);
+     clockPulse();
+     avr_raise_irq(MOSI, status);
+     clockPulse();
+}
+
+static int spiStatusBit()
+{
+     int	statusbit = MISO->value;
+
+     clockPulse();
+     avr_raise_irq(CS, 0);
+     clockPulse();
+     return(!statusbit);
+}
+
+static int spiSend(uint8_t data)
+{
+     spiHeader(0, 0);
+     for (int i = 8; i--; ) {
+	  avr_raise_irq(MOSI, (data & 0x80)? 1 : 0);
+	  clockPulse();
+	  data <<= 1;
+     }
+     return(spiStatusBit());
+}
+
+static int spiRecv(uint8_t *data)
+{
+     *data = 0;
+     spiHeader(1, 0);
+     for (int i = 8; i--; ) {
+	  *data <<= 1;
+	  *data |= MISO->value? 1 : 0;
+	  clockPulse();
+     }
+     return(spiStatusBit());
+}
+
+//
+// vdipExchange() - send the command, then read until the VDIP has nothing new.  Returns
+//		    the size of the reply, or -1 if the VDIP didn't take all of the command.
+//
+static int vdipExchange(const void *command, int size, uint8_t *reply)
+{
+     const uint8_t	*c = (const uint8_t *) command;
+     int		got = 0;
+     int		sent = 1;
+
+     while (size--) {
+	  sent &= spiSend(*c++);
+     }
+     if (!sent) {
+	  return(-1);				// it wouldn't take the command
+     }
+
+     while (got < 64 && spiRecv(reply + got)) {
+	  got++;
+     }
+     return(got);
+}
+
+static int same(const uint8_t *a, int aSize, const void *b, int bSize)
+{
+     return(aSize == bSize && memcmp(a, b, aSize) == 0);
+}
+
+static void checkVdip()
+{
+     uint8_t	r[64];
+     int	n;
+
+     printf("VDIP\n");
+
+     avr_raise_irq(RESET, 0);
+     avr_raise_irq(RESET, 1);
+     n = vdipExchange("", 0, r);
+     check(same(r, n, "Ver 03.69VDAPF On-Line:\r", 24), "  reset gives the banner");
+
+     n = vdipExchange("E\r", 2, r);
+     check(same(r, n, "E\r", 2), "  E is echoed (sync)");
+
+     n = vdipExchange("SCS\r", 4, r);
+     check(same(r, n, ">\r", 2), "  SCS gives the prompt");
+
+     n = vdipExchange("\x2B\r", 2, r);
+     check(same(r, n, "\x08\x00>\r", 4), "  QP1 - a HID device on port 1");
+
+     n = vdipExchange("\x2C\r", 2, r);
+     check(same(r, n, "\x00\x00>\r", 4), "  QP2 - nothing on port 2");
+
+     n = vdipExchange("\x85\x20\x00\r", 4, r);
+     check(n == 34 && r[0] == 1 && r[7] == 0x08 && r[11] == 0x03 && r[14] == 0x6D && r[17] == 0xC2 &&
+	   same(r + 32, 2, ">\r", 2), "  QD 0 - the F310 on port 1");
+
+     n = vdipExchange("\x9B\r", 2, r);
+     check(n == 2 + 3 + HID_REPORT + 2 && r[0] == 1 && r[2] == 0 && r[4] == HID_REPORT &&
+	   r[5] == 128 && r[6] == 128 && r[9] == 0x08 && same(r + n - 2, 2, ">\r", 2),
+	   "  DRA - one device, with a new report");
+
+     n = vdipExchange("\x9B\r", 2, r);
+     check(n == 2 + 3 + 2 && r[0] == 1 && r[4] == 0, "  DRA again right away - nothing new");
+
+     advance(usToCycles(HID_PERIOD));
+     n = vdipExchange("\x86\x20\x00\r", 4, r);
+     check(same(r, n, ">\r", 2), "  SC 0");
+     n = vdipExchange("\x84\r", 2, r);
+     check(n == 2 + HID_REPORT + 2 && r[0] == HID_REPORT && r[1] == '\r' && r[2] == 128,
+	   "  DRD 8ms later - the next report");
+
+     n = vdipExchange("\x84\r", 2, r);
+     check(same(r, n, "\x00\r>\r", 4), "  DRD again right away - nothing new");
+
+     n = vdipExchange("\x0E FTCConfig.txt\r", 16, r);
+     check(same(r, n, "CF\r", 3), "  OPR - there is no flash drive");
+
+     n = vdipExchange("XYZ\r", 4, r);
+     check(same(r, n, "BC\r", 3), "  anything else is a bad command");
+}
+
+//
+// THE RN-42 SIDE - bytes go out on BT_TX like SoftwareSerial sends them (start bit, eight
+//		    bits LSB first, stop bit), and everything the model raises on BT_RX is
+//		    kept, one raise per bit, to be decoded after.
+//
+#define BT_TX_PIN	(&ports['B' - 'B'][5])
+#define BT_RX_PIN	(&ports['B' - 'B'][4])
+
+static struct {
+     avr_cycle_count_t	at[4096];
+     uint8_t		bit[4096];
+     int		count;
+} rx;
+
+static void rxBit(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+     if (rx.count < 4096) {
+	  rx.at[rx.count] = avr->cycle;
+	  rx.bit[rx.count++] = value;
+     }
+}
+
+static void uartSend(const void *data, int size)
+{
+     const uint8_t	*p = (const uint8_t *) data;
+     avr_cycle_count_t	bitTime = avr->frequency / 38400;
+
+     while (size--) {
+	  unsigned	bits = (*p++ << 1) | 0x200;
+
+	  for (int i = 0; i < 10; i++, bits >>= 1) {
+	       avr_raise_irq(BT_TX_PIN, bits & 1);
+	       advance(bitTime);
+	  }
+     }
+}
+
+//
+// uartReceived() - decode what came back on BT_RX since the last call.  Every byte has to
+//		    have a good start and stop bit, and the bits have to be a bit time apart.
+//
+static int uartReceived(uint8_t *buf)
+{
+     static int		from = 0;
+     avr_cycle_count_t	bitTime = avr->frequency / 38400;
+     int		n = 0;
+     int		good = 1;
+
+     for (; from + 10 <= rx.count; from += 10) {
+	  uint8_t	c = 0;
+
+	  good &= (rx.bit[from] == 0 && rx.bit[from + 9] == 1);
+	  for (int i = 1; i < 10; i++) {
+	       good &= (rx.at[from + i] - rx.at[from + i - 1] == bitTime);
+	  }
+	  for (int i = 8; i >= 1; i--) {
+	       c = (c << 1) | rx.bit[from + i];
+	  }
+	  buf[n++] = c;
+     }
+     return(good? n : -1);
+}
+
+static void checkBt()
+{
+     static const uint8_t	messageRead[] = { 0x05, 0x00, 0x00, 0x13, 0x0A, 0x00, 0x01 };
+     uint8_t			r[256];
+     int			n;
+
+     printf("RN-42\n");
+
+     avr_irq_register_notify(BT_RX_PIN, rxBit, NULL);
+     avr_raise_irq(&ports['D' - 'B'][5], 0);		// 38400 baud
+
+     uartSend("$$$", 3);
+     advance(usToCycles(2000));
+     n = uartReceived(r);
+     check(bt.cmdMode && same(r, n, "CMD\r\n", 5), "  $$$ - command mode");
+
+     uartSend("Q,1\r", 4);
+     advance(usToCycles(2000));
+     n = uartReceived(r);
+     check(bt.cmdMode && same(r, n, "AOK\r\n", 5), "  Q,1 - AOK");
+
+     uartSend("---\r", 4);
+     advance(usToCycles(2000));
+     n = uartReceived(r);
+     check(!bt.cmdMode && same(r, n, "END\r\n", 5), "  --- - out of command mode");
+
+     btConnect(1);
+     check(ports['D' - 'B'][3].value == 1, "  BT_CONNECTED goes up");
+
+     phaseWrite(&gpior0, PHASE_LOOP, NULL);		// start measuring
+     for (int i = 0; i < 4; i++) {
+	  avr_cycle_count_t	start = avr->cycle;
+
+	  uartSend(messageRead, sizeof(messageRead));
+	  advance(usToCycles(20000) - (avr->cycle - start));
+     }
+     n = uartReceived(r);
+     check(n == 4 * 5 && same(r, 5, "\x03\x00\x02\x13\x40", 5), "  MessageRead gets an empty mailbox reply");
+     check(bt.frames == 4 && bt.bytes == 4 * sizeof(messageRead), "  four frames of seven bytes");
+     check(bt.period.count == 3 && bt.period.min == 20.0 && bt.period.max == 20.0, "  20ms between frames");
+}
+
+//
+// checkPhases() - one loop() is 10ms: 1ms of loop, 2ms of gamepad, 1ms of personality,
+//		   then 6ms idle, 4ms of which asleep.
+//
+static void checkPhases()
+{
+     static const struct { int phase; int ms; } oneLoop[] = {
+	  { PHASE_LOOP, 1 }, { 2, 2 }, { 4, 1 }, { 0, 2 },
+     };
+
+     printf("PHASE\n");
+
+     memset(&phase, 0, sizeof(phase));
+     measureFrom = 0;
+     avr->cycle = usToCycles(1000000);
+
+     for (int loops = 0; loops < 5; loops++) {
+	  for (int i = 0; i < 4; i++) {
+	       avr_raise_irq(&gpior0, oneLoop[i].phase);
+	       advance(usToCycles(oneLoop[i].ms * 1000));
+	  }
+	  avr->state = cpu_Sleeping;			// then idleFor() sleeps 4ms
+	  for (int ms = 0; ms < 4; ms++) {		// woken by each timer0 tick, as main() steps
+	       avr_cycle_count_t	before = avr->cycle;
+
+	       advance(usToCycles(1000));
+	       phaseAsleep(avr->cycle - before);
+	  }
+	  avr->state = cpu_Running;
+     }
+     avr_raise_irq(&gpior0, PHASE_LOOP);
+
+     avr_cycle_count_t total = avr->cycle - measureFrom;
+
+     check(phase.period.count == 5 && phase.period.min == 10.0 && phase.period.max == 10.0, "  loop period 10ms");
+     check(phase.time[0] * 10 == total * 6 && phase.time[1] * 10 == total &&
+	   phase.time[2] * 10 == total * 2 && phase.time[3] == 0 && phase.time[4] * 10 == total,
+	   "  split 60/10/20/0/10%");
+     check(phase.asleep[0] * 10 == total * 4 && phase.asleep[1] + phase.asleep[2] + phase.asleep[3] + phase.asleep[4] == 0,
+	   "  asleep 40%, all of it in idle");
+
+     printf("\n");
+     report();
+     printf("\n");
+}
+
+//
+// checkEEPROM() - the settings land where settings.h has them in the legacy layout
+//
+static void checkEEPROM()
+{
+     printf("EEPROM\n");
+
+     settingsEEPROM(4);
+     check(strcmp((char *) eeprom + 0, "ChapRBench") == 0 && eeprom[17] == 4 &&
+	   strcmp((char *) eeprom + 18, "Chap3") == 0 && eeprom[26] == 1 && eeprom[39] == 1,
+	   "  name, personality, magic, mode and match mode");
+}
+
+int main()
+{
+     avr = &theAvr;
+     avr->frequency = 16000000;
+     avr->cycle = 1;
+
+     attach();
+
+     checkVdip();
+     checkBt();
+     checkPhases();
+     checkEEPROM();
+
+     if (failures) {
+	  printf("%d FAILED\n", failures);
+	  return(1);
+     }
+     printf("all passed\n");
+     return(0);
+}
@@ -4,19 +4,104 @@
 #include "config.h"
 #include "button.h"
 
-button::button (int pin) : _pin(pin), _wasPressed(false), _inverted(false), _target(0)
+button	*button::_buttons[BUTTON_MAX];
+uint8_t	 button::_count = 0;
+
+button::button (int pin) : _pin(pin), _wasPressed(false), _inverted(false)
 {
   pinMode(_pin, INPUT);
-  _wasPressed = check();
+  init();
 }
 
-button::button (int pin, bool inverted) : _pin(pin), _wasPressed(false), _inverted(inverted), _target(0)
+button::button (int pin, bool inverted) : _pin(pin), _wasPressed(false), _inverted(inverted)
 {
   pinMode(_pin, INPUT);
   if(_inverted) {
      digitalWrite(_pin,HIGH);	// turns on the pull-up resistor for inverted buttons;
   }
-  _wasPressed = check();
+  init();
+}
+
+//
+// init() - common constructor stuff, including signing up to be sampled by the interrupt.
+//
+void button::init()
+{
+  _input = portInputRegister(digitalPinToPort(_pin));
+  _mask = digitalPinToBitMask(_pin);
+  _wasPressed = _state = check();
+  _when = _lastEdge = 0;
+  _head = _tail = 0;
+
+  if (_count < BUTTON_MAX) {
+       _buttons[_count++] = this;
+  }
+}
+
+//
+// start() - start sampling the buttons in the background.  Timer0 is already running
+//	     for millis(), so this just turns on its compare B interrupt, which then
+//	     goes off once per timer0 cycle (1.024ms) half way between overflows.
+//
+void button::start()
+{
+  OCR0B = 0x80;
+  TIMSK0 |= (1<<OCIE0B);
+}
+
+ISR(TIMER0_COMPB_vect)
+{
+  button::sample();
+}
+
+void button::sample()
+{
+  for (uint8_t i = 0; i < _count; i++) {
+       _buttons[i]->poll();
+  }
+}
+
+//
+// poll() - the interrupt side of one button.  The debounce is done on the time stamps:
+//	    after a change, nothing more is believed for DEBOUNCE ms.  If the button
+//	    ended up somewhere else by then, that shows up as a change on the next sample.
+//
+void button::poll()
+{
+  bool		raw = ((*_input & _mask) != 0) != _inverted;
+  unsigned long	now;
+
+  if (raw == _state) {
+       return;
+  }
+
+  now = micros();
+  if (now - _lastEdge < DEBOUNCE * 1000UL) {
+       return;
+  }
+
+  _state = raw;
+  _lastEdge = now;
+
+  if ((uint8_t)(_head - _tail) < BUTTON_QUEUE) {	// when full, the newest is lost
+       buttonEvent *event = &_queue[_head & (BUTTON_QUEUE - 1)];
+       event->pressed = raw;
+       event->when = now;
+       _head++;
+  }
+}
+
+//
+// eventPending() - true if any button has a change waiting for hasChanged().
+//
+bool button::eventPending()
+{
+  for (uint8_t i = 0; i < _count; i++) {
+       if (_buttons[i]->_head != _buttons[i]->_tail) {
+	    return(true);
+       }
+  }
+  return(false);
 }
 
 //
@@ -39,21 +124,30 @@ bool button::isPressed()
 }
 
 //
-// hasChanged() - returns true if the button has changed. When the button changes
-//                this routine enters a "debounce" period during which no other
-//                changes will be reported. This serves to "debounce" the mechanical
-//                switches. Use isPressed() to get the current value (true = pressed).
+// hasChanged() - returns true if the button has changed, taking the next (debounced)
+//                change from the queue filled by the interrupt.  Use isPressed() to get
+//                the value after the change (true = pressed), and changedAt() for when
+//                it happened.
 //
 bool button::hasChanged()
 {
-     if (millis() > _target){ // checks to see if it is in the "debounce period"
-       int current = check();
-       if (current != _wasPressed){ // if it has changed and is not in "debounce"
-         _wasPressed = current;
-         _target = millis() + DEBOUNCE;
-         return true;
-       }
+     if (_head == _tail) {
+	  return false;
      }
-     
-     return false;
+
+     buttonEvent *event = &_queue[_tail & (BUTTON_QUEUE - 1)];
+     _wasPressed = event->pressed;
+     _when = event->when;
+     _tail++;
+
+     return true;
+}
+
+//
+// changedAt() - micros() of the change last returned by hasChanged().  It is only as
+//		 good as the sampling, so within about a millisecond.
+//
+unsigned long button::changedAt()
+{
+     return _when;
 }
@@ -3,6 +3,20 @@
 #ifndef BUTTON_H
 #define BUTTON_H
 
+//
+// Buttons are sampled in the background, about every millisecond, off of the timer0
+// compare B interrupt (SoftwareSerial owns all of the pin change interrupts, so they
+// can't be used).  Each debounced change goes into a small queue for that button,
+// with the micros() when it happened, and hasChanged() hands them out in order.
+//
+#define BUTTON_QUEUE	4		// events kept per button (must be a power of 2)
+#define BUTTON_MAX	2		// buttons that can be sampled in the background
+
+typedef struct {
+     bool		pressed;
+     unsigned long	when;		// micros() of the change
+} buttonEvent;
+
 class button
 {
  public:
@@ -12,12 +26,31 @@ class button
   bool isPressed();
   bool hasChanged();
   bool check();
+  unsigned long changedAt();
+
+  static void start();
+  static bool eventPending();
+  static void sample();		// ONLY from the timer interrupt
 
  private:
   int _pin;
   bool _wasPressed;
   bool _inverted;
-  unsigned long _target;
+  unsigned long _when;		// micros() of the last change handed out by hasChanged()
+
+  volatile uint8_t *_input;	// the pin, as the interrupt reads it
+  uint8_t _mask;
+  bool _state;			// debounced state, as the interrupt sees it
+  unsigned long _lastEdge;	// micros() of the last debounced change
+  buttonEvent _queue[BUTTON_QUEUE];
+  volatile uint8_t _head;	// written by the interrupt
+  volatile uint8_t _tail;	// written by hasChanged()
+
+  void init();
+  void poll();
+
+  static button *_buttons[BUTTON_MAX];
+  static uint8_t _count;
 };
 
 #endif BUTTON_H
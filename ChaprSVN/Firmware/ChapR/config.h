@@ -65,12 +65,11 @@
 // Battery voltage monitor is on BATTERY_MONITOR and is a resistor network
 // that divides the 9v by two. This means that the max voltage is nominally
 // 4.5 volts, but in actuality it is sometimes close to 5 volts because
-// some batteries are well above 9v.  This routine gives voltage in the
-// long integer domain times 10 where 90 is 9 volts.  Note that this routine
-// can NEVER come back with 10v (100) because analogRead() comes back with
-// 1023 maximum.
+// some batteries are well above 9v.  It is sampled in the background by
+// battery.cpp - which gives voltage in the integer domain times 10 where 90
+// is 9 volts.  Note that it can NEVER come back with 10v (100) because the
+// ADC comes back with 1023 maximum.
 //
-#define BATTERY_VOLTAGE	(analogRead(BATTERY_MONITOR)*5L*2L*10L/1024L)
 
 //
 // the baud rate that the local serial port will operate in - talking to the IDE terminal
@@ -115,3 +114,5 @@
 #define DEF_FRCTELELEN         135 // (secs)
 #define DEF_FRCENDLEN          20   // (secs)
 #define DEF_MATCHMODE	       1   // matchmode is "on" by default
+#define DEF_TETHER	       0   // USB tether is "off" by default
+#define DEF_LOGGING	       0   // logging to the flash drive is "off" by default
@@ -0,0 +1,171 @@
+//
+// console.cpp
+//
+//   It used to be that any character on the serial port stopped everything for
+//   the settings prompts.  Now the characters are collected into a line as they
+//   arrive, and only a whole line is acted on.  The commands are:
+//
+//	get [key]	print the settings (or just the one) as chapr.cfg lines
+//	set key value	change a setting - it is used right away, and saved
+//	stats		link, battery, watchdog and stack stats ("?" works too)
+//	reset		start the link stats over
+//	!		board bring-up, then the settings prompts
+//	(empty line)	the settings prompts, like always
+//
+//   Bytes that are part of a host link frame (see hostlink.h) never make it
+//   into the line.
+//
+//   The keys are the ones in chapr.cfg (see VDIP.cpp) and so is the checking of
+//   the values.  The prompts and the bring-up still stop the show (with the
+//   watchdog off) until they are done - the rest don't, so lag or the match
+//   lengths can be changed with the robot running.
+//
+
+#include <Arduino.h>
+#include "config.h"
+#include "VDIP.h"
+#include "BT.h"
+#include "RIO.h"
+#include "settings.h"
+#include "battery.h"
+#include "watchdog.h"
+#include "stack.h"
+#include "hostlink.h"
+#include "console.h"
+
+extern VDIP	vdip;
+extern settings	myEEPROM;
+extern RIO	RIO;
+
+extern void settingsApply();
+
+static char	consoleLine[CONSOLE_LINE];
+static byte	consoleSize = 0;
+static bool	consoleCR = false;		// the last character was a '\r'
+
+//
+// consoleWord() - split off the first word of the line, returning the rest (with the
+//		   spaces in front of it skipped).
+//
+static char *consoleWord(char *line)
+{
+     char	*rest = strchr(line,' ');
+
+     if (rest == NULL) {
+	  return(line + strlen(line));
+     }
+
+     *rest++ = '\0';
+     while (*rest == ' ') {
+	  rest++;
+     }
+     return(rest);
+}
+
+//
+// consoleSet() - "set key value" is turned into the "key=value" line that chapr.cfg would
+//		  have, so the setting goes through exactly the same checks.
+//
+static void consoleSet(char *args)
+{
+     char	*value = consoleWord(args);
+     char	*split = args + strlen(args);	// where the key was split off
+
+     if (*args == '\0' || *value == '\0') {
+	  Serial.println(F("set key value"));
+	  return;
+     }
+
+     *split = '=';				// the spaces after it are trimmed
+     if (!vdip.configLine(args)) {
+	  Serial.println(F("no such setting"));
+	  return;
+     }
+
+     myEEPROM.commit();
+     settingsApply();
+
+     *split = '\0';				// back to just the key
+     (void)vdip.printConfig(args);
+}
+
+static void consoleStats()
+{
+     RIO.printStats();
+     batteryPrint();
+     watchdogPrint();
+     stackPrint();
+}
+
+//
+// consolePrompts() - the old blocking settings prompts (and bring-up).
+//
+static void consolePrompts(bool bringUp)
+{
+     watchdogOff();
+     if (bringUp) {
+	  myEEPROM.boardBringUp();
+     }
+     myEEPROM.setFromConsole();
+     settingsApply();
+     watchdogOn();
+}
+
+//
+// consoleCommand() - act on a whole line.
+//
+static void consoleCommand(char *line)
+{
+     char	*args = consoleWord(line);
+
+     if (*line == '\0') {
+	  consolePrompts(false);
+     } else if (strcmp_P(line, PSTR("!")) == 0) {
+	  consolePrompts(true);
+     } else if (strcmp_P(line, PSTR("get")) == 0) {
+	  if (!vdip.printConfig(args)) {
+	       Serial.println(F("no such setting"));
+	  }
+     } else if (strcmp_P(line, PSTR("set")) == 0) {
+	  consoleSet(args);
+     } else if (strcmp_P(line, PSTR("stats")) == 0 || strcmp_P(line, PSTR("?")) == 0) {
+	  consoleStats();
+     } else if (strcmp_P(line, PSTR("reset")) == 0) {
+	  RIO.resetStats();
+     } else {
+	  Serial.println(F("get [key], set key value, stats, reset, ! or RET for the prompts"));
+     }
+}
+
+//
+// consolePoll() - take whatever characters have come in.  Nothing happens until the end
+//		   of a line - '\r', '\n' or both.  Anything past CONSOLE_LINE is dropped.
+//
+void consolePoll()
+{
+     if (Serial.available() <= 0) {
+	  hostlinkIdle();		// a half-done frame only times out while nothing comes in
+	  return;
+     }
+
+     while (Serial.available() > 0) {
+	  char	c = Serial.read();
+
+	  if (hostlinkByte(c)) {
+	       continue;
+	  }
+	  if (c == '\n' && consoleCR) {		// the other half of a "\r\n"
+	       consoleCR = false;
+	       continue;
+	  }
+	  consoleCR = (c == '\r');
+
+	  if (c == '\r' || c == '\n') {
+	       consoleLine[consoleSize] = '\0';
+	       consoleSize = 0;
+	       consoleCommand(consoleLine);
+	  } else if (consoleSize < CONSOLE_LINE - 1) {
+	       consoleLine[consoleSize++] = c;
+	  }
+     }
+}
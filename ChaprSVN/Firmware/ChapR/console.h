@@ -0,0 +1,16 @@
+//
+// console.h
+//
+//   The serial console (see console.cpp).  consolePoll() is called each time
+//   through loop() and only takes the characters that have come in, so the
+//   robot keeps getting its frames while someone is typing.
+//
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#define CONSOLE_LINE	40		// longest command line (like chapr.cfg lines)
+
+extern void consolePoll();
+
+#endif CONSOLE_H
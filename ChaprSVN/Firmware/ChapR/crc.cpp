@@ -0,0 +1,24 @@
+//
+// crc.cpp
+//
+//   See crc.h.
+//
+
+#include <Arduino.h>
+#include "crc.h"
+
+//
+// crc8() - run the given bytes through the CRC, starting with the given
+//	    crc.  Start a new CRC with CRC8_INIT, or hand back the result of
+//	    a previous call to continue one.
+//
+byte crc8(byte crc, byte *data, int size)
+{
+     for (; size > 0; size--, data++) {
+	  crc ^= *data;
+	  for (int i = 0; i < 8; i++) {
+	       crc = (crc & 0x80)? (crc << 1) ^ CRC8_POLY : (crc << 1);
+	  }
+     }
+     return(crc);
+}
@@ -0,0 +1,18 @@
+//
+// crc.h
+//
+//   A small CRC-8 (polynomial 0x07, initial value 0) for the places where
+//   the old 7-bit additive checksums aren't good enough.  It is computed a
+//   bit at a time, which is plenty fast for the few bytes we protect and
+//   doesn't cost a 256 byte table.
+//
+
+#ifndef CRC_H
+#define CRC_H
+
+#define CRC8_POLY	0x07
+#define CRC8_INIT	0x00
+
+extern byte crc8(byte crc, byte *data, int size);
+
+#endif CRC_H
@@ -10,7 +10,7 @@
 void dumpDataHex(char *label, byte *buffer, int count)
 {
      Serial.print(label);
-     Serial.print(": ");
+     Serial.print(F(": "));
      dumpDataHex(buffer,count);
 }
 
@@ -20,21 +20,21 @@ void dumpDataHex(byte *buffer, int count)
 
      for(;count > 0; count--, i++, buffer++) {
 	  value = (unsigned char)*buffer;
-	  Serial.print("0x");
+	  Serial.print(F("0x"));
 	  if( value< 16) {
-	       Serial.print("0");
+	       Serial.print('0');
 	  }
 	  Serial.print(value,HEX);
-	  Serial.print(" ");
+	  Serial.print(' ');
 	  if( i%8 == 7) {
-	       Serial.println("");
+	       Serial.println();
 	  }
      }
 
      // if we didn't end on an even boundary, kick out a newline
 
      if(i%8 != 0) {
-	  Serial.println("");
+	  Serial.println();
      }
 }
 
@@ -10,4 +10,24 @@
 extern void dumpDataHex(byte *, int);
 extern void dumpDataHex(char *label, byte *, int);
 
+//
+// PHASE() - marks which part of loop() is running by writing it to GPIOR0,
+//	     a register nothing else uses.  It is one instruction, and the
+//	     watchdog saves it in its crash record (see watchdog.h).
+//
+//	     Building with -DSIMAVR (see the Makefile) puts trace sections in the
+//	     image (simavr.c) so simavr dumps GPIOR0, the BT/VDIP pins and the
+//	     interrupts to a VCD file.  The loop period, the gaps between BT
+//	     frames and how long interrupts sit pending can then be read off
+//	     with cycle accuracy - "make bench" does that with models of the
+//	     VDIP and the RN-42 (bench/chaprbench.c).
+//
+#define PHASE(p)	(GPIOR0 = (p))
+
+#define PHASE_IDLE		0	// the delay at the bottom of loop()
+#define PHASE_LOOP		1	// top of loop(), buttons and battery
+#define PHASE_GAMEPAD		2	// reading the gamepads, personalityChangeInput()
+#define PHASE_DEVICE		3	// VDIP device check/update
+#define PHASE_PERSONALITY	4	// personalityLoop()
+
 #endif DEBUG_H
@@ -64,7 +64,9 @@ struct usbIDTable {
      unsigned short	pid;	// product ID
      xlateFn	xlate;	// function to xlate to gamepad canonical form
      initFn	init;	// function to init gamepad the first time
-} usbIDTable[] = {
+};
+
+static const struct usbIDTable usbIDTable[] PROGMEM = {	// in flash - read with memcpy_P()
      { 0x0E6F, 0x0401, driverXbox360, initXbox360 },	// the Gamestop Xbox 360 controller
      { 0x0E6F, 0x0213, driverXbox360, initXbox360 },	// the Afterglow Xbox 360 controller
      { 0x045E, 0x028E, driverXbox360, initXbox360 },	// the Microsoft Xbox 360 controller
@@ -78,16 +80,17 @@ struct usbIDTable {
 
 int driverLookup(unsigned int vid, unsigned int pid, xlateFn *xlate, initFn *init)
 {
-     int	i = 0;
+     int		i = 0;
+     struct usbIDTable	entry;
 
-     while(usbIDTable[i].xlate != NULL) {
-	  if(usbIDTable[i].vid == vid && usbIDTable[i].pid == pid) {
+     for(;; i++) {
+	  memcpy_P(&entry, &usbIDTable[i], sizeof(entry));
+	  if(entry.xlate == NULL || (entry.vid == vid && entry.pid == pid)) {
 	       break;
 	  }
-	  i++;
-     } 
-     *xlate = usbIDTable[i].xlate;
-     *init = usbIDTable[i].init;
+     }
+     *xlate = entry.xlate;
+     *init = entry.init;
 
      return i;
 }
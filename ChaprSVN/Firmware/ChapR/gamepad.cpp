@@ -13,17 +13,17 @@ Gamepad::Gamepad(int _id) : translator(NULL), init(NULL), id(_id), x1(0), y1(0),
 void Gamepad::debugPrint(char *prefix)
 {
      Serial.print(prefix);
-     Serial.print(": X1:");
+     Serial.print(F(": X1:"));
      Serial.print(x1);
-     Serial.print(" Y1:");
+     Serial.print(F(" Y1:"));
      Serial.print(y1);
-     Serial.print(" X2:");
+     Serial.print(F(" X2:"));
      Serial.print(x2);
-     Serial.print(" Y1:");
+     Serial.print(F(" Y1:"));
      Serial.print(y2);
-     Serial.print(" TOP: ");
+     Serial.print(F(" TOP: "));
      Serial.print(tophat);
-     Serial.println("");
+     Serial.println();
 }
 
 #endif
@@ -42,7 +42,8 @@ void Gamepad::clear()
 //
 // update() - updates the gamepad to see if anything has changed.  If so, returns true,
 //		false if nothing has changed.  If there was a change, the gamepad is
-//		updated to include the new values.
+//		updated to include the new values.  With the ChapR VDIP firmware both
+//		gamepads come in with one VDIP command - see VDIP::getJoystick().
 //
 bool Gamepad::update(VDIP *vdip)
 {
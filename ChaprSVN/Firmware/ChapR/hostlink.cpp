@@ -0,0 +1,294 @@
+//
+// hostlink.cpp
+//
+//   See hostlink.h for the protocol.  Frames are picked out of the serial
+//   stream a byte at a time as consolePoll() hands them over, so a frame
+//   that comes in over several loops is fine.  A frame that stops coming in
+//   for HL_TIMEOUT is thrown away, which gets things back in step if the
+//   host goes away in the middle of one.  That is only checked when a poll
+//   finds nothing waiting (hostlinkIdle()) - a loop can take longer than
+//   HL_TIMEOUT, and the rest of a frame may be sitting in the receive
+//   buffer the whole time.
+//
+//   Replies and state frames are written to the serial transmit buffer.  The
+//   stream period is kept long enough for a state frame to go out before the
+//   next one, so the buffer never fills up and stops loop() to wait.
+//
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "config.h"
+#include "VDIP.h"
+#include "BT.h"
+#include "gamepad.h"
+#include "settings.h"
+#include "battery.h"
+#include "crc.h"
+#include "hostlink.h"
+
+#define HL_TIMEOUT	100		// ms of no input allowed in the middle of a frame
+
+extern BT	bt;
+extern settings	myEEPROM;
+
+extern void settingsApply();
+
+enum { HL_IDLE, HL_LEN, HL_CMD, HL_PAYLOAD, HL_CRC };
+
+static byte		hlState = HL_IDLE;
+static byte		hlFrame[HL_MAX_PAYLOAD + 2];	// len, cmd, payload
+static byte		hlCount;			// payload bytes so far
+static unsigned long	hlLastByte;
+
+static unsigned int	hlPeriod = 0;			// stream period (ms), 0 is off
+static unsigned long	hlLastState;
+static byte		hlSeq = 0;
+static unsigned long	hlMaxLoop = 0;
+static unsigned long	hlMaxPersonality = 0;
+static bool		hlRescan = false;
+
+//
+// hostlinkSend() - write a frame out.
+//
+static void hostlinkSend(byte cmd, byte *payload, byte len)
+{
+     byte	crc;
+
+     crc = crc8(CRC8_INIT, &len, 1);
+     crc = crc8(crc, &cmd, 1);
+     crc = crc8(crc, payload, len);
+
+     Serial.write(HL_SYNC);
+     Serial.write(len);
+     Serial.write(cmd);
+     Serial.write(payload, len);
+     Serial.write(crc);
+}
+
+static void hostlinkNak(byte cmd, byte reason)
+{
+     byte	payload[2] = { cmd, reason };
+
+     hostlinkSend(HL_NAK, payload, 2);
+}
+
+//
+// hostlinkCommand() - act on a good frame.  The reply is built over the command's payload
+//		       since it isn't needed after the arguments are picked out.
+//
+static void hostlinkCommand(byte cmd, byte *payload, byte len)
+{
+     unsigned int	addr;
+     byte		count;
+     byte		i;
+
+     switch(cmd) {
+
+     case HL_PING:
+	  payload[0] = HL_VERSION;
+	  payload[1] = sizeof(settingsRecord);
+	  len = 2;
+	  break;
+
+     case HL_READ:
+	  addr = payload[0] | (payload[1] << 8);
+	  count = payload[2];
+	  if (len != 3 || count > HL_MAX_PAYLOAD - 2 || addr + count > E2END + 1) {
+	       hostlinkNak(cmd, HL_NAK_ARGS);
+	       return;
+	  }
+	  for (i=0; i < count; i++) {
+	       payload[2+i] = EEPROM.read(addr + i);
+	  }
+	  len = 2 + count;
+	  break;
+
+     case HL_GET:
+	  count = payload[1];
+	  if (len != 2 || count > HL_MAX_PAYLOAD - 1 || payload[0] + count > sizeof(settingsRecord)) {
+	       hostlinkNak(cmd, HL_NAK_ARGS);
+	       return;
+	  }
+	  for (i=0; i < count; i++) {
+	       payload[1+i] = myEEPROM.getField(payload[0] + i);
+	  }
+	  len = 1 + count;
+	  break;
+
+     case HL_SET:
+	  if (len < 2) {
+	       hostlinkNak(cmd, HL_NAK_ARGS);
+	       return;
+	  }
+	  for (count=0; count < len - 1; count++) {		// all or nothing
+	       if (!myEEPROM.checkField(payload[0] + count, payload[1+count])) {
+		    hostlinkNak(cmd, HL_NAK_RANGE);
+		    return;
+	       }
+	  }
+	  for (count=0; count < len - 1; count++) {
+	       (void)myEEPROM.setField(payload[0] + count, payload[1+count]);
+	  }
+	  myEEPROM.commit();
+	  settingsApply();
+	  payload[1] = count;
+	  len = 2;
+	  break;
+
+     case HL_STREAM:
+	  if (len != 2) {
+	       hostlinkNak(cmd, HL_NAK_ARGS);
+	       return;
+	  }
+	  hlPeriod = payload[0] | (payload[1] << 8);
+	  if (hlPeriod != 0 && hlPeriod < HL_STREAM_MIN) {
+	       hlPeriod = HL_STREAM_MIN;
+	  }
+	  hlLastState = millis();
+	  hlMaxLoop = hlMaxPersonality = 0;
+	  payload[0] = lowByte(hlPeriod);
+	  payload[1] = highByte(hlPeriod);
+	  break;
+
+     case HL_RESCAN:
+	  hlRescan = true;
+	  len = 0;
+	  break;
+
+     default:
+	  hostlinkNak(cmd, HL_NAK_CMD);
+	  return;
+     }
+
+     hostlinkSend(cmd | HL_REPLY, payload, len);
+}
+
+//
+// hostlinkIdle() - called by consolePoll() when nothing has come in since the last poll.
+//		    Since the last byte was taken no later than it came in, this is
+//		    a gap in the input of at least millis() - hlLastByte.
+//
+void hostlinkIdle()
+{
+     if (hlState != HL_IDLE && millis() - hlLastByte > HL_TIMEOUT) {
+	  hlState = HL_IDLE;
+     }
+}
+
+//
+// hostlinkByte() - take a byte from the serial port.  Returns true if it was part of a
+//		    frame, false if it belongs to the console.
+//
+bool hostlinkByte(byte c)
+{
+     byte	*payload = hlFrame + 2;
+
+     if (hlState == HL_IDLE && c != HL_SYNC) {
+	  return(false);
+     }
+     hlLastByte = millis();
+
+     switch(hlState) {
+     case HL_IDLE:
+	  hlState = HL_LEN;
+	  break;
+
+     case HL_LEN:
+	  hlFrame[0] = c;
+	  hlState = (c > HL_MAX_PAYLOAD)? HL_IDLE : HL_CMD;
+	  break;
+
+     case HL_CMD:
+	  hlFrame[1] = c;
+	  hlCount = 0;
+	  hlState = (hlFrame[0] == 0)? HL_CRC : HL_PAYLOAD;
+	  break;
+
+     case HL_PAYLOAD:
+	  payload[hlCount++] = c;
+	  if (hlCount == hlFrame[0]) {
+	       hlState = HL_CRC;
+	  }
+	  break;
+
+     case HL_CRC:
+	  hlState = HL_IDLE;
+	  if (c == crc8(CRC8_INIT, hlFrame, hlFrame[0] + 2)) {
+	       hostlinkCommand(hlFrame[1], payload, hlFrame[0]);
+	  }
+	  break;
+     }
+
+     return(true);
+}
+
+static byte *hostlinkGamepad(byte *p, Gamepad *g)
+{
+     *p++ = g->type;
+     *p++ = g->x1;
+     *p++ = g->y1;
+     *p++ = g->x2;
+     *p++ = g->y2;
+     *p++ = g->x3;
+     *p++ = g->y3;
+     *p++ = lowByte(g->buttons);
+     *p++ = highByte(g->buttons);
+     *p++ = g->tophat;
+     return(p);
+}
+
+//
+// hostlinkLoop() - called every loop with the gamepads and how long the loop (and the
+//		    personality) took.  Sends an HL_STATE frame when one is due.
+//
+void hostlinkLoop(Gamepad *g1, Gamepad *g2, unsigned long loopTime, unsigned long personalityTime)
+{
+     byte		state[HL_STATE_SIZE];
+     byte		*p = state;
+     unsigned long	now;
+
+     if (hlPeriod == 0) {
+	  return;
+     }
+
+     hlMaxLoop = max(hlMaxLoop, loopTime);
+     hlMaxPersonality = max(hlMaxPersonality, personalityTime);
+
+     now = millis();
+     if (now - hlLastState < hlPeriod) {
+	  return;
+     }
+     hlLastState = now;
+
+     *p++ = hlSeq++;
+     *p++ = now;
+     *p++ = now >> 8;
+     *p++ = now >> 16;
+     *p++ = now >> 24;
+     *p++ = (bt.connected()? HL_STATE_CONNECTED : 0) | (batteryLow()? HL_STATE_LOW : 0);
+     hlMaxLoop = min(hlMaxLoop, 65535UL);
+     *p++ = lowByte(hlMaxLoop);
+     *p++ = highByte(hlMaxLoop);
+     hlMaxPersonality = min(hlMaxPersonality, 65535UL);
+     *p++ = lowByte(hlMaxPersonality);
+     *p++ = highByte(hlMaxPersonality);
+     *p++ = lowByte(batteryMillivolts());
+     *p++ = highByte(batteryMillivolts());
+     p = hostlinkGamepad(p, g1);
+     p = hostlinkGamepad(p, g2);
+
+     hostlinkSend(HL_STATE, state, HL_STATE_SIZE);
+     hlMaxLoop = hlMaxPersonality = 0;
+}
+
+//
+// hostlinkRescan() - true (once) when the host has asked for the USB devices to be
+//		      enumerated again.  loop() does it with the rest of the device checks.
+//
+bool hostlinkRescan()
+{
+     bool	rescan = hlRescan;
+
+     hlRescan = false;
+     return(rescan);
+}
@@ -0,0 +1,83 @@
+//
+// hostlink.h
+//
+//   A binary protocol on the serial port (at LOCAL_SERIAL_BAUD) for programs on a
+//   PC - see Firmware/HostLink for the Linux one.  It shares the port with the
+//   console (console.cpp hands it the bytes): every frame starts with HL_SYNC,
+//   which can't be typed, so text and frames mix without getting confused.
+//
+//	,------,-----,-----,----------------,-----,
+//	| SYNC | len | cmd | payload        | crc |
+//	'------'-----'-----'----------------'-----'
+//	   1      1     1     len (max 32)     1
+//
+//   The crc is the CRC-8 of crc.h over len, cmd and the payload.  The ChapR answers
+//   each command with a frame with the same cmd plus HL_REPLY, or with HL_NAK.  Bad
+//   frames are just dropped - the host times out and tries again.
+//
+//   Settings are read and written by their offset in the settings record (see
+//   settingsRecord in settings.h), which is the layout of each of the EEPROM slots.
+//   The raw EEPROM can be read (the crash records, for example) but not written,
+//   since that would only break the CRC on the slots.
+//
+//   Commands (host to ChapR)			payload
+//   ------------------------			-------
+//   HL_PING					-	reply: HL_VERSION, sizeof(settingsRecord)
+//   HL_READ	raw EEPROM			addr (LSB, MSB), count
+//						reply: addr (LSB, MSB), the bytes
+//   HL_GET	settings record			offset, count
+//						reply: offset, the bytes
+//   HL_SET	settings record			offset, the bytes - they are committed and
+//						used right away.  If any of them can't be
+//						set (a header byte, or out of the range the
+//						console allows) none are, and the NAK is
+//						HL_NAK_RANGE.  reply: offset, count set
+//   HL_STREAM	subscribe to HL_STATE		period (ms, LSB, 0 is off) - the ChapR may
+//						make it longer.  reply: the period it used
+//   HL_RESCAN	enumerate the USB devices again	-	reply: -
+//
+//   HL_STATE frames are sent, unasked, every period while subscribed:
+//
+//	seq		rolling count, to see when frames were skipped	: 0
+//	time		millis() (LSB first)				: 1-4
+//	flags		HL_STATE_XXX					: 5
+//	loop		longest loop() since the last frame (us, LSB)	: 6-7
+//	personality	longest personalityLoop() (us, LSB)		: 8-9
+//	battery		battery (mV, LSB)				: 10-11
+//	gamepad 1	type, x1, y1, x2, y2, x3, y3, buttons (LSB, MSB),
+//			tophat (as in gamepad.h)			: 12-21
+//	gamepad 2	the same					: 22-31
+//
+
+#ifndef HOSTLINK_H
+#define HOSTLINK_H
+
+#define HL_SYNC		0xA5
+#define HL_VERSION	1
+#define HL_MAX_PAYLOAD	32
+
+#define HL_PING		0x01
+#define HL_READ		0x02
+#define HL_GET		0x03
+#define HL_SET		0x04
+#define HL_STREAM	0x05
+#define HL_RESCAN	0x06
+#define HL_STATE	0x10
+#define HL_NAK		0x7F		// payload: the cmd, and HL_NAK_XXX
+#define HL_REPLY	0x80		// or'd into the cmd of a reply
+
+#define HL_NAK_CMD	1		// unknown command
+#define HL_NAK_ARGS	2		// bad payload (size, address...)
+#define HL_NAK_RANGE	3		// HL_SET of a value out of range (or a byte that can't be set)
+
+#define HL_STATE_CONNECTED	0x01	// BT is connected
+#define HL_STATE_LOW		0x02	// battery is low
+#define HL_STATE_SIZE		32
+#define HL_STREAM_MIN		20	// ms - a state frame takes 10ms at 38400 baud
+
+extern bool hostlinkByte(byte);
+extern void hostlinkIdle();
+extern void hostlinkLoop(Gamepad *, Gamepad *, unsigned long, unsigned long);
+extern bool hostlinkRescan();
+
+#endif HOSTLINK_H
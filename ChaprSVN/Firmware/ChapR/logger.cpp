@@ -0,0 +1,180 @@
+//
+// logger.cpp
+//
+//   See logger.h.  The records go into one of two RAM buffers.  When that
+//   buffer fills up it is handed off to be written, and records go into
+//   the other one in the meantime.  logIdle() writes a full buffer with one
+//   WRF, so the flash drive is only ever talked to at the bottom of loop()
+//   and never in the middle of reading the gamepads or sending a frame.
+//
+//   The file is opened for writing (which appends) on the first write and
+//   closed every LOG_CLOSE_EVERY writes - the close is what updates the
+//   directory on the drive, so that is all that is lost if the drive is
+//   pulled (or the battery dies) before the next close.
+//
+
+#include <Arduino.h>
+#include "logger.h"
+#include "VDIP.h"
+#include "settings.h"
+
+extern settings myEEPROM;
+
+#define LOG_RECORD_SIZE		8
+#define LOG_RECORDS		8				// per buffer
+#define LOG_BUFSIZE		(LOG_RECORD_SIZE * LOG_RECORDS)
+#define LOG_CLOSE_EVERY		8				// writes between closes
+#define LOG_LOOP_EVERY		1000				// ms between LOG_LOOP records
+#define LOG_BATTERY_EVERY	10000				// ms between LOG_BATTERY records
+
+static VDIP		*logVDIP = NULL;		// NULL when not logging
+static char		 logName[] = LOG_FILENAME;
+
+static byte		 logBuffer[2][LOG_BUFSIZE];
+static byte		 logFill = 0;			// the buffer records are going into
+static byte		 logCount = 0;			// bytes in that buffer
+static bool		 logFull = false;		// the other buffer is waiting for logIdle()
+static unsigned int	 logDropped = 0;		// records lost since the last LOG_DROPPED
+
+static bool		 logOpen = false;
+static byte		 logWrites = 0;
+
+static unsigned long	 logLastLoop;
+static unsigned long	 logMaxLoop;			// longest loop, in us
+static unsigned long	 logMaxPersonality;		// longest personalityLoop(), in us
+static unsigned long	 logLastBattery;
+
+//
+// logSwitch() - if the buffer being filled is full, and the other one has been written,
+//		 hand it off to logIdle() and start filling the other one.
+//
+static void logSwitch()
+{
+     if (logCount == LOG_BUFSIZE && !logFull) {
+	  logFull = true;
+	  logFill ^= 1;
+	  logCount = 0;
+     }
+}
+
+//
+// logPut() - add one record to the buffer being filled, switching buffers when it is
+//	      full.  If BOTH are full the flash drive isn't keeping up (or isn't being
+//	      written at all) so the record is just counted as dropped.
+//
+static void logPut(byte type, byte arg, unsigned int value)
+{
+     unsigned long	 now = millis();
+     byte		*record;
+
+     if (logCount == LOG_BUFSIZE) {
+	  logDropped++;
+	  return;
+     }
+
+     record = &logBuffer[logFill][logCount];
+     record[0] = type;
+     record[1] = arg;
+     record[2] = (byte) value;
+     record[3] = (byte) (value >> 8);
+     record[4] = (byte) now;
+     record[5] = (byte) (now >> 8);
+     record[6] = (byte) (now >> 16);
+     record[7] = (byte) (now >> 24);
+     logCount += LOG_RECORD_SIZE;
+     logSwitch();
+}
+
+//
+// logAttach() - start logging to the flash drive on the given VDIP.  It is called when
+//		 the flash drive is processed and logging is turned on.
+//
+void logAttach(VDIP *vdip)
+{
+     logVDIP = vdip;
+     logOpen = false;
+     logLastLoop = logLastBattery = millis();
+     logMaxLoop = logMaxPersonality = 0;
+     logEvent(LOG_START, myEEPROM.getPersonality(), myEEPROM.getSpeed());
+}
+
+//
+// logDetach() - the flash drive is gone.  Whatever hasn't been written is thrown away.
+//
+void logDetach()
+{
+     logVDIP = NULL;
+     logOpen = false;
+     logFull = false;
+     logCount = 0;
+     logDropped = 0;
+}
+
+void logEvent(byte type, byte arg /* = 0 */, unsigned int value /* = 0 */)
+{
+     if (!logVDIP) {
+	  return;
+     }
+
+     if (logDropped && logCount < LOG_BUFSIZE) {
+	  unsigned int dropped = logDropped;
+	  logDropped = 0;
+	  logPut(LOG_DROPPED, 0, dropped);
+     }
+     logPut(type, arg, value);
+}
+
+//
+// logLoop() - called every loop with how long (in us) it took, and how much of that was
+//	       the personality.  Only the worst of each is logged, once a second.
+//
+void logLoop(unsigned long loopTime, unsigned long personalityTime)
+{
+     if (!logVDIP) {
+	  return;
+     }
+
+     logMaxLoop = max(logMaxLoop, loopTime);
+     logMaxPersonality = max(logMaxPersonality, personalityTime);
+
+     if (millis() - logLastLoop >= LOG_LOOP_EVERY) {
+	  logEvent(LOG_LOOP,
+		   (byte) min(logMaxPersonality / 1000, 255UL),
+		   (unsigned int) min(logMaxLoop / 1000, 65535UL));
+	  logMaxLoop = logMaxPersonality = 0;
+	  logLastLoop = millis();
+     }
+}
+
+void logBattery(int voltage)
+{
+     if (logVDIP && millis() - logLastBattery >= LOG_BATTERY_EVERY) {
+	  logEvent(LOG_BATTERY, 0, voltage);
+	  logLastBattery = millis();
+     }
+}
+
+//
+// logIdle() - write out the full buffer, if there is one.  This is called at the bottom
+//	       of loop() where the time it takes comes out of the wait between frames.
+//
+void logIdle()
+{
+     if (!logVDIP || !logFull) {
+	  return;
+     }
+
+     if (!logOpen) {
+	  logVDIP->cmd(VDIP_OPW, logName, DEFAULTTIMEOUT);
+	  logOpen = true;
+     }
+
+     logVDIP->cmd(VDIP_WRF, (char *) logBuffer[logFill ^ 1], DEFAULTTIMEOUT, LOG_BUFSIZE);
+     logFull = false;
+     logSwitch();					// the other may have filled meanwhile
+
+     if (++logWrites % LOG_CLOSE_EVERY == 0) {
+	  logVDIP->cmd(VDIP_CLF, logName, DEFAULTTIMEOUT);
+	  logOpen = false;
+     }
+}
@@ -0,0 +1,44 @@
+//
+// logger.h
+//
+//   Optional logging of what happened during a practice to the flash drive
+//   (see logger.cpp).  When logging is turned on (the "log" setting in
+//   chapr.cfg) and a flash drive is in port 2, small binary records are
+//   appended to LOG_FILENAME on the drive.  Each record is:
+//
+//	,------,-----,-------------,---------------------,
+//	| type | arg | value (LSB) | time (millis(), LSB) |
+//	'------'-----'-------------'---------------------'
+//	   1      1        2                  4            = 8 bytes
+//
+//   The records are collected in RAM and only written out (a buffer at a
+//   time) from logIdle(), which is called in the "dead" time at the bottom
+//   of loop().
+//
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "VDIP.h"
+
+#define LOG_FILENAME	"chapr.log"
+
+// record types - arg and value are described for each
+
+#define LOG_START	1	// logging started - arg is the personality, value is the lag setting
+#define LOG_LOOP	2	// once a second - arg is the longest personalityLoop() (ms), value the longest loop (ms)
+#define LOG_CONNECT	3	// BT connected
+#define LOG_DISCONNECT	4	// BT disconnected
+#define LOG_MATCH	5	// matchmode entered a state - arg is the mmState, value how late (ms)
+#define LOG_BATTERY	6	// every LOG_BATTERY_EVERY - value is the battery voltage (x10)
+#define LOG_KILL	7	// the kill (power) button was pressed - value is press to kill sent (x0.1ms)
+#define LOG_DROPPED	8	// records were lost because the flash drive fell behind - value is how many
+
+extern void logAttach(VDIP *);
+extern void logDetach();
+extern void logEvent(byte type, byte arg = 0, unsigned int value = 0);
+extern void logLoop(unsigned long loopTime, unsigned long personalityTime);
+extern void logBattery(int voltage);
+extern void logIdle();
+
+#endif LOGGER_H
@@ -14,54 +14,58 @@
 //   triggered for the personality and when.  In this list the "Event" is what happens
 //   in the system, and how it resonds.  For example, the Event "Button" means that the
 //   action button is pressed.  The Event "Kill" means that the power button is pressed.
-//   The "(timer)" event means that the timer has gone off.  And the "(entry)" event
+//   The "(timer)" event means that the state's deadline has come.  And the "(entry)" event
 //   simply means that the new state has been entered (just used to indicate callbacks).
 //
-//   You'll see that some of the calls have ANDs (&&) and ORs (||) between them.  This
-//   indicates that the first call is done, and depending upon the outcome, the second
-//   one is done.  For &&, this effectively means that if the first one returns TRUE
-//   that the second should be called.  For || (or), this means that the second one is
-//   going to be called after the first, no matter what.
+//   The states and what gets them from one to the next are in the mmTable below, rather
+//   than spread through the code.  On entering a state, the personality callback is
+//   always called first.  Then the state may go right on to another one (some only if the
+//   callback returned TRUE), and may set a deadline for moving on.
 //
-// State	    Event	Calls							Meaning
-// ------------	    -----------	-------------------------------------------------------	-----------------
-// MM_OFF	    (entry)	timerOff()
-//		    Button	nextState(MM_AUTO_PREP)					start of a match
-//		    Kill	nextState(MM_OFF)					(useless) kill of the match
+// State	    Event	Next					Meaning
+// ------------	    -----------	--------------------------------------	-----------------
+// MM_OFF	    Button	MM_AUTO_PREP				start of a match
 //
-// MM_AUTO_PREP	    (entry)	callback(MM_AUTO_PREP) && nextState(MM_AUTO_START)
-//		    Button	nextState(MM_AUTO_START)
-//		    Kill	nextState(MM_KILL)
+// MM_AUTO_PREP	    (entry)	MM_AUTO_START if the callback was TRUE
+//		    Button	MM_AUTO_START
 //
-// MM_AUTO_START    (entry)	callback(MM_AUTO_START) || timerstart(AUTOTIME)
-//		    (timer)	nextState(MM_AUTO_END)
-//		    Kill	nextState(MM_KILL)
+// MM_AUTO_START    (entry)	auto starts now
+//		    (timer)	MM_AUTO_END at start + auto
+//		    Button	MM_KILL
 //
-// MM_AUTO_END	    (entry)	callback(MM_AUTO_END) || nextState(MM_TELEOP_PREP)
+// MM_AUTO_END	    (entry)	MM_TELEOP_PREP
 //
-// MM_TELEOP_PREP   (entry)	callback(MM_TELEOP_PREP) && nextState(MM_TELEOPSTART)
-//		    Button	nextState(MM_TELEOPSTART)
-//		    Kill	nextState(MM_KILL)
+// MM_TELEOP_PREP   (entry)	MM_TELEOP_START if the callback was TRUE
+//		    Button	MM_TELEOP_START
 //
-// MM_TELEOP_START  (entry)	callback(MM_TELEOP_START) && timerstart(TELEOPTIME)
-//		    (timer)	nextState(MM_ENDGAME_START)
-//		    Kill	nextState(MM_KILL)
+// MM_TELEOP_START  (entry)	teleop starts now
+//		    (timer)	MM_ENDGAME_START at start + tele
+//		    Button	MM_KILL
 //
-// MM_ENDGAME_START (entry)	callback(MM_ENDGAME_START) || timerstart(ENDGAMETIME)
-//		    (timer)	nextState(MM_ENDGAME_END)
-//		    Kill	nextState(MM_KILL)
+// MM_ENDGAME_START (timer)	MM_ENDGAME_END at start + tele + end
+//		    Button	MM_KILL
 //
-// MM_ENDGAME_END   (entry)	callback(MM_ENDGAME_END) || nextState(MM_TELEOP_END)
+// MM_ENDGAME_END   (entry)	MM_TELEOP_END
 //
-// MM_TELEOP_END    (entry)	callback(MM_TELEOP_END) || nextState(MM_OFF)
+// MM_TELEOP_END    (entry)	MM_OFF
 //
-// MM_KILL	    (entry)	callback(MM_KILL) || nextState(MM_OFF)
+// MM_KILL	    (entry)	MM_OFF
+//
+//   Kill goes to MM_KILL from any state (see MatchKillProcess()).
+//
+//   The deadlines are all figured from when the phase (auto or teleop) started, not from
+//   when the last state was entered, so the time it takes for loop() to notice a deadline
+//   (up to the lag) doesn't add up from one state to the next - a match ends when the
+//   field's would.  A state that is reached because of a deadline "started" at the
+//   deadline, as do the states it goes on to right away.  How late each state was
+//   entered (in ms) is logged with it (see logger.h).
 //
 
 #include <Arduino.h>
 #include "matchmode.h"
 #include "settings.h"
 #include "sound.h"
+#include "logger.h"
 
 // note that the sound is necessary because the matchmode active/inactive sound is
 // done in this routine.  Settings is necessary because the settings are checked
@@ -71,9 +75,42 @@
 extern settings myEEPROM;
 extern sound beeper;
 
+#define MM_NONE		0xff		// no transition
+
+#define MM_IF_TRUE	0x01		// go to "entry" only if the callback returned TRUE
+#define MM_ANCHOR	0x02		// a phase starts when this state is entered
+#define MM_LEN_AUTO	0x04		// the deadline is the phase start plus these lengths
+#define MM_LEN_TELE	0x08
+#define MM_LEN_END	0x10
+
+//
+// mmTable - for each state (in mmState order), where to go after entering it, on the
+//	     button, and at the deadline.
+//
+typedef struct {
+     byte	flags;			// MM_IF_TRUE, MM_ANCHOR, MM_LEN_XXX
+     byte	entry;			// where to go right after the entry callback
+     byte	button;			// where the button goes
+     byte	timed;			// where the deadline goes
+} mmTransition;
+
+static const mmTransition mmTable[] PROGMEM = {
+     //	flags				entry		button		timed
+     { 0,				MM_NONE,	MM_AUTO_PREP,	MM_NONE },		// MM_OFF
+     { MM_IF_TRUE,			MM_AUTO_START,	MM_AUTO_START,	MM_NONE },		// MM_AUTO_PREP
+     { MM_ANCHOR|MM_LEN_AUTO,		MM_NONE,	MM_KILL,	MM_AUTO_END },		// MM_AUTO_START
+     { 0,				MM_TELEOP_PREP,	MM_NONE,	MM_NONE },		// MM_AUTO_END
+     { MM_IF_TRUE,			MM_TELEOP_START,MM_TELEOP_START,MM_NONE },		// MM_TELEOP_PREP
+     { MM_ANCHOR|MM_LEN_TELE,		MM_NONE,	MM_KILL,	MM_ENDGAME_START },	// MM_TELEOP_START
+     { MM_LEN_TELE|MM_LEN_END,		MM_NONE,	MM_KILL,	MM_ENDGAME_END },	// MM_ENDGAME_START
+     { 0,				MM_TELEOP_END,	MM_NONE,	MM_NONE },		// MM_ENDGAME_END
+     { 0,				MM_OFF,		MM_NONE,	MM_NONE },		// MM_TELEOP_END
+     { 0,				MM_OFF,		MM_NONE,	MM_NONE },		// MM_KILL
+};
+
 MatchMode::MatchMode() : active(false),
 			 currentState(MM_OFF),
-			 timerActive(false),
+			 deadlineActive(false),
 			 lastPressTime(0)
 {
 }
@@ -105,31 +142,15 @@ bool MatchMode::isMatchEnabled()
 //
 void MatchMode::MatchButtonProcess(void *rock_incoming)
 {
-     rock = rock_incoming;
-
-     switch(currentState){
+     byte	next = pgm_read_byte(&mmTable[currentState].button);
 
-     case MM_OFF:
-	  enterState(MM_AUTO_PREP);
-	  break;
-
-     case MM_AUTO_PREP:
-	  enterState(MM_AUTO_START);
-	  break;
-
-     case MM_TELEOP_PREP:
-	  enterState(MM_TELEOP_START);
-	  break;
-
-     case MM_AUTO_START:
-     case MM_TELEOP_START:
-     case MM_ENDGAME_START:
-          enterState(MM_KILL);
-	  beeper.kill();
-          break;
+     rock = rock_incoming;
 
-     default:
-	  break;
+     if (next != MM_NONE) {
+	  enterState((mmState) next, millis());
+	  if (next == MM_KILL) {
+	       beeper.kill();
+	  }
      }
 }
 
@@ -157,7 +178,7 @@ void MatchMode::MatchKillProcess(void *rock_incoming)
 	 // which will call the kill callback, and then jump back to this state.
 	 // Note that this is done RIGHT AWAY because kill should happen immediately
 	 
-	 enterState(MM_KILL);
+	 enterState(MM_KILL, millis());
 
 	 // check to see if the kill switch was pressed twice within the MATCHMODE_SWITCH_DELAY
 	 // if so, deactivate matchmode
@@ -176,122 +197,68 @@ void MatchMode::MatchKillProcess(void *rock_incoming)
 
        // in any other state, the kill is issued
        else {
-	 enterState(MM_KILL);
+	 enterState(MM_KILL, millis());
 	 beeper.kill();
        }
        //     }
 }
 
 //
-// enterState() - implement the (entry) of a new state.  Note that this routine can be recursive,
-//		  as it jumps from state to state
+// enterState() - implement the (entry) of a new state, and of the ones it goes right on
+//		  to.  "at" is when the state should have been entered - millis() for
+//		  the button and kill, the deadline when it was the timer.
 //
-void MatchMode::enterState(mmState newState)
+void MatchMode::enterState(mmState newState, unsigned long at)
 {
-     currentState = newState;
+     mmTransition	t;
+     unsigned long	length;
 
-     switch(newState) {
+     while (true) {
+	  currentState = newState;
+	  logEvent(LOG_MATCH, newState, (unsigned int) min(millis() - at, 65535UL));
+	  memcpy_P(&t, &mmTable[newState], sizeof(t));
 
-     case MM_OFF:
-	  callBack();
-	  timerOff();
-	  break;
+	  bool result = callBack();
 
-     case MM_AUTO_PREP:
-	  if(callBack()) {	 // if it returns TRUE, then we go on, not waiting for a button press
-	       enterState(MM_AUTO_START);
+	  if (t.flags & MM_ANCHOR) {
+	       phaseStart = at;
 	  }
-	  break;
 
-    case MM_AUTO_START:
-	 callBack();
-	 timerStart(((long) myEEPROM.getAutoLen())*1000);
-	 break;
-
-    case MM_AUTO_END:
-	 callBack();
-	 enterState(MM_TELEOP_PREP);
-	 break;
-
-    case MM_TELEOP_PREP:
-	 if(callBack()) {	// if it returns TRUE, then we go on, not waiting for a button press
-	       enterState(MM_TELEOP_START);
-	 }
-	 break;
-	 
-    case MM_TELEOP_START:
-	 callBack();
-	 timerStart(((long) myEEPROM.getTeleLen())*1000);
-	 break;
-
-    case MM_ENDGAME_START:
-	 callBack();
-	 timerStart(((long) myEEPROM.getEndLen())*1000);
-	 break;
-
-    case MM_ENDGAME_END:
-	 callBack();
-	 enterState(MM_TELEOP_END);
-	 break;
+	  deadlineActive = (t.timed != MM_NONE);
+	  if (deadlineActive) {
+	       length = 0;
+	       if (t.flags & MM_LEN_AUTO) {
+		    length += myEEPROM.getAutoLen();
+	       }
+	       if (t.flags & MM_LEN_TELE) {
+		    length += myEEPROM.getTeleLen();
+	       }
+	       if (t.flags & MM_LEN_END) {
+		    length += myEEPROM.getEndLen();
+	       }
+	       deadline = phaseStart + length * 1000;
+	  }
 
-    case MM_TELEOP_END:				// both TELEOP_END and KILL have the same behavior
-    case MM_KILL:				//   do the callback, then go to OFF
-	 callBack();
-	 enterState(MM_OFF);
-	 break;
-    }
+	  if (t.entry == MM_NONE || ((t.flags & MM_IF_TRUE) && !result)) {
+	       break;
+	  }
+	  newState = (mmState) t.entry;
+     }
 }
 
 //
 // Loop() - called during the standard processing loop.  Only used to notice when
-//	    the timers go off.  Button presses are processed elsewhere.
+//	    the deadline has come.  Button presses are processed elsewhere.
 //
 void MatchMode::MatchLoopProcess(void *rock_incoming)
 {
      rock = rock_incoming;
 
-     if(timerExpiredEvent()) {
-	  timerOff();
-	  switch(currentState) {
-
-	  case MM_AUTO_START:
-	       enterState(MM_AUTO_END);
-	       break;
-
-	  case MM_TELEOP_START:
-	       enterState(MM_ENDGAME_START);
-	       break;
-
-	  case MM_ENDGAME_START:
-	       enterState(MM_ENDGAME_END);
-	       break;
-
-	  default:
-	       break;
-	  }
+     if (deadlineActive && (long) (millis() - deadline) >= 0) {
+	  enterState((mmState) pgm_read_byte(&mmTable[currentState].timed), deadline);
      }
 }
 
-void MatchMode::timerStart(long timerMillis)
-{
-     timerActive = true;
-     timerTarget = millis() + timerMillis;
-}
-
-//
-// timerExpiredEvent () - returns true if the a "timer expired" event has occured.  This
-//		    means that the timer was active, and has reached its time.
-//
-bool MatchMode::timerExpiredEvent()
-{
-     return(timerActive && millis() > timerTarget);
-}
-
-void MatchMode::timerOff()
-{
-     timerActive = false;
-}
-
 bool MatchMode::callBack()
 {
 	return(matchStateProcess(currentState,rock));
@@ -304,5 +271,5 @@ bool MatchMode::callBack()
 void MatchMode::MatchReset()
 {
   currentState = MM_OFF;
-  timerOff();
+  deadlineActive = false;
 }
@@ -45,14 +45,12 @@ class MatchMode
 private:
      bool		active;			// true if matchmode is active currently
      mmState		currentState;
-     void 		enterState(mmState);	// used when moving between states, runs the state entry stuff
+     void 		enterState(mmState, unsigned long);	// used when moving between states, runs the state entry stuff
      bool		callBack();		
 
-     bool		timerActive;
-     long		timerTarget;
-     void		timerStart(long);	// fires-up the timer for a certainnumber of seconds
-     void		timerOff();		// turns-off the timer
-     bool		timerExpiredEvent();	// returns true if a timer has "gone off"
+     unsigned long	phaseStart;		// when auto (or teleop) started - the deadlines count from here
+     bool		deadlineActive;
+     unsigned long	deadline;		// millis() when the current state moves on
 
      long		lastPressTime;		// use to monitor matchmode switching with KILL switch
 
@@ -20,7 +20,102 @@ extern settings myEEPROM;
 
 typedef unsigned char byte;
 
-char hexConverter[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+static const char hexConverter[] PROGMEM = "0123456789ABCDEF";
+
+//
+// TRANSPORT - normally the NXT is on the other end of the BT connection.  But when the
+//   USB tether is on (see settings.h) and an NXT is plugged into the ChapR's USB port, the
+//   VDIP attaches it here, and all of the routines below talk to it over USB instead.
+//   Commands are still composed with the two BT size bytes on the front (the routines
+//   don't need to care which way they're going) - the size is just dropped for USB.
+//
+static VDIP	*tetherVDIP = NULL;
+static int	 tetherDev = -1;		// the VDIP usb device of the NXT (-1 if none)
+
+#define NXT_USB_POLL	5			// ms between reads while waiting for a USB reply
+
+void nxtTetherAttach(VDIP *vdip, int usbDev)
+{
+     tetherVDIP = vdip;
+     tetherDev = usbDev;
+}
+
+void nxtTetherDetach()
+{
+     tetherDev = -1;
+}
+
+bool nxtTethered()
+{
+     return(tetherDev >= 0);
+}
+
+//
+// nxtConnected() - true if there is an NXT to talk to, one way or the other.
+//
+bool nxtConnected(BT *bt)
+{
+     return(nxtTethered() || bt->connected());
+}
+
+//
+// nxtSend() - send a composed command (BT size bytes and all) to the NXT.
+//
+void nxtSend(BT *bt, byte *msg, int size)
+{
+     if (nxtTethered()) {
+	  tetherVDIP->cmd(VDIP_SC,NULL,100,tetherDev);
+	  tetherVDIP->cmd(VDIP_DSD,(char *)msg+2,100,size-2);
+     } else {
+	  (void)bt->btWrite(msg,size);
+     }
+}
+
+//
+// nxtRecvReply() - wait (up to timeout ms) for a reply from the NXT, putting it in the
+//		    buffer (which needs to be 64 bytes) WITHOUT the BT size bytes.  Returns
+//		    the size of the reply, which the callers check against what they
+//		    expect.  Zero (or garbage) is returned if nothing good came back.
+//
+int nxtRecvReply(BT *bt, byte *buf, long timeout)
+{
+     int	size;
+
+     if (nxtTethered()) {
+	  unsigned long target = millis() + timeout;
+	  do {
+	       tetherVDIP->cmd(VDIP_SC,NULL,100,tetherDev);
+	       if ((size = tetherVDIP->cmd(VDIP_DRD,(char *)buf,100)) > 0) {
+		    return(size);
+	       }
+	       delay(NXT_USB_POLL);
+	  } while ((long)(millis() - target) < 0);
+	  return(0);
+     }
+
+     if (bt->recv(buf,2,timeout) != 2 || buf[1] != 0 || buf[0] > NXT_MSG_REPLY_SIZE) {
+	  return(0);
+     }
+
+     size = buf[0];
+     return(bt->recv(buf,size,timeout) == size ? size : 0);
+}
+
+//
+// nxtFlush() - get rid of anything left over from the NXT.
+//
+void nxtFlush(BT *bt)
+{
+     char	junk[64];
+
+     if (nxtTethered()) {
+	  tetherVDIP->cmd(VDIP_SC,NULL,100,tetherDev);
+	  while (tetherVDIP->cmd(VDIP_DRD,junk,100) > 0)
+	       ;
+     } else {
+	  bt->flushReturnData();
+     }
+}
 
 
 //
@@ -68,8 +163,8 @@ bool nxtQueryDevice(VDIP *vdip, int usbDev, char **name, char **btAddress, long
           int j = 0;
           for (int i = 18; i < 24; i++){
             //the last byte is always zero (sorta like a null terminator)
-            btAddressbuf[j++] = hexConverter[(cbuf[i]>>4)&0x0F];  
-            btAddressbuf[j++] = hexConverter[cbuf[i]&0x0F];
+            btAddressbuf[j++] = pgm_read_byte(&hexConverter[(cbuf[i]>>4)&0x0F]);
+            btAddressbuf[j++] = pgm_read_byte(&hexConverter[cbuf[i]&0x0F]);
           }
           btAddressbuf[j] = '\0';
           
@@ -97,7 +192,7 @@ bool nxtGetProgramName(BT *bt, char *buf)
      byte	outbuff[64];
      int	size = 0;
      
-     if (!bt->connected()){
+     if (!nxtConnected(bt)){
        return false;
      }
      
@@ -108,23 +203,18 @@ bool nxtGetProgramName(BT *bt, char *buf)
      outbuff[size++] = NXT_DIR_CMD;
      outbuff[size++] = NXT_DIR_CURRENT;
      
-     bt->flushReturnData(); // somehow there is data in the Bluetooth receive buffer TODO figure out why
+     nxtFlush(bt); // somehow there is data in the Bluetooth receive buffer TODO figure out why
      
-     (void)bt->btWrite(outbuff,size);
-     bt->recv(outbuff,2,1000); 
-     size = outbuff[0];
+     nxtSend(bt,outbuff,size);
+     size = nxtRecvReply(bt,outbuff,1000);
        
      // check to make sure the proper message is received
        
      if (size != 23){ 
-       bt->flushReturnData();
+       nxtFlush(bt);
        return false;
      }
        
-     // receive the rest of the data
-       
-     bt->recv(outbuff,size,1000); // timeout of 1000 milliseconds
-       
      // check to see if a program is running
        
      if (outbuff[NXT_STATUS] == (byte) NXT_ERR_NOACT){ // the error constant is cast to a byte to prevent sign extension
@@ -151,7 +241,7 @@ int nxtOpenFileToRead(BT *bt, char *buf, long *fileSize)
      byte	outbuff[64];
      int	size = 0;
      
-     if (!bt->connected()){
+     if (!nxtConnected(bt)){
        return -1;
      }
        
@@ -166,22 +256,18 @@ int nxtOpenFileToRead(BT *bt, char *buf, long *fileSize)
      strncpy((char *)outbuff + size, buf, NXT_PRGM_NAME_SIZE);
      size += NXT_PRGM_NAME_SIZE;
        
-     bt->flushReturnData(); // somehow there is data in the Bluetooth receive buffer TODO figure out why
+     nxtFlush(bt); // somehow there is data in the Bluetooth receive buffer TODO figure out why
      
-     (void)bt->btWrite(outbuff,size);
-     bt->recv(outbuff,2,1000); 
-     size = outbuff[0];
+     nxtSend(bt,outbuff,size);
+     size = nxtRecvReply(bt,outbuff,1000);
        
      // check to make sure the proper message is received
        
      if (size != 8){ 
-       bt->flushReturnData();
+       nxtFlush(bt);
        return -1;
      }
        
-     //receive the rest of the data
-       
-     bt->recv(outbuff,size,1000);
 
      if(outbuff[2] != 0) {
 	  // couldn't open file
@@ -204,57 +290,92 @@ int nxtOpenFileToRead(BT *bt, char *buf, long *fileSize)
 }
 
 //
-// nxtReadFile() - if everything goes well, the number of bytes read will be returned. If the size of
-//                 the Bluetooth message isn't what it is supposed to be or returns an error, the method
-//                 will return a -1. If the method does not return a -1, the buffer given will be filled 
-//                 with the contents of the file specified by the handle you passed to the method. The
-//                 amount of data to read (numToRead) should never be over 255 - if so, this routine
-//                 won't work as expected.
+// nxtReadFileStream() - reads count bytes from the open file (handle) in chunks of up to
+//			 NXT_READ_CHUNK bytes, handing each chunk to the sink as it comes
+//			 in.  The data is binary - NULLs and all.  Each read request is
+//			 sent as soon as the previous reply is in, without the usual delay
+//			 and flush.  (The next request can't go out while the current
+//			 reply is still arriving - SoftwareSerial can't receive while it
+//			 is sending.)  Returns the number of bytes read, or -1 if
+//			 something went wrong along the way (the sink may have gotten some
+//			 of the data by then).
 //
-int nxtReadFile(BT *bt, char *buf, int numToRead, int handle)
+long nxtReadFileStream(BT *bt, int handle, long count, nxtFileSink sink, void *rock)
 {
-     byte	outbuff[64];
-     int	size = 0;
-     
-     if (!bt->connected()){
-       return -1;
-     }
-     
-     outbuff[size++] = 5;			// BT size does NOT include these two size bytes
-     outbuff[size++] = 0x00;			// this is the BT MSB of size - always zero
-     outbuff[size++] = NXT_SYS_CMD;
-     outbuff[size++] = NXT_SYS_READ;
-     outbuff[size++] = handle;
-     outbuff[size++] = numToRead;
-     outbuff[size++] = 0; // normally the most significant byte, but the size will never be over 255
-            
-     bt->flushReturnData(); // somehow there is data in the Bluetooth receive buffer TODO figure out why
-     
-     (void)bt->btWrite(outbuff,size);
-     bt->recv(outbuff,2,1000);   //  we wait for the NXT for up to 1 second for a response
-     size = outbuff[0];
-       
-     // since we asked for numToRead bytes, the return BT packet should be numToRead + 6
-     // or something has gone wrong.
-       
-     if (size != numToRead+6) { 
-       bt->flushReturnData();
+     byte	outbuff[NXT_READ_CHUNK + 8];	// BT size, and 6 bytes of reply header (fits in 64)
+     long	done = 0;
+     int	size;
+     int	want;
+     int	got;
+
+     if (!nxtConnected(bt)){
        return -1;
      }
-       
-     //receive the rest of the data
-       
-     bt->recv(outbuff,size,1000);
-       
-     if (outbuff[2] != 0){ //checks that the read was successful
-        return -1;
+
+     nxtFlush(bt); // somehow there is data in the Bluetooth receive buffer TODO figure out why
+
+     while (done < count) {
+
+	  want = (int) min(count - done, (long) NXT_READ_CHUNK);
+	  size = 0;
+
+	  outbuff[size++] = 5;			// BT size does NOT include these two size bytes
+	  outbuff[size++] = 0x00;		// this is the BT MSB of size - always zero
+	  outbuff[size++] = NXT_SYS_CMD;
+	  outbuff[size++] = NXT_SYS_READ;
+	  outbuff[size++] = handle;
+	  outbuff[size++] = want;
+	  outbuff[size++] = 0;			// MSB of the size - chunks are never that big
+
+	  nxtSend(bt,outbuff,size);
+
+	  // the reply is type, cmd, status, handle, and the 2 byte count of the data - then
+	  // the data itself - so it should be want + 6 or something has gone wrong
+
+	  if (nxtRecvReply(bt,outbuff,1000) != want + 6 || outbuff[NXT_STATUS] != NXT_SYS_ERR_NONE) {
+	       nxtFlush(bt);
+	       return -1;
+	  }
+
+	  got = outbuff[4] | (outbuff[5] << 8);
+	  if (got > want) {
+	       return -1;
+	  }
+
+	  (*sink)(outbuff + 6, got, rock);
+	  done += got;
+
+	  if (got < want) {			// shouldn't happen, but don't spin forever
+	       break;
+	  }
      }
-       
-     //copies the data into buf
-       
-     strncpy(buf, (char *) outbuff + 6, numToRead);
-     
-     return numToRead; // amount of data read
+
+     return done;
+}
+
+//
+// nxtBufferSink() - the sink for nxtReadFile(), the rock is a pointer to where the next
+//		     bytes go.
+//
+static void nxtBufferSink(byte *data, int size, void *rock)
+{
+     char	**next = (char **) rock;
+
+     memcpy(*next, data, size);
+     *next += size;
+}
+
+//
+// nxtReadFile() - if everything goes well, the number of bytes read will be returned. If
+//                 something goes wrong, the method will return a -1.  The buffer given
+//                 will be filled with numToRead bytes from the file specified by the handle
+//                 you passed to the method - it is NOT null terminated.
+//
+int nxtReadFile(BT *bt, char *buf, int numToRead, int handle)
+{
+     char	*next = buf;
+
+     return (int) nxtReadFileStream(bt, handle, numToRead, nxtBufferSink, (void *) &next);
 } 
 
 //
@@ -266,7 +387,7 @@ bool nxtCloseFile(BT *bt, int handle)
      byte	outbuff[64];
      int	size = 0;
      
-     if (!bt->connected()){
+     if (!nxtConnected(bt)){
        return false;
      }
   
@@ -280,22 +401,18 @@ bool nxtCloseFile(BT *bt, int handle)
      outbuff[size++] = NXT_SYS_CLOSE;
      outbuff[size++] = handle;
        
-     bt->flushReturnData(); // somehow there is data in the Bluetooth receive buffer TODO figure out why
+     nxtFlush(bt); // somehow there is data in the Bluetooth receive buffer TODO figure out why
      
-     (void)bt->btWrite(outbuff,size);
-     bt->recv(outbuff,2,1000); 
-     size = outbuff[0];
+     nxtSend(bt,outbuff,size);
+     size = nxtRecvReply(bt,outbuff,1000);
        
      // check to make sure the proper message is received
        
      if (size != 4){
-       bt->flushReturnData();
+       nxtFlush(bt);
        return false;
      }
        
-     // receive the rest of the data
-       
-     bt->recv(outbuff,size,1000);
 
 //     dumpDataHex("return after trying to close", outbuff, size);
 //     delay(10);
@@ -309,19 +426,59 @@ bool nxtCloseFile(BT *bt, int handle)
      }
 }
 
+//
+// THE CHOSEN PROGRAM CACHE - reading FTCConfig.txt takes three round trips to the NXT
+//   (open, read, close) each with its own delays, which is a long time to wait when
+//   teleop is starting.  So the name is kept here for as long as the BT connection is up,
+//   along with the size of the file to notice when it changes.  The personality is in
+//   charge of calling nxtForgetChosenProgram() when the connection goes away.
+//
+static char	chosenName[NXT_PRGM_NAME_SIZE];
+static long	chosenSize = -1;		// -1 means nothing is cached
+
+//
+// nxtLineSink() - the sink used to pick the first line out of FTCConfig.txt (which used to
+//		   be just the program name, but can have other stuff after it now).
+//
+struct chosenLine {
+     char	*buf;
+     int	 size;		// characters in the name so far
+     bool	 done;		// true once the end of the line has been seen
+};
+
+static void nxtLineSink(byte *data, int size, void *rock)
+{
+     struct chosenLine	*line = (struct chosenLine *) rock;
+
+     for (; size > 0 && !line->done; size--, data++) {
+	  if (*data == '\r' || *data == '\n' || *data == '\0') {
+	       line->done = true;
+	  } else if (line->size < NXT_PRGM_NAME_SIZE - 1) {
+	       line->buf[line->size++] = *data;
+	  } else {
+	       line->size = NXT_PRGM_NAME_SIZE;	// too long to be a program name
+	       line->done = true;
+	  }
+     }
+}
+
 //
 // nxtGetChosenProgram() - fills the buffer with the name of the program loaded into program
 //                         chooser and returns true if successful. If no file is found, false 
 //                         is returned. Also, if an error is encountered along the way, the 
-//                         file will simply be closed.
+//                         file will simply be closed.  This always goes to the NXT, and
+//                         refreshes the cache along the way.
 //
 bool nxtGetChosenProgram(BT *bt, char *buf)
 {
      long       fileSize;
      bool       retVal = false;
      int	handle;
+     struct chosenLine line;
      
-     if (!bt->connected()){
+     chosenSize = -1;
+
+     if (!nxtConnected(bt)){
        return false;
      }
 
@@ -331,20 +488,82 @@ bool nxtGetChosenProgram(BT *bt, char *buf)
      if(handle == -1) {
 	  return(false);
      }
-      
-     if (fileSize < NXT_PRGM_NAME_SIZE){ //the name will not include the null terminator
-     
-         if (nxtReadFile(bt, buf, fileSize, handle) != -1){ //simply gets the bytes
-           buf[fileSize] = '\0'; //null terminates the name of the file
-           retVal = true;
-         }
-         
+
+     // only the first line is needed - and it can't be longer than a program name
+
+     line.buf = buf;
+     line.size = 0;
+     line.done = false;
+
+     if (nxtReadFileStream(bt, handle, min(fileSize, (long) NXT_PRGM_NAME_SIZE), nxtLineSink, (void *) &line) != -1) {
+	  if (line.size > 0 && line.size < NXT_PRGM_NAME_SIZE) {
+	       buf[line.size] = '\0'; //null terminates the name of the file
+	       retVal = true;
+	  }
      }
  
      (void) nxtCloseFile(bt, handle);
+
+     if (retVal) {
+	  strcpy(chosenName, buf);
+	  chosenSize = fileSize;
+     }
+
      return retVal;
 }
 
+//
+// nxtGetChosenProgramCached() - same as above, but only goes to the NXT if the name
+//				 isn't already cached.
+//
+bool nxtGetChosenProgramCached(BT *bt, char *buf)
+{
+     if (chosenSize < 0 || !nxtConnected(bt)) {
+	  return(nxtGetChosenProgram(bt, buf));
+     }
+
+     strcpy(buf, chosenName);
+     return(true);
+}
+
+//
+// nxtCheckChosenProgram() - make sure the cache is still good - if nothing is cached it is
+//			     filled, otherwise the file is opened just to check its size,
+//			     and read again if that changed.  Returns true if the cache is
+//			     good after all of this.  It is the "prefetch" done when there is
+//			     time to spare (like right after connecting), and it is done again
+//			     right before the cached name is used, since the one open and
+//			     close is much quicker than reading the name.  Note that a new
+//			     name of the same length isn't noticed.
+//
+bool nxtCheckChosenProgram(BT *bt)
+{
+     char	buf[NXT_PRGM_NAME_SIZE];
+     long	fileSize;
+     int	handle;
+
+     if (chosenSize >= 0) {
+	  handle = nxtOpenFileToRead(bt, "FTCConfig.txt", &fileSize);
+	  if (handle != -1) {
+	       (void) nxtCloseFile(bt, handle);
+	       if (fileSize == chosenSize) {
+		    return(true);
+	       }
+	  }
+     }
+
+     return(nxtGetChosenProgram(bt, buf));
+}
+
+//
+// nxtForgetChosenProgram() - empty the cache (the connection dropped, so the next NXT
+//			      may not be the same one).
+//
+void nxtForgetChosenProgram()
+{
+     chosenSize = -1;
+}
+
 //
 // nxtRunProgram() - takes in the name of the program to run, returning whether
 //                   or not said program ran. A program would not run (and the 
@@ -356,7 +575,7 @@ bool nxtRunProgram(BT *bt, char *buf)
      byte	outbuff[64];
      int	size = 0;
      
-     if (bt->connected()) {
+     if (nxtConnected(bt)) {
 
        delay(10);
 
@@ -369,19 +588,16 @@ bool nxtRunProgram(BT *bt, char *buf)
        strncpy((char *)outbuff + size, buf, NXT_PRGM_NAME_SIZE);
        size += NXT_PRGM_NAME_SIZE;
        
-       bt->flushReturnData(); // somehow there is data in the Bluetooth receive buffer TODO figure out why
+       nxtFlush(bt); // somehow there is data in the Bluetooth receive buffer TODO figure out why
      
-       (void)bt->btWrite(outbuff,size);
-       bt->recv(outbuff,2,1000); 
-       size = outbuff[0];
+       nxtSend(bt,outbuff,size);
+       size = nxtRecvReply(bt,outbuff,1000);
        
        if (size != 3) {
-         bt->flushReturnData();
+         nxtFlush(bt);
          return false;
        }
        
-       bt->recv(outbuff,size,1000); 
-       
        return outbuff[2] == NXT_ERR_NONE;
      }
      
@@ -421,42 +637,246 @@ int nxtBTMailboxMsgCompose(int mbox, byte *msgbuff, int size)
 
 
 //
-// nxtBTKillCommand() - create a BT message for killing the current program running
-//			on the next.  As above, this COULD be split into two commands -
-//			one that composes the kill message and the other wrap it in
-//			BT - but it is in one to make it more efficient.
+// nxtStopSend() - send the stop program command, without asking for a reply, so there is
+//		   nothing to wait for (see nxtKillStart() below).
 //
+static void nxtStopSend(BT *bt)
+{
+     byte	outbuff[4];
+     int	size = 0;
+
+     outbuff[size++] = 2;			// BT size does NOT include these two size bytes
+     outbuff[size++] = 0x00;			// this is the BT MSB of size - always zero
+     outbuff[size++] = NXT_DIR_CMD_NR;		// direct command, no response
+     outbuff[size++] = NXT_DIR_STOP;		// stop command
+
+     nxtSend(bt,outbuff,size);
+}
 
-bool nxtBTKillCommand(BT *bt)
+//
+// nxtReplyStart() - get ready to collect a reply.  Anything still sitting in the BT receive
+//		     buffer can't be part of it, so it is tossed.
+//
+static void nxtReplyStart(BT *bt, nxtReply *reply, long timeout)
 {
-    byte	outbuff[64];
-    int	size = 0;
-     
-    if (bt->connected()) {
+     while (!nxtTethered() && bt->available()) {
+	  (void)bt->read();
+     }
 
-       delay(10);
+     reply->active = true;
+     reply->size = 0;
+     reply->count = 0;
+     reply->deadline = millis() + timeout;
+}
 
-       outbuff[size++] = 2;			// BT size does NOT include these two size bytes
-       outbuff[size++] = 0x00;			// this is the BT MSB of size - always zero
-       outbuff[size++] = NXT_DIR_CMD;	// direct command, no response
-       outbuff[size++] = NXT_DIR_STOP;		// stop command
-       
-       bt->flushReturnData(); // somehow there is data in the Bluetooth receive buffer TODO figure out why
-     
-       (void)bt->btWrite(outbuff,size);
-       bt->recv(outbuff,2,1000); 
-       size = outbuff[0];
-       
-       if (size != 3) {
-         bt->flushReturnData();
-         return false;
-       }
-       
-       bt->recv(outbuff,size,1000); 
-       
-       return outbuff[2] == NXT_ERR_NONE;
+//
+// nxtMessageReadRequest() - ask the NXT for the message at the head of the given mailbox
+//			     queue.  When remove is false, the message is left in the
+//			     queue (so the program on the NXT still gets it) which makes
+//			     this a way of checking whether the NXT is keeping up with
+//			     the messages sent to it.  The reply is picked up with
+//			     nxtReplyPoll().  Its status is NXT_ERR_MBOX when the queue
+//			     is empty.  Returns false if not connected.
+//
+bool nxtMessageReadRequest(BT *bt, nxtReply *reply, int mbox, bool remove, long timeout)
+{
+     byte	outbuff[8];
+     int	size = 0;
+
+     if (!nxtConnected(bt)) {
+	  return(false);
      }
-    
-     return false;
+
+     outbuff[size++] = 5;			// BT size does NOT include these two size bytes
+     outbuff[size++] = 0x00;			// this is the BT MSB of size - always zero
+     outbuff[size++] = NXT_DIR_CMD;		// direct command - reply required
+     outbuff[size++] = NXT_DIR_RECV;		// MessageRead
+     outbuff[size++] = mbox;			// the "remote" inbox is the one on the NXT
+     outbuff[size++] = 0;			// local inbox - just comes back in the reply
+     outbuff[size++] = remove;
+
+     nxtReplyStart(bt,reply,timeout);
+     nxtSend(bt,outbuff,size);
+
+     return(true);
 }
-
+
+//
+// nxtReplyPoll() - take whatever part of the pending reply has arrived.  Returns the
+//		    status byte of the reply once it is all in, NXT_REPLY_PENDING if it
+//		    is still on its way, or NXT_REPLY_FAILED if it timed out or wasn't
+//		    a reply at all (whatever is left in the receive buffer is tossed).
+//
+int nxtReplyPoll(BT *bt, nxtReply *reply)
+{
+     bool	garbage = false;
+
+     if (!reply->active) {
+	  return(NXT_REPLY_FAILED);
+     }
+
+     if (nxtTethered()) {				// USB replies come in all at once
+	  byte	buf[NXT_MSG_REPLY_SIZE];
+
+	  tetherVDIP->cmd(VDIP_SC,NULL,100,tetherDev);
+	  if (tetherVDIP->cmd(VDIP_DRD,(char *)buf,100) > NXT_STATUS) {
+	       reply->active = false;
+	       memcpy(reply->data,buf,NXT_REPLY_KEEP);
+	       if (reply->data[NXT_TYPE] != NXT_REPLY_CMD) {
+		    return(NXT_REPLY_FAILED);
+	       }
+	       return(reply->data[NXT_STATUS]);
+	  }
+     }
+
+     while (!nxtTethered() && bt->available()) {
+	  byte c = bt->read();
+
+	  if (reply->count == 0) {
+	       reply->size = c;				// LSB of the BT size
+	  } else if (reply->count == 1) {
+	       if (c != 0 || reply->size <= NXT_STATUS || reply->size > NXT_MSG_REPLY_SIZE) {
+		    garbage = true;			// the MSB is always zero
+		    break;
+	       }
+	  } else if (reply->count - 2 < NXT_REPLY_KEEP) {
+	       reply->data[reply->count - 2] = c;
+	  }
+	  reply->count++;
+
+	  if (reply->count == reply->size + 2) {
+	       reply->active = false;
+	       if (reply->data[NXT_TYPE] != NXT_REPLY_CMD) {
+		    return(NXT_REPLY_FAILED);
+	       }
+	       return(reply->data[NXT_STATUS]);
+	  }
+     }
+
+     if (garbage || (long)(millis() - reply->deadline) >= 0) {
+	  nxtFlush(bt);
+	  reply->active = false;
+	  return(NXT_REPLY_FAILED);
+     }
+
+     return(NXT_REPLY_PENDING);
+}
+
+//
+// nxtReplyCancel() - forget about a pending reply (when the connection drops, for example).
+//
+void nxtReplyCancel(nxtReply *reply)
+{
+     reply->active = false;
+}
+
+//
+// nxtProgramNameRequest() - ask the NXT for the name of the running program, picking up
+//			     the reply with nxtReplyPoll().  Its status is NXT_ERR_NOACT
+//			     when there isn't one.
+//
+static void nxtProgramNameRequest(BT *bt, nxtReply *reply, long timeout)
+{
+     byte	outbuff[4];
+     int	size = 0;
+
+     outbuff[size++] = 2;			// BT size does NOT include these two size bytes
+     outbuff[size++] = 0x00;			// this is the BT MSB of size - always zero
+     outbuff[size++] = NXT_DIR_CMD;		// direct command - reply required
+     outbuff[size++] = NXT_DIR_CURRENT;		// get current program name
+
+     nxtReplyStart(bt,reply,timeout);
+     nxtSend(bt,outbuff,size);
+}
+
+//
+// nxtKillStart() - stop whatever program is running on the NXT.  The first stop command
+//		    goes out before this returns, the rest (and the confirmation) are up
+//		    to nxtKillPoll().  Anything the caller was waiting on from the NXT
+//		    should be cancelled first, because the confirmation will toss it.
+//		    Returns false if not connected.
+//
+bool nxtKillStart(BT *bt, nxtKill *kill)
+{
+     nxtReplyCancel(&kill->reply);
+
+     if (!nxtConnected(bt)) {
+	  kill->active = false;
+	  return(false);
+     }
+
+     nxtStopSend(bt);
+
+     kill->active = true;
+     kill->sends = NXT_KILL_SENDS - 1;
+     kill->tries = 1;
+     kill->lastSend = millis();
+
+     return(true);
+}
+
+//
+// nxtKillPoll() - send the next stop command, or the confirmation request, if it is time,
+//		   or pick up the confirmation.  Returns NXT_KILL_PENDING until the kill
+//		   is either DONE or FAILED, after which the kill is no longer active.
+//
+int nxtKillPoll(BT *bt, nxtKill *kill)
+{
+     int	status;
+
+     if (!kill->active) {
+	  return(NXT_KILL_FAILED);
+     }
+
+     if (!nxtConnected(bt)) {
+	  nxtKillCancel(kill);
+	  return(NXT_KILL_FAILED);
+     }
+
+     if (!kill->reply.active) {
+	  if (millis() - kill->lastSend >= NXT_KILL_SPACING) {
+	       if (kill->sends > 0) {
+		    nxtStopSend(bt);
+		    kill->sends--;
+		    kill->lastSend = millis();
+	       } else {
+		    nxtProgramNameRequest(bt,&kill->reply,NXT_KILL_TIMEOUT);
+	       }
+	  }
+	  return(NXT_KILL_PENDING);
+     }
+
+     if ((status = nxtReplyPoll(bt,&kill->reply)) == NXT_REPLY_PENDING) {
+	  return(NXT_KILL_PENDING);
+     }
+
+     // a late reply to something else (like a probe that was cancelled) can come
+     // back instead, so only a "no program" answer to OUR question counts
+
+     if (status == (byte) NXT_ERR_NOACT && kill->reply.data[NXT_RSP] == NXT_DIR_CURRENT) {
+	  kill->active = false;
+	  return(NXT_KILL_DONE);
+     }
+
+     if (kill->tries >= NXT_KILL_TRIES) {
+	  kill->active = false;
+	  return(NXT_KILL_FAILED);
+     }
+
+     nxtStopSend(bt);				// still running (or no answer) - again
+     kill->sends = NXT_KILL_SENDS - 1;
+     kill->tries++;
+     kill->lastSend = millis();
+
+     return(NXT_KILL_PENDING);
+}
+
+//
+// nxtKillCancel() - forget about a kill in progress (when the connection drops).
+//
+void nxtKillCancel(nxtKill *kill)
+{
+     kill->active = false;
+     nxtReplyCancel(&kill->reply);
+}
+
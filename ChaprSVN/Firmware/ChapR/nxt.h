@@ -114,6 +114,11 @@
 #define NXT_PRGM_NAME      3            //bytes 3 through 22 are the name of the program currently running (null-terminated)
 #define NXT_PRGM_NAME_SIZE 20           //the size of the program name, including null termination (and ".rxe")
 
+//Message Read
+#define NXT_MSG_INBOX      3            //the local inbox the message came from
+#define NXT_MSG_SIZE       4            //size of the message (0 when the queue is empty)
+#define NXT_MSG_REPLY_SIZE 64           //the reply is always this big - the message is padded to 59 bytes
+
 //
 // ERROR MESSAGES FOR DIRECT COMMANDS
 //
@@ -164,6 +169,15 @@
 #define NXT_GET_DEV_INFO NXT_SYS_INFO
 #define NXT_REBOOT       NXT_SYS_BOOTH
 
+//
+// FILE READS - files are read in chunks, each handed to a "sink" routine as it arrives
+//   along with the "rock" given to nxtReadFileStream().  A chunk is sized so that the
+//   whole BT reply (2 + 6 + 56 = 64 bytes) fits in the SoftwareSerial receive buffer.
+//
+#define NXT_READ_CHUNK	56
+
+typedef void (*nxtFileSink)(byte *data, int size, void *rock);
+
 extern int nxtMsgCompose(byte *output, 		// the output buffer to scribble things to - min 22 bytes
 			 byte UserMode,		// the usermode value
 			 byte StopPgm,		// the wait-for-start value
@@ -172,11 +186,82 @@ extern int nxtMsgCompose(byte *output, 		// the output buffer to scribble things
 
 extern int  nxtBTMailboxMsgCompose(int,byte *,int);
 
+extern void nxtTetherAttach(VDIP *, int);
+extern void nxtTetherDetach();
+extern bool nxtTethered();
+extern bool nxtConnected(BT *);
+extern void nxtSend(BT *, byte *, int);
+extern int  nxtRecvReply(BT *, byte *, long);
+extern void nxtFlush(BT *);
+
 extern bool nxtQueryDevice(VDIP *, int, char **, char **, long *);
-extern bool  nxtBTKillCommand(BT *);
 extern bool nxtGetProgramName(BT *, char*);
 extern bool nxtGetChosenProgram(BT *, char*);
+extern bool nxtGetChosenProgramCached(BT *, char*);
+extern bool nxtCheckChosenProgram(BT *);
+extern void nxtForgetChosenProgram();
 extern int nxtOpenFileToRead(BT *, char*, long*);
 extern int nxtReadFile(BT *, char *, int, int);
+extern long nxtReadFileStream(BT *, int, long, nxtFileSink, void *);
 extern bool nxtCloseFile(BT *, int);
 extern bool nxtRunProgram(BT *, char *);
+
+//
+// NON-BLOCKING REPLIES - the routines above send a command and then sit in recv() until
+//   the reply comes back.  That's fine when the user is waiting for a program to start,
+//   but not for something that happens during normal operation.  Instead, the request
+//   is sent, and then nxtReplyPoll() is called each time through the loop to pick up
+//   whatever has arrived.  Only the first few bytes of the reply are kept - the rest
+//   (like the 59 bytes of padding on a message read) are thrown away as they arrive.
+//
+//   NOTE - the BT connection is half-duplex as far as SoftwareSerial is concerned, so
+//	nothing should be sent while a reply is pending, or it will get trashed.
+//
+
+#define NXT_REPLY_KEEP		8	// type, cmd, status, plus 5 bytes of data
+#define NXT_REPLY_PENDING	-1	// still waiting for (the rest of) the reply
+#define NXT_REPLY_FAILED	-2	// timed out, or what came back wasn't a reply
+
+typedef struct {
+     bool		active;			// true while waiting on a reply
+     int		size;			// BT size of the reply (from its 2 byte header)
+     int		count;			// reply bytes taken so far (including header)
+     unsigned long	deadline;		// millis() when we give up
+     byte		data[NXT_REPLY_KEEP];	// the beginning of the reply (type is data[0])
+} nxtReply;
+
+extern bool nxtMessageReadRequest(BT *, nxtReply *, int, bool, long);
+extern int  nxtReplyPoll(BT *, nxtReply *);
+extern void nxtReplyCancel(nxtReply *);
+
+//
+// KILL - stopping the program is the one thing that can't wait behind anything else.  So
+//   the stop command goes out right away, WITHOUT asking for a reply, and is sent again
+//   NXT_KILL_SENDS times in all (a few ms apart) in case one of them gets lost.  Only then
+//   is the NXT asked which program is running, using the non-blocking reply above, to
+//   confirm that the stop took.  If something is still running (or there is no answer)
+//   the whole thing is tried again, up to NXT_KILL_TRIES times.  nxtKillPoll() is called
+//   each time through the loop to move things along - nothing else should be sent to the
+//   NXT until it says the kill is done.
+//
+
+#define NXT_KILL_SENDS		3	// stop commands sent each try
+#define NXT_KILL_SPACING	5	// ms between them (and before the confirmation)
+#define NXT_KILL_TRIES		3	// tries before giving up
+#define NXT_KILL_TIMEOUT	100	// ms to wait for the NXT to confirm
+
+#define NXT_KILL_DONE		0	// the NXT says no program is running
+#define NXT_KILL_PENDING	1	// still sending, or waiting for the confirmation
+#define NXT_KILL_FAILED		2	// never confirmed (or the connection dropped)
+
+typedef struct {
+     bool		active;			// true until done or failed
+     byte		sends;			// stop commands left to send on this try
+     byte		tries;			// tries so far
+     unsigned long	lastSend;		// millis() of the last stop command
+     nxtReply		reply;			// the confirmation
+} nxtKill;
+
+extern bool nxtKillStart(BT *, nxtKill *);
+extern int  nxtKillPoll(BT *, nxtKill *);
+extern void nxtKillCancel(nxtKill *);
@@ -17,7 +17,11 @@
 //		but NULL terminated.  The size of the message is returned.
 //
 //		Note that for the "Int" - it actually transfers a float, but
-//		only ints are use for this personality.
+//		only ints are use for this personality.  The float is put
+//		together a bit at a time (sign, exponent, mantissa) rather
+//		than letting the compiler convert it - any int fits in the
+//		mantissa exactly, so it comes out the same, without pulling
+//		in the AVR soft-float code.
 //
 //		For "text", the size given is WITHOUT the NULL terminator,
 //		although the NULL is expected to be there and is copied.
@@ -33,10 +37,33 @@ int nxtGBool(byte *msgbuff, bool value)
 
 int nxtGInt(byte *msgbuff, int value)
 {
-     // the int gets converted to a standard 4-byte float
-     float fvalue = value;
+     // the int gets converted to a standard 4-byte (IEEE-754, LSB first) float
 
-     memcpy(msgbuff,&fvalue,4);
+     byte		sign = 0;
+     byte		exponent = 127 + 15;
+     unsigned int	mantissa;
+
+     if (value == 0) {
+	  memset(msgbuff,0,5);
+	  return(5);
+     }
+
+     if (value < 0) {
+	  sign = 0x80;
+	  mantissa = -(unsigned int) value;
+     } else {
+	  mantissa = value;
+     }
+
+     while (!(mantissa & 0x8000)) {		// the leading 1 is left off
+	  mantissa <<= 1;
+	  exponent--;
+     }
+
+     msgbuff[0] = 0;
+     msgbuff[1] = lowByte(mantissa);
+     msgbuff[2] = ((exponent & 1) << 7) | (highByte(mantissa) & 0x7F);
+     msgbuff[3] = sign | (exponent >> 1);
      msgbuff[4] = 0;
      return(5);
 }
@@ -11,4 +11,9 @@ int nxtGBool(byte *, bool);
 int nxtGInt(byte *, int);
 int nxtGText(byte *, char *, int);
 
+// GPADSCALE() scales a joystick value to -100 to 100 for NXT-G - it is the same as
+// (x+((x<0)?0:1))*100/128, with the divide (which rounds toward zero) done as a shift
+
+#define GPADSCALE(x)	(((x)<0)? -((-(x)*100)>>7) : (((x)+1)*100)>>7)
+
 #endif NXTG_H
@@ -5,10 +5,17 @@
 //
 
 #include <Arduino.h>
+#include "config.h"
 #include "BT.h"
 #include "VDIP.h"
 #include "gamepad.h"
+#include "nxt.h"
+#include "matchmode.h"
 #include "personality.h"
+#include "personality_0.h"		// NXT-RobotC
+#include "personality_1.h"		// NXT-G
+#include "personality_2.h"		// NXT-LabView
+#include "personality_3.h"		// RIO (roboRIO in particular)
 
 Personality::Personality():
   pwrTarget(0), autoTarget(0), teleTarget(0), timePassed(0), 
@@ -16,3 +23,99 @@ Personality::Personality():
   enabled(false)
 {
 }
+
+//
+// The arena is a union of all of the personalities (as raw bytes, so nothing is
+// constructed until personalityActivate() is called).  The "long" keeps it aligned
+// for anything that might care.
+//
+union personalityArena {
+     long	align;
+     char	p0[sizeof(Personality_0)];
+     char	p1[sizeof(Personality_1)];
+     char	p2[sizeof(Personality_2)];
+     char	p3[sizeof(Personality_3)];
+};
+
+static personalityArena	arena;
+static int		active = 0;		// the personality in the arena (0 is none)
+
+//
+// Placement new - the AVR libraries don't have <new>, so this is it.  The tag keeps it
+// from colliding with one that might show up some day.
+//
+enum arenaTag { ARENA };
+
+inline void *operator new(size_t, void *where, arenaTag)
+{
+     return(where);
+}
+
+#define ACTIVE(type)	((type *) &arena)
+
+//
+// personalityActivate() - build the given personality in the arena.  The personalities
+//			   don't have anything to clean up (no destructors) so the new
+//			   one is simply built on top of the old one.
+//
+void personalityActivate(int which)
+{
+     if (which == active) {
+	  return;
+     }
+
+     switch(which) {
+     case PERSON_RBT_C:		new (&arena, ARENA) Personality_0();	break;
+     case PERSON_NXT_G:		new (&arena, ARENA) Personality_1();	break;
+     case PERSON_LABVIEW:	new (&arena, ARENA) Personality_2();	break;
+     case PERSON_RIO:		new (&arena, ARENA) Personality_3();	break;
+     default:			which = 0;				break;
+     }
+
+     active = which;
+}
+
+//
+// The dispatchers - note that the calls are qualified with the class that implements
+// the routine, which makes them direct calls.  (LabView is a RobotC with a twist, so it
+// uses the Personality_0 routines.)
+//
+void personalityLoop(BT *bt, Gamepad *g1, Gamepad *g2)
+{
+     switch(active) {
+     case PERSON_RBT_C:		ACTIVE(Personality_0)->Personality_0::Loop(bt,g1,g2);	break;
+     case PERSON_NXT_G:		ACTIVE(Personality_1)->Personality_1::Loop(bt,g1,g2);	break;
+     case PERSON_LABVIEW:	ACTIVE(Personality_2)->Personality_0::Loop(bt,g1,g2);	break;
+     case PERSON_RIO:		ACTIVE(Personality_3)->Personality_3::Loop(bt,g1,g2);	break;
+     }
+}
+
+void personalityChangeInput(BT *bt, int device, Gamepad *old, Gamepad *gnu)
+{
+     switch(active) {
+     case PERSON_RBT_C:		ACTIVE(Personality_0)->Personality_0::ChangeInput(bt,device,old,gnu);	break;
+     case PERSON_NXT_G:		ACTIVE(Personality_1)->Personality_1::ChangeInput(bt,device,old,gnu);	break;
+     case PERSON_LABVIEW:	ACTIVE(Personality_2)->Personality_0::ChangeInput(bt,device,old,gnu);	break;
+     case PERSON_RIO:		ACTIVE(Personality_3)->Personality_3::ChangeInput(bt,device,old,gnu);	break;
+     }
+}
+
+void personalityChangeButton(BT *bt, bool button)
+{
+     switch(active) {
+     case PERSON_RBT_C:		ACTIVE(Personality_0)->Personality_0::ChangeButton(bt,button);	break;
+     case PERSON_NXT_G:		ACTIVE(Personality_1)->Personality_1::ChangeButton(bt,button);	break;
+     case PERSON_LABVIEW:	ACTIVE(Personality_2)->Personality_0::ChangeButton(bt,button);	break;
+     case PERSON_RIO:		ACTIVE(Personality_3)->Personality_3::ChangeButton(bt,button);	break;
+     }
+}
+
+void personalityKill(BT *bt)
+{
+     switch(active) {
+     case PERSON_RBT_C:		ACTIVE(Personality_0)->Personality_0::Kill(bt);	break;
+     case PERSON_NXT_G:		ACTIVE(Personality_1)->Personality_1::Kill(bt);	break;
+     case PERSON_LABVIEW:	ACTIVE(Personality_2)->Personality_0::Kill(bt);	break;
+     case PERSON_RIO:		ACTIVE(Personality_3)->Personality_3::Kill(bt);	break;
+     }
+}
@@ -90,4 +90,20 @@ class Personality
   bool isInMatchMode();
 };
 
-#endif PERSONALITY_H
+//
+// THE ACTIVE PERSONALITY - only one personality is ever in use, so only that one is
+//   built, in a static "arena" big enough for the biggest of them (see personality.cpp).
+//   personalityActivate() builds the given personality (numbered like the EEPROM setting,
+//   see PERSON_XXX in config.h) if it isn't already the active one, throwing away whatever
+//   state the old one had.  The rest of the routines call into the active personality,
+//   with a switch on its number instead of through the vtable, so the calls in the main
+//   loop are direct.
+//
+
+extern void personalityActivate(int);
+extern void personalityLoop(BT *bt, Gamepad *g1, Gamepad *g2);
+extern void personalityChangeInput(BT *bt, int device, Gamepad *old, Gamepad *gnu);
+extern void personalityChangeButton(BT *bt, bool button);
+extern void personalityKill(BT *bt);
+
+#endif PERSONALITY_H
@@ -85,6 +85,128 @@ bool Personality_0::matchStateProcess(mmState mmState, void *rock)
 Personality_0::Personality_0()
 {
      buttonToggle = false;
+     chosenChecked = false;
+     nxtKillCancel(&kill);
+     myRateReset();
+}
+
+//
+// myChosenPrefetch() - fill the cached chosen program name (see nxt.cpp) once for each
+//			connection.  This blocks for a few round trips to the NXT, so it
+//			is only done while the robot is disabled.  Picking another program
+//			later is caught by myTeleopStart(), which checks the cache first.
+//
+void Personality_0::myChosenPrefetch(BT *bt)
+{
+     if (enabled || chosenChecked) {
+	  return;
+     }
+
+     myProbeFinish(bt);
+     (void)nxtCheckChosenProgram(bt);
+
+     chosenChecked = true;		// even if it failed, myTeleopStart() will try again
+}
+
+//
+// myRateReset() - start rate control over again - a different brick (or program, or
+//		   firmware) may be on the other end next time.
+//
+void Personality_0::myRateReset()
+{
+     rateControl = true;
+     sendInterval = P0_INTERVAL_START;
+     lastSend = 0;
+     lastProbe = 0;
+     probeFailures = 0;
+     nxtReplyCancel(&probe);
+}
+
+//
+// myProbeResult() - adjust the send interval given the status of the last probe.
+//		     The queue being empty means the NXT took the last message within
+//		     one interval, so try a little faster.  If not, back off quickly.
+//
+void Personality_0::myProbeResult(int status)
+{
+     switch(status) {
+     case (byte) NXT_ERR_MBOX:		// queue empty - the program is keeping up
+	  probeFailures = 0;
+	  sendInterval = max(sendInterval - P0_INTERVAL_STEP, 0);
+	  break;
+
+     case NXT_ERR_NONE:			// the last message is still waiting
+	  probeFailures = 0;
+	  sendInterval = min(sendInterval * 2 + P0_INTERVAL_STEP, P0_INTERVAL_MAX);
+	  break;
+
+     case (byte) NXT_ERR_NOACT:		// no program running - nothing to learn
+	  probeFailures = 0;
+	  break;
+
+     default:				// no answer, or the NXT doesn't know MessageRead
+	  if (++probeFailures >= P0_PROBE_FAILURES) {
+	       rateControl = false;
+	       sendInterval = 0;
+	  }
+	  break;
+     }
+}
+
+//
+// myProbeFinish() - wait out a pending probe, and any kill in progress.  This is called
+//		     before any of the blocking NXT commands, which would otherwise get
+//		     the probe reply instead of their own (or have their program stopped
+//		     by a late stop command).
+//
+void Personality_0::myProbeFinish(BT *bt)
+{
+     int	status;
+
+     while (kill.active) {
+	  myKillPoll(bt);
+     }
+
+     while (probe.active) {
+	  if ((status = nxtReplyPoll(bt,&probe)) != NXT_REPLY_PENDING) {
+	       myProbeResult(status);
+	  }
+     }
+}
+
+//
+// myRateControl() - called each loop before sending the mailbox message, this returns
+//		     true if the message should be sent this time.  It also sends
+//		     the probes (in place of a message) and picks up their replies.
+//
+bool Personality_0::myRateControl(BT *bt)
+{
+     unsigned long	now = millis();
+
+     if (!rateControl) {
+	  return(true);				// same as always - send every loop
+     }
+
+     if (probe.active) {
+	  int status = nxtReplyPoll(bt,&probe);
+	  if (status == NXT_REPLY_PENDING) {
+	       return(false);			// don't trample the reply coming in
+	  }
+	  myProbeResult(status);
+     }
+
+     if (now - lastSend < (unsigned long) sendInterval) {
+	  return(false);
+     }
+
+     lastSend = now;
+
+     if (now - lastProbe >= P0_PROBE_EVERY) {
+	  lastProbe = now;
+	  return(!nxtMessageReadRequest(bt,&probe,0,false,P0_PROBE_TIMEOUT));
+     }
+
+     return(true);
 }
 
 //
@@ -99,11 +221,17 @@ void Personality_0::Loop(BT *bt, Gamepad *g1, Gamepad *g2)
      int	size;
 
      // if we're not connected to Bluetooth, then ingore the loop
-     if (!bt->connected()) {
+     if (!nxtConnected(bt)) {		// BT, or the USB tether (see nxt.cpp)
           enabled = false;
 	  if (isMatchActive()){
 	    MatchReset();
 	  }
+	  myRateReset();
+	  nxtKillCancel(&kill);
+	  if (chosenChecked) {
+	       nxtForgetChosenProgram();
+	       chosenChecked = false;
+	  }
 	  return;
      }
        
@@ -115,6 +243,21 @@ void Personality_0::Loop(BT *bt, Gamepad *g1, Gamepad *g2)
 	     mode = myEEPROM.getMode();		// mode is set by the EEPROM setting
      }
 
+     // a kill in progress holds up everything else
+
+     if (kill.active) {
+	  myKillPoll(bt);
+	  return;
+     }
+
+     myChosenPrefetch(bt);
+
+     // see if it is time for a message (or a probe) - see personality_0.h
+
+     if (!myRateControl(bt)) {
+	  return;
+     }
+
      // first convert the gamepad data and button to the robotC structure
      size = robotcTranslate(msgbuff,enabled,g1,g2, mode);
 
@@ -123,8 +266,8 @@ void Personality_0::Loop(BT *bt, Gamepad *g1, Gamepad *g2)
      // mailbox used is #0.
      size = nxtBTMailboxMsgCompose(0,msgbuff,size);
 
-     // then send it over BT, again, operating on the message buffer
-     (void)bt->btWrite(msgbuff,size);
+     // then send it over BT (or USB), again, operating on the message buffer
+     nxtSend(bt,msgbuff,size);
 }
 
 //
@@ -143,18 +286,33 @@ void Personality_0::Kill(BT *bt)
 
 // 
 // myKill() - the low-level routine that is used to kill a program on the NXT
-//		after it is determined that we SHOULD kill the program
+//		after it is determined that we SHOULD kill the program.  The stop
+//		goes out right away - a probe waiting on its reply is just dropped -
+//		and the rest is done by myKillPoll() over the next few loops.
 //
 void Personality_0::myKill(BT *bt)
 {
-	char  buf[NXT_PRGM_NAME_SIZE];
-
-	if(bt->connected()) {
-		if (nxtGetProgramName(bt, buf)){ // kill the program if one is running
-			if (nxtBTKillCommand(bt)){
-				beeper.kill();
-			}
-		}
+	nxtReplyCancel(&probe);
+	(void)nxtKillStart(bt, &kill);
+}
+
+//
+// myKillPoll() - move the kill along, making the kill sound once the NXT says that
+//		  nothing is running.
+//
+void Personality_0::myKillPoll(BT *bt)
+{
+	switch(nxtKillPoll(bt, &kill)) {
+	case NXT_KILL_DONE:
+		beeper.kill();
+		break;
+
+	case NXT_KILL_FAILED:
+		beeper.icky();
+		break;
+
+	default:
+		break;
 	}
 }
 
@@ -165,7 +323,20 @@ void Personality_0::myTeleopStart(BT *bt)
 {
      char  buf[NXT_PRGM_NAME_SIZE];
 
-     if (nxtGetChosenProgram(bt, buf) && nxtRunProgram(bt, buf)){
+     myProbeFinish(bt);
+
+     // normally the name is cached, so this is an open and close of FTCConfig.txt to
+     // see that its size hasn't changed (someone may have used the program chooser
+     // since the prefetch), then the one command to start it.  If the start fails
+     // anyway, get the name fresh and try once more.
+
+     bool started = nxtCheckChosenProgram(bt) && nxtGetChosenProgramCached(bt, buf) && nxtRunProgram(bt, buf);
+
+     if (!started) {
+	  started = nxtGetChosenProgram(bt, buf) && nxtRunProgram(bt, buf);
+     }
+
+     if (started) {
 	  beeper.start();
 	  enabled = false;		// always start off disabled UNTIL the button goes up & down again
      } else {
@@ -196,6 +367,8 @@ void Personality_0::ChangeButton(BT *bt, bool buttonIsDown)
 
 	  if (buttonIsDown) {
 
+	       myProbeFinish(bt);
+
 	       // try to get the name of the program running, if there isn't one it returns false
 
 	       if(nxtGetProgramName(bt, buf)){
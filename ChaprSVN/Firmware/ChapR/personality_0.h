@@ -13,16 +13,59 @@
 //   each message.  (May want to look into only sending upon change, but also with a keep alive
 //   that is sent periodically)
 //
+//   RATE CONTROL - the NXT only queues a few messages per mailbox, and a program that reads
+//   slower than the ChapR sends ends up working on stale input.  So every so often, instead
+//   of the next message, the ChapR asks the NXT (MessageRead, leaving the message in place)
+//   whether the last one is still sitting in the queue.  If it is, the NXT isn't keeping up
+//   and the time between messages is doubled; if the queue is empty, the time is shaved
+//   down a bit.  This settles on about the fastest rate the program on the NXT can take,
+//   without anyone having to tune "lag" by hand.  If the NXT doesn't answer the probes
+//   (some firmware may not) the ChapR goes back to sending every loop.
+//
+//   The name of the program to start for teleop (from FTCConfig.txt) is read once, as soon
+//   as the brick connects, so that starting teleop only costs the one "start program"
+//   command.  It isn't checked again while connected (that would hold up the messages);
+//   if starting the cached name fails, the name is read fresh and the start tried again.
+//
+//   The kill (see nxt.h) sends the stop command right away, ahead of anything else, and
+//   nothing else goes to the NXT until the NXT has confirmed it (or that has failed).
+//
+//   With the USB tether turned on, an NXT plugged into the ChapR's USB port gets all of the
+//   same messages and commands over USB instead of BT (handy for bench testing in the pits).
+//
 
 #ifndef PERSONALITY_0_H
 #define PERSONALITY_0_H
 
+#define P0_INTERVAL_MAX		100	// ms - the slowest the rate control will go
+#define P0_INTERVAL_START	20	// ms - where it starts when a brick connects
+#define P0_INTERVAL_STEP	2	// ms - how much it speeds up with each empty queue
+#define P0_PROBE_EVERY		250	// ms - time between queue probes
+#define P0_PROBE_TIMEOUT	100	// ms - time to wait for the NXT to answer a probe
+#define P0_PROBE_FAILURES	3	// failed probes in a row before giving up on rate control
+
 class Personality_0 : public Personality, public MatchMode
 {
 
 private:
      void myKill(BT *bt);
+     void myKillPoll(BT *bt);
      void myTeleopStart(BT *bt);
+     void myRateReset();
+     bool myRateControl(BT *bt);
+     void myProbeFinish(BT *bt);
+     void myProbeResult(int status);
+     void myChosenPrefetch(BT *bt);
+
+     bool		rateControl;		// false once the NXT doesn't answer probes
+     int		sendInterval;		// ms between mailbox messages
+     unsigned long	lastSend;
+     unsigned long	lastProbe;
+     byte		probeFailures;
+     nxtReply		probe;
+     nxtKill		kill;
+
+     bool		chosenChecked;		// false until the prefetch on a connection
 
 public:
      Personality_0();
@@ -18,6 +18,11 @@
 
 extern sound beeper;
 
+Personality_1::Personality_1() : burstSize(0)
+{
+     nxtKillCancel(&kill);
+}
+
 //
 // ChangeInput() - called when one of the input devices change.  This routine
 //		   gets the whole state of the gamepad, so it needs to figure
@@ -27,6 +32,8 @@ extern sound beeper;
 //		   it relatively easy to figure out.
 //		   (see personality_1.h for a description of the messages)
 //
+//		   The messages are only queued here - Loop() sends them.
+//
 void Personality_1::ChangeInput(BT *bt, int device, Gamepad *old, Gamepad *gnu)
 {
      if (device != 1) {
@@ -38,54 +45,75 @@ void Personality_1::ChangeInput(BT *bt, int device, Gamepad *old, Gamepad *gnu)
      }
 
      if (gnu->x1 != old->x1) {		// if change, scale to 100, send on 1
-	  mySendMessageInt(bt,1,gnu->x1);
+	  myQueueMessageInt(bt,1,gnu->x1);
      }
      if (gnu->y1 != old->y1) {		// if change, scale to 100, send on 2
-	  mySendMessageInt(bt,2,gnu->y1);
+	  myQueueMessageInt(bt,2,gnu->y1);
      }
      if (gnu->x2 != old->x2) {		// if change, scale to 100, send on 3
-	  mySendMessageInt(bt,3,gnu->x2);
+	  myQueueMessageInt(bt,3,gnu->x2);
      }
      if (gnu->y2 != old->y2) {		// if change, scale to 100, send on 4
-	  mySendMessageInt(bt,4,gnu->y2);
+	  myQueueMessageInt(bt,4,gnu->y2);
      }
 
      if (GAMEPAD_B1(gnu) != GAMEPAD_B1(old)) {		// if change, send on 5
-	  mySendMessageBool(bt,5,GAMEPAD_B1(gnu));
+	  myQueueMessageBool(bt,5,GAMEPAD_B1(gnu));
      }
      if (GAMEPAD_B2(gnu) != GAMEPAD_B2(old)) {		// if change, send on 6
-	  mySendMessageBool(bt,6,GAMEPAD_B2(gnu));
+	  myQueueMessageBool(bt,6,GAMEPAD_B2(gnu));
      }
      if (GAMEPAD_B3(gnu) != GAMEPAD_B3(old)) {		// if change, send on 7
-	  mySendMessageBool(bt,7,GAMEPAD_B3(gnu));
+	  myQueueMessageBool(bt,7,GAMEPAD_B3(gnu));
      }
      if (GAMEPAD_B4(gnu) != GAMEPAD_B4(old)) {		// if change, send on 8
-	  mySendMessageBool(bt,8,GAMEPAD_B4(gnu));
+	  myQueueMessageBool(bt,8,GAMEPAD_B4(gnu));
      }
 }
 
-// this little define scales the joystick value from -100 to 100
-
-#define GPADSCALE(x)	(x+((x<0)?0:1))*100/128
-
-void Personality_1::mySendMessageInt(BT *bt,int mbox,int value)
+void Personality_1::myQueueMessageInt(BT *bt,int mbox,int value)
 {
-     byte	msgbuff[64];	// max size of a BT message
+     byte	msgbuff[5];	// NXT-G float plus NULL
      int	size;
 
      size = nxtGInt(msgbuff,GPADSCALE(value));
-     size = nxtBTMailboxMsgCompose(mbox,msgbuff,size);
-     (void)bt->btWrite(msgbuff,size);
+     myQueueMessage(bt,mbox,msgbuff,size);
 }
 
-void Personality_1::mySendMessageBool(BT *bt,int mbox, bool value)
+void Personality_1::myQueueMessageBool(BT *bt,int mbox, bool value)
 {
-     byte	msgbuff[64];	// max size of a BT message
+     byte	msgbuff[2];	// NXT-G logic plus NULL
      int	size;
 
      size = nxtGBool(msgbuff,value);
-     size = nxtBTMailboxMsgCompose(mbox,msgbuff,size);
-     (void)bt->btWrite(msgbuff,size);
+     myQueueMessage(bt,mbox,msgbuff,size);
+}
+
+//
+// myQueueMessage() - add the message to the burst that goes out at the end of
+//		      the loop.  The mailbox message is composed right in the
+//		      burst buffer.  Should the burst ever fill up, it is sent
+//		      early rather than dropping anything.
+//
+void Personality_1::myQueueMessage(BT *bt, int mbox, byte *msg, int size)
+{
+     if (burstSize + size + 6 > NXTG_BURST_SIZE) {
+	  myFlush(bt);
+     }
+
+     memcpy(burst + burstSize, msg, size);
+     burstSize += nxtBTMailboxMsgCompose(mbox,burst + burstSize,size);
+}
+
+//
+// myFlush() - send everything queued up as one burst.
+//
+void Personality_1::myFlush(BT *bt)
+{
+     if (burstSize > 0) {
+	  (void)bt->btWrite(burst,burstSize);
+	  burstSize = 0;
+     }
 }
 
 //
@@ -98,18 +126,43 @@ void Personality_1::ChangeButton(BT *bt, bool button)
      // for for this personality, there is no way to know what program to start
 
      if (bt->connected()) {
-	  mySendMessageBool(bt,0,button);
+	  myQueueMessageBool(bt,0,button);
      }
 }
 
+//
+// Kill() - the stop goes out right away (see nxt.h), and whatever is still queued
+//	    is thrown away - there's no program to get it anymore.
+//
 void Personality_1::Kill(BT *bt)
 {
-     if (nxtBTKillCommand(bt)){
-         beeper.kill();
-     }
+     burstSize = 0;
+     (void)nxtKillStart(bt,&kill);
 }
 
+//
+// Loop() - the changes from this trip through the loop have all been queued by
+//	    now, so send them.
+//
 void Personality_1::Loop(BT *bt, Gamepad *g1, Gamepad *g2)
 {
-     // nothing happens here for this personality
+     if (!bt->connected()) {
+	  burstSize = 0;	// nobody to send them to
+	  nxtKillCancel(&kill);
+	  return;
+     }
+
+     // while a kill is in progress, nothing else goes out (it would trash the
+     // confirmation) and the messages are dropped like in Kill()
+
+     if (kill.active) {
+	  burstSize = 0;
+	  switch(nxtKillPoll(bt,&kill)) {
+	  case NXT_KILL_DONE:	beeper.kill();	break;
+	  case NXT_KILL_FAILED:	beeper.icky();	break;
+	  }
+	  return;
+     }
+
+     myFlush(bt);
 }
@@ -26,16 +26,33 @@
 //				8	Button 4 (logic)
 //				9	Button ???? (need to pick one)
 //
+//   The messages for all of the changes seen during one trip through the loop are
+//   collected up and sent as one back-to-back burst from Loop(), instead of as one
+//   BT write per change.  The RN-42 packs the burst into far fewer BT packets.
+//
 
 #ifndef PERSONALITY_1_H
 #define PERSONALITY_1_H
 
+// enough for all of the messages one loop can generate: four ints (11 bytes each),
+// four buttons plus the WFS button (8 bytes each)
+
+#define NXTG_BURST_SIZE		88
+
+
 class Personality_1 : public Personality
 {
 private:
-     void mySendMessageInt(BT *,int,int);
-     void mySendMessageBool(BT *,int,bool);
+     byte	burst[NXTG_BURST_SIZE];		// messages waiting to go out
+     int	burstSize;
+     nxtKill	kill;				// see nxt.h
+
+     void myQueueMessageInt(BT *,int,int);
+     void myQueueMessageBool(BT *,int,bool);
+     void myQueueMessage(BT *,int,byte *,int);
+     void myFlush(BT *);
 public:
+     Personality_1();
      virtual void ChangeInput(BT *bt, int device, Gamepad *old, Gamepad *);
      virtual void ChangeButton(BT *bt, bool button);
      virtual void Loop(BT *bt, Gamepad *, Gamepad *);
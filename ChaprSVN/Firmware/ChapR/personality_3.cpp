@@ -77,7 +77,8 @@ bool Personality_3::matchStateProcess(mmState mmState, void *rock)
 	  // FALL THROUGH to next case - 'cause we need to kill the program at the end of Teleop
 
      case MM_KILL:		// the match as been killed
-          // nothing to do because the program is always running for FRC bots
+          // the program is always running for FRC bots, so just disable it - NOW
+	  myKill((BT *)rock);
 	  break;
 
      default:
@@ -108,6 +109,7 @@ void Personality_3::Loop(BT *bt, Gamepad *g1, Gamepad *g2)
      // if we're not connected to Bluetooth, then ingore the loop
      if (!bt->connected()) {
        enabled = false;
+       RIO.linkReset();		// the next robot may not know about replies
        if (isMatchActive()){
 	 MatchReset();
        }
@@ -122,6 +124,12 @@ void Personality_3::Loop(BT *bt, Gamepad *g1, Gamepad *g2)
 	     mode = myEEPROM.getMode();		// mode is set by the EEPROM setting
      }
 
+       // pick up anything the robot sent back before composing the next packet
+       RIO.processReplies(bt);
+       if (RIO.killConfirmed()){
+	 beeper.kill();
+       }
+
        // first create a packet using the RIO structure
        size = RIO.createPacket(msgbuff,enabled,g1,g2,mode,isRoboRIO);
        // then send it over BT, again, operating on the message buffer
@@ -134,10 +142,27 @@ void Personality_3::Kill(BT *bt)
   if(isMatchEnabled()) {
     MatchKillProcess((void *)bt);
   } else {
-    enabled = false;
+    myKill(bt);
   }
 }
 
+//
+// myKill() - disable the robot, sending the disabled frames right away instead of
+//	      waiting for the next Loop() (see RIO.h).
+//
+void Personality_3::myKill(BT *bt)
+{
+     byte	msgbuff[64];	// max size of a BT message
+
+     enabled = false;
+
+     if (bt->connected()) {
+	  for (int i = 0; i < RIO_KILL_SENDS; i++) {
+	       (void)bt->btWrite(msgbuff, RIO.createKillPacket(msgbuff, mode, true));
+	  }
+     }
+}
+
 void Personality_3::ChangeInput(BT *bt, int device, Gamepad *old, Gamepad *gnu)
 {
      // nothing happepns here for this personality
@@ -153,4 +178,4 @@ void Personality_3::ChangeButton(BT *bt, bool button)
       (enabled && bt->connected())?beeper.beep():beeper.boop();
     }
   }
-}
+}
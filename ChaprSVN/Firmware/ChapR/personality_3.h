@@ -21,6 +21,7 @@ class Personality_3 : public Personality, public MatchMode
 {
 
 private:
+     void myKill(BT *bt);
 
 public:
      Personality_3();
@@ -1,8 +1,10 @@
 #include <Arduino.h>
+#include <avr/sleep.h>
 #include "config.h"
 #include "power.h"
 #include "blinky.h"
 #include "sound.h"
+#include "button.h"
 
 //
 // lowPowerOperation() - configures the arduino to go into the lowest power mode available
@@ -26,6 +28,27 @@ void lowPowerOperation()
   // at this point, we've left the USART on as well as timer 0 (for delay/millis)
 }
 
+//
+// idleFor() - the wait between frames.  Instead of spinning in delay() the CPU is put into
+//	       IDLE sleep, which stops only the CPU clock - the timers, ADC, USART and the
+//	       pin change interrupts (SoftwareSerial to the BT module) all keep going, and
+//	       any of their interrupts wakes it right back up.  Timer0 overflows every
+//	       1.024ms for millis(), so this never sleeps past the target by more than that.
+//	       A button change ends the wait early, so that it is handled right away.
+//	       How much of the time the CPU is asleep here is reported by "make bench".
+//
+void idleFor(unsigned long ms)
+{
+     unsigned long	start = millis();
+
+     set_sleep_mode(SLEEP_MODE_IDLE);
+     while (millis() - start < ms && !button::eventPending()) {
+	  sleep_enable();
+	  sleep_cpu();
+	  sleep_disable();
+     }
+}
+
 void tonePowerOn()
 {
      power_timer2_enable();
@@ -44,3 +44,4 @@ extern void lowPowerOperation();
 extern void tonePowerOn();
 extern void tonePowerOff();
 extern void powerDown();
+extern void idleFor(unsigned long);
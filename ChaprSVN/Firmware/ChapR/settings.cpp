@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include <EEPROM.h>
+#include <stddef.h>
 #include "settings.h"
 #include "config.h"
 #include "button.h"
@@ -7,6 +8,7 @@
 #include "blinky.h"
 #include "BT.h"
 #include "sound.h"
+#include "crc.h"
 
 extern button theButton;
 
@@ -19,27 +21,39 @@ extern BT bt;
 
 settings::settings()
 {
+     dirty = false;
+     initialized = false;
+     activeSlot = -1;
 }
 
 bool settings::isInitialized()
 {
-  char *currentMagic = getString(EEPROM_MAGIC,EEPROM_MAGICLENGTH);
-  return (strcmp(currentMagic, EEPROM_MAGICSTRING) == 0);
+  return(initialized);
 }
 
-void settings::markInitialized()
-{
-  setString(EEPROM_MAGIC,EEPROM_MAGICLENGTH,EEPROM_MAGICSTRING);
-}
+//
+// The reset status only has to make it across a software reset (a jump to
+// 0, see software_Reset()) so it is kept in RAM that the startup code leaves
+// alone instead of in EEPROM.  After a power-up that RAM is garbage, which
+// is what the magic number is for - without it the status reads as 0.
+//
+#define RSTATUS_MAGIC	0xC4A9
+
+static byte         resetStatus __attribute__ ((section (".noinit")));
+static unsigned int resetMagic  __attribute__ ((section (".noinit")));
 
 void settings::setResetStatus(byte stat)
 {
-  EEPROM.write(EEPROM_RSTATUS, stat);
+  resetStatus = stat;
+  resetMagic = RSTATUS_MAGIC;
 }
 
 byte settings::getResetStatus()
 {
-  return EEPROM.read(EEPROM_RSTATUS);
+  if (resetMagic != RSTATUS_MAGIC){
+    return(0);
+  }
+  return(resetStatus);
 }
 
 void settings::flushSerial()
@@ -98,32 +112,32 @@ void settings::boardBringUp()
   char buf[25];
   extern sound beeper;
   buf[0] = ' ';
-  Serial.print("Test prog v");
+  Serial.print(F("Test prog v"));
   Serial.println(BOARDBRINGUPVERSION);
   indicateLED.off();
 
-  Serial.println("Power LED...");
+  Serial.println(F("Power LED..."));
   powerLED.on();
   hitReturn();
   getStringFromMonitor(buf, 2);
 
-  Serial.println("BT LED...");
+  Serial.println(F("BT LED..."));
   powerLED.off();
   indicateLED.on();
   hitReturn();
   getStringFromMonitor(buf, 2);
 
   indicateLED.off();
-  Serial.println("RET to squeep");
+  Serial.println(F("RET to squeep"));
   getStringFromMonitor(buf, 2);
 
   beeper.squeep();
-  Serial.println("WFS to cont.");
+  Serial.println(F("WFS to cont."));
   while (theButton.check() != true){
   }
 
   while(true) {
-       Serial.println("VDIP ver (3.69)...?");
+       Serial.println(F("VDIP ver (3.69)...?"));
        for (int i = 0; i < sizeof(buf); i++){
 	    buf[i] ='\0';
        }
@@ -138,19 +152,19 @@ void settings::boardBringUp()
 	    break;		// if return or something other than !, go on with life
        }
 
-       Serial.println("Put flash in USB 2; press RET.");
+       Serial.println(F("Put flash in USB 2; press RET."));
        getStringFromMonitor(buf, 25);
 
-       Serial.println("wait 15 sec...");
+       Serial.println(F("wait 15 sec..."));
        vdip.reset();
        delay(5000);
        vdip.flush(10000);
-       Serial.print("Remove flash; ");
+       Serial.print(F("Remove flash; "));
        hitReturn();
        getStringFromMonitor(buf, 25);
   }
 
-  Serial.println("RN-42 ver (want 6.15)...?");
+  Serial.println(F("RN-42 ver (want 6.15)...?"));
   bt.checkVersion();
   Serial.println(F("Done."));
 }
@@ -159,7 +173,7 @@ void settings::boardBringUp()
 // Here is a new way to read settings from the user.  It should save a TON of space.
 // The structure below is an ordered list of settings that are asked of the user.
 // The different types cause different "reading" behavior from the user.  The data
-// is then written straight to EEPROM.
+// goes into the settings record, and is committed to EEPROM when all are done.
 //
 // NOTE - the prompt/help components are meant to be in PROGMEM, specified with F().
 //	  The __FlashStringHelper declaration comes from Print.ccp in the Arduino libraries.
@@ -168,25 +182,26 @@ void settings::boardBringUp()
 #define PROMPT_BYTE	1
 #define PROMPT_BITS	2
 #define PROMPT_SHORT	3
-void settings::printCurrentValue(int eAddress, unsigned int max, uint8_t type)
+void settings::printCurrentValue(int offset, unsigned int max, uint8_t type)
 {
-  short num;
+     byte	*field = ((byte *) &record) + offset;
+
      switch(type) {
 
        case PROMPT_STRING:
-	  Serial.print(getString(eAddress,max));
+	  Serial.print((char *) field);
 	  break;
 
        case PROMPT_BYTE:
-	  Serial.print(EEPROM.read(eAddress));
+	  Serial.print(*field);
 	  break;
 
        case PROMPT_SHORT:
-	  Serial.print(getShort(eAddress));
+	  Serial.print((short) (field[0] | (field[1] << 8)));	// little endian
 	  break;
 
        case PROMPT_BITS:
-	  for (unsigned int i=0, d=EEPROM.read(eAddress); i < max; i++) {
+	  for (unsigned int i=0, d=*field; i < max; i++) {
 	       Serial.print((d&0x01)?"1":"0");
 	       d = d>>1;
 	  }
@@ -205,7 +220,7 @@ void settings::printCurrentValue(int eAddress, unsigned int max, uint8_t type)
 //		understands that they just hit the RETURN for the default.  In other words,
 //		there are no extra words telling them to "hit return for the default".
 //
-void settings::doSetting(int			 eAddress, 	// EEPROM address of this setting
+void settings::doSetting(int			 offset, 	// offset of this setting in the settings record
 			    const __FlashStringHelper *prompt,	// the general name or "prompt" for the given setting
 			    const __FlashStringHelper *help,		// the "help" string - used only during setting, not confirmation
 			    unsigned int   	 min,		// minimum value for error checking
@@ -215,9 +230,9 @@ void settings::doSetting(int			 eAddress, 	// EEPROM address of this setting
 #define MAXLINE		50
      char	lineBuffer[MAXLINE];		// just statically set - will cover all read types
      long	num = 0;
-     double     dnum;
      bool	invalid;
      unsigned int	i;
+     byte	*field = ((byte *) &record) + offset;
 
      while(true) {
 	  Serial.print(F("Enter ChapR "));
@@ -225,8 +240,8 @@ void settings::doSetting(int			 eAddress, 	// EEPROM address of this setting
 	  Serial.print(F(" ("));
 	  Serial.print(help);
 	  Serial.print(F(") ["));
-	  printCurrentValue(eAddress,max,type);
-	  Serial.println("]: ");
+	  printCurrentValue(offset,max,type);
+	  Serial.println(F("]: "));
 
 	  // now read - if RETURN is pressed with something, check and set the value
 	  // appropriately.  If the user just presses RETURN do nothing.
@@ -263,11 +278,14 @@ void settings::doSetting(int			 eAddress, 	// EEPROM address of this setting
 
 	  switch(type) {
 	    case PROMPT_STRING:
-		 setString(eAddress,max,lineBuffer);
+		 if (strcmp((char *) field, lineBuffer) != 0){
+		      strcpy((char *) field, lineBuffer);	// length checked above
+		      dirty = true;
+		 }
 		 break;
 
 	    case PROMPT_BYTE:
-		 EEPROM.write(eAddress,(byte)num);
+		 setByte(field,(byte)num);
 		 break;
 
 	    case PROMPT_BITS:
@@ -279,7 +297,7 @@ void settings::doSetting(int			 eAddress, 	// EEPROM address of this setting
 		      default:	Serial.print(help); continue;
 		      }
 		 }
-		 EEPROM.write(eAddress,(byte)num);
+		 setByte(field,(byte)num);
 		 break;
 	  }
 	  
@@ -287,12 +305,12 @@ void settings::doSetting(int			 eAddress, 	// EEPROM address of this setting
 	  break;
      } 
 
-     // before returning, print out the current value of the given address
+     // before returning, print out the current value of the given setting
 
      Serial.print(F("ChapR "));
      Serial.print(prompt);
      Serial.print(F(" is now \""));
-     printCurrentValue(eAddress,max,type);
+     printCurrentValue(offset,max,type);
      Serial.println(F("\""));
 }
      
@@ -304,18 +322,19 @@ void settings::setFromConsole()
 
      Serial.println(F("--- Enter Settings ---"));
 
-     doSetting(EEPROM_NAME,		F("Name"),           F("max 15 chars"),           1, 15,    PROMPT_STRING);
-     doSetting(EEPROM_TIMEOUT,		F("Timeout"),        F("0 (none) - 120 min"),     0, 120,   PROMPT_BYTE  );
-     doSetting(EEPROM_PERSONALITY,	F("Personality"),    F("1 - 4"),                  1, 4,     PROMPT_BYTE  );
-     doSetting(EEPROM_SPEED,		F("Lag"),            F("0 is none"),              0, 255,   PROMPT_BYTE  );
-     doSetting(EEPROM_MODE,		F("Mode"),           F("0 or 1"),                 0, 1,     PROMPT_BYTE  );
-     doSetting(EEPROM_AUTOLEN,		F("Auto Len"),       from0to255secs,              0, 255,   PROMPT_BYTE  );
-     doSetting(EEPROM_TELELEN,		F("TeleOp Len"),     from0to255secs,              0, 255,   PROMPT_BYTE  );
-     doSetting(EEPROM_ENDLEN,		F("Endgame Len"),    from0to255secs,              0, 255,   PROMPT_BYTE  );
-     doSetting(EEPROM_MATCHMODE,	F("MatchMode Enabled"),  F("0 for false"),            0,   1,   PROMPT_BYTE  );
-
-     markInitialized();
-     loadCache();
+     doSetting(offsetof(settingsRecord,name),	F("Name"),           F("max 15 chars"),           1, 15,    PROMPT_STRING);
+     doSetting(offsetof(settingsRecord,timeout),	F("Timeout"),        F("0 (none) - 120 min"),     0, 120,   PROMPT_BYTE  );
+     doSetting(offsetof(settingsRecord,personality),	F("Personality"),    F("1 - 4"),                  1, 4,     PROMPT_BYTE  );
+     doSetting(offsetof(settingsRecord,speed),	F("Lag"),            F("0 is none"),              0, 255,   PROMPT_BYTE  );
+     doSetting(offsetof(settingsRecord,mode),	F("Mode"),           F("0 or 1"),                 0, 1,     PROMPT_BYTE  );
+     doSetting(offsetof(settingsRecord,autoLen),	F("Auto Len"),       from0to255secs,              0, 255,   PROMPT_BYTE  );
+     doSetting(offsetof(settingsRecord,teleLen),	F("TeleOp Len"),     from0to255secs,              0, 255,   PROMPT_BYTE  );
+     doSetting(offsetof(settingsRecord,endLen),	F("Endgame Len"),    from0to255secs,              0, 255,   PROMPT_BYTE  );
+     doSetting(offsetof(settingsRecord,matchModeEnable),	F("MatchMode Enabled"),  F("0 for false"),            0,   1,   PROMPT_BYTE  );
+     doSetting(offsetof(settingsRecord,tether),	F("USB Tether"),     F("0 for false"),            0, EEPROM_MAXTETHER, PROMPT_BYTE );
+     doSetting(offsetof(settingsRecord,logging),	F("Logging"),        F("0 for false"),            0, EEPROM_MAXLOGGING, PROMPT_BYTE );
+
+     commit();
      setResetStatus(0); //makes sure the ChapR knows it has not been (software) reset
 
      Serial.println(F("--- Done ---"));
@@ -341,162 +360,152 @@ void settings::setDefaults(char *name,
      setTeleLen((byte)teleLen);
      setEndLen((byte)endLen);
      setMatchModeEnable(matchmode);
+     setTether(DEF_TETHER);
+     setLogging(DEF_LOGGING);
+     dirty = true;				// even if it happened to match
 }
 
 //
-// setString() - given a string and a starting position, sets the string in EEPROM, up to
-//               the maxLength, which is the size of the EEPROM area for that string - 1. This
-//               means the maximum string that can be written is maxLength, because
-//               maxLength does not include the null terminator.
-
-void settings::setString(int start, int maxLength, char *thing)
-{
-  int i = 0;
-  while(maxLength--){
-    EEPROM.write(start, thing[i]);
-    start++;
-    if (thing[i] != '\0'){
-      i++;
-    }
-  }
-  EEPROM.write(start, '\0'); //null terminates the string
+// setByte() - change one byte of the record, noting that it needs to be
+//	       committed if (and only if) it really changed.
+//
+void settings::setByte(byte *field, byte value)
+{
+     if (*field != value){
+	  *field = value;
+	  dirty = true;
+     }
 }
 
 //
-// getString() - read in a string from EEPROM into a static  buffer, which needs to be
-//		 copied before this routine is called again.  
-//
-//		 NOTE - this routine always reads ONE EXTRA than what length specified,
-//		 and it is assumed that this one extra is a \0, but just in case it is
-//		 automatically added at the last byte
+// getField()/setField() - raw access to the record by offset, for the host link (see
+//			   hostlink.h).  The header (crc, version, size, seq) can't be set,
+//			   and neither can the null at the end of the name.  checkField()
+//			   holds each value to the range that the console prompts (and
+//			   chapr.cfg) allow, so the host link can't commit anything they
+//			   wouldn't have.
 //
-char* settings::getString(int start, int length)
+byte settings::getField(byte offset)
 {
-  int i;
-  static char buffer[EEPROM_MAXSTRINGLENGTH];
-  
-  for (i = 0; i < length + 1; i++){
-    buffer[i] = EEPROM.read(start);
-    start++;
-  }
-
-  buffer[i-1] = '\0';
-  
-  return (buffer);
+     return((offset < sizeof(record))? ((byte *) &record)[offset] : 0);
 }
 
-//
-// setShort() - writes in little endian, starting from the index given
-//
-void settings::setShort(int start, short value)
+bool settings::checkField(byte offset, byte value)
 {
-  EEPROM.write(start,(byte) (value&0x00FF));
-  EEPROM.write(start + 1, (byte) ((value&0xFF00)>>8));
+     if (offset < offsetof(settingsRecord,name) || offset >= sizeof(record) ||
+	 offset == offsetof(settingsRecord,name) + EEPROM_NAMELENGTH) {
+	  return(false);
+     }
+
+     switch(offset) {
+     case offsetof(settingsRecord,name):		return(value != '\0');	// at least one character
+     case offsetof(settingsRecord,timeout):		return(value <= EEPROM_MAXTIMEOUT);
+     case offsetof(settingsRecord,personality):		return(value > 0 && value <= EEPROM_LASTPERSON);
+     case offsetof(settingsRecord,mode):		return(value <= EEPROM_MAXMODE);
+     case offsetof(settingsRecord,matchModeEnable):	return(value <= 1);
+     case offsetof(settingsRecord,tether):		return(value <= EEPROM_MAXTETHER);
+     case offsetof(settingsRecord,logging):		return(value <= EEPROM_MAXLOGGING);
+     default:						return(true);	// rest of the name, lag, match lengths
+     }
 }
 
-//
-// getShort() - read in little endian, starting from the index given
-//
-short settings::getShort(int start)
+bool settings::setField(byte offset, byte value)
 {
-  short value = 0x00FF&((short) EEPROM.read(start));
-  value |= 0xFF00&(((short) EEPROM.read(start+1))<<8);
-  return value;
+     if (!checkField(offset, value)) {
+	  return(false);
+     }
+
+     setByte(((byte *) &record) + offset, value);
+     return(true);
 }
 
 void settings::setName(char *name)
 {
-  // not cached
-  setString(EEPROM_NAME,EEPROM_NAMELENGTH,name);
+  if (strncmp(record.name, name, EEPROM_NAMELENGTH) != 0){
+    strncpy(record.name, name, EEPROM_NAMELENGTH);
+    record.name[EEPROM_NAMELENGTH] = '\0';
+    dirty = true;
+  }
 }
 
 char* settings::getName()
 {
-  // still not cached
-  return getString(EEPROM_NAME,EEPROM_NAMELENGTH);
+  return (record.name);
 }
 
 void settings::setTimeout(byte time)
 {
-  timeout = time;
-  EEPROM.write(EEPROM_TIMEOUT, time);
+  setByte(&record.timeout, time);
 }
 
 byte settings::getTimeout()
 {
-  return (timeout);
+  return(record.timeout);
 }
 
 void settings::setPersonality(byte p)
 {
-  personality = p;
-  EEPROM.write(EEPROM_PERSONALITY, p);
+  setByte(&record.personality, p);
 }
 
 byte settings::getPersonality()
 {
-  return (personality);
+  return(record.personality);
 }
 
 void settings::setSpeed(byte s)
 {
-  speed = s;
-  EEPROM.write(EEPROM_SPEED, s);
+  setByte(&record.speed, s);
 }
 
 byte settings::getSpeed()
 {
-  return (speed);
+  return(record.speed);
 }
 
 void settings::setMode(byte m)
 {
-  mode = m;
-  EEPROM.write(EEPROM_MODE, m);
+  setByte(&record.mode, m);
 }
 
 byte settings::getMode()
 {
-  return (mode);
+  return(record.mode);
 }
 
 void settings::setAutoLen(byte a)
 {
-  autoLen = a;
-  EEPROM.write(EEPROM_AUTOLEN, a);
+  setByte(&record.autoLen, a);
 }
 
 byte settings::getAutoLen()
 {
-  return(autoLen);
+  return(record.autoLen);
 }
 
 void settings::setTeleLen(byte t)
 {
-  teleLen = t;
-  EEPROM.write(EEPROM_TELELEN, t);
+  setByte(&record.teleLen, t);
 }
 
 byte settings::getTeleLen()
 {
-  return(teleLen);
+  return(record.teleLen);
 }
 
 void settings::setEndLen(byte t)
 {
-  endLen = t;
-  EEPROM.write(EEPROM_ENDLEN, t);
+  setByte(&record.endLen, t);
 }
 
 byte settings::getEndLen()
 {
-  return(endLen);
+  return(record.endLen);
 }
 
 void settings::setMatchModeEnable(int m)
 {
-  matchModeEnable = m;
-  EEPROM.write(EEPROM_MATCHMODE, m);
+  setByte(&record.matchModeEnable, m);
 }
 
 //
@@ -505,22 +514,177 @@ void settings::setMatchModeEnable(int m)
 //                        for more information on matchMode.
 bool settings::matchModeIsEnabled()
 {
-  return(matchModeEnable);
+  return(record.matchModeEnable != 0);
+}
+
+void settings::setTether(byte t)
+{
+  setByte(&record.tether, t);
+}
+
+//
+// tetherIsEnabled() - returns true if an NXT plugged into the ChapR's USB should be
+//                     driven over USB instead of being paired with (see nxt.cpp).
+//                     The byte was unused before, so only exactly 1 turns it on.
+bool settings::tetherIsEnabled()
+{
+  return(record.tether == 1);
+}
+
+void settings::setLogging(byte l)
+{
+  setByte(&record.logging, l);
 }
 
 //
-// loadCache() - reads in all of the settings from EEPROM and stores them
-//               in runtime memory. This way the EEPROM won't be read
-//               repeatedly during the loop (eventuall it would run out).
+// loggingIsEnabled() - returns true if events should be logged to a flash drive
+//                      when there is one (see logger.cpp).
+bool settings::loggingIsEnabled()
+{
+  return(record.logging == 1);
+}
+
+//
+// readSlot() - load the record from the given EEPROM slot if it holds a good one,
+//		returning true if it did.  A record written by older code is
+//		shorter than ours, so the record is set to the defaults first
+//		and the settings it doesn't have keep them.
+//
+bool settings::readSlot(int slot)
+{
+     int	addr = EEPROM_SLOT0 + slot * EEPROM_SLOTSIZE;
+     byte	size = EEPROM.read(addr + offsetof(settingsRecord,size));
+     byte	crc = CRC8_INIT;
+
+     if (size <= offsetof(settingsRecord,seq) || size > EEPROM_SLOTSIZE){
+	  return(false);
+     }
+
+     for (int i = 1; i < size; i++){
+	  byte b = EEPROM.read(addr + i);
+	  crc = crc8(crc, &b, 1);
+     }
+     if (crc != EEPROM.read(addr)){
+	  return(false);
+     }
+
+     setDefaults(DEF_NAME, DEF_TIMEOUT, DEF_PERSON, DEF_LAG, DEF_MODE,
+		 DEF_FRCAUTOLEN, DEF_FRCTELELEN, DEF_FRCENDLEN, DEF_MATCHMODE);
+
+     for (unsigned int i = 0; i < size && i < sizeof(record); i++){
+	  ((byte *) &record)[i] = EEPROM.read(addr + i);
+     }
+     record.name[EEPROM_NAMELENGTH] = '\0';
+
+     // this is where a change in meaning between versions gets fixed up,
+     // then anything that came from a different layout is written back
+
+     dirty = (record.version != SETTINGS_VERSION || record.size != sizeof(record));
+     return(true);
+}
+
+//
+// readLegacy() - if the EEPROM still has the settings as the older code kept
+//		  them (one fixed address each), pull them into the record.
+//
+bool settings::readLegacy()
+{
+     char	magic[EEPROM_MAGICLENGTH+1];
+
+     for (int i = 0; i < EEPROM_MAGICLENGTH+1; i++){
+	  magic[i] = EEPROM.read(EEPROM_MAGIC + i);
+     }
+     if (strncmp(magic, EEPROM_MAGICSTRING, EEPROM_MAGICLENGTH+1) != 0){
+	  return(false);
+     }
+
+     for (int i = 0; i < EEPROM_NAMELENGTH; i++){
+	  record.name[i] = EEPROM.read(EEPROM_NAME + i);
+     }
+     record.name[EEPROM_NAMELENGTH] = '\0';
+     record.timeout = EEPROM.read(EEPROM_TIMEOUT);
+     record.personality = EEPROM.read(EEPROM_PERSONALITY);
+     record.speed = EEPROM.read(EEPROM_SPEED);
+     record.mode = EEPROM.read(EEPROM_MODE);
+     record.autoLen = EEPROM.read(EEPROM_AUTOLEN);
+     record.teleLen = EEPROM.read(EEPROM_TELELEN);
+     record.endLen = EEPROM.read(EEPROM_ENDLEN);
+     record.matchModeEnable = EEPROM.read(EEPROM_MATCHMODE);
+     record.tether = EEPROM.read(EEPROM_TETHER);
+     record.seq = 0;
+
+     dirty = true;
+     return(true);
+}
+
+//
+// loadCache() - reads in the settings record from EEPROM so that the getters
+//               never have to touch the EEPROM.  The newest good slot is
+//               used, and if neither is good the legacy settings are
+//               migrated (and committed right away).  Without any of those,
+//               the ChapR is not initialized.
 //
 void settings::loadCache()
 {
-  timeout =  EEPROM.read(EEPROM_TIMEOUT);
-  personality =  EEPROM.read(EEPROM_PERSONALITY);
-  speed =  EEPROM.read(EEPROM_SPEED);
-  mode = EEPROM.read(EEPROM_MODE);
-  autoLen =  EEPROM.read(EEPROM_AUTOLEN);
-  teleLen =  EEPROM.read(EEPROM_TELELEN);
-  endLen =  EEPROM.read(EEPROM_ENDLEN);
-  matchModeEnable = EEPROM.read(EEPROM_MATCHMODE);
+     byte	seq[EEPROM_SLOTS];
+     bool	good[EEPROM_SLOTS];
+     int	slot = -1;
+
+     for (int i = 0; i < EEPROM_SLOTS; i++){
+	  good[i] = readSlot(i);
+	  seq[i] = record.seq;
+     }
+
+     // sequence numbers wrap, so "newer" is a small positive difference
+
+     if (good[0] && good[1]){
+	  slot = ((signed char)(seq[1] - seq[0]) > 0)? 1 : 0;
+     } else if (good[0]){
+	  slot = 0;
+     } else if (good[1]){
+	  slot = 1;
+     }
+
+     if (slot >= 0){
+	  readSlot(slot);
+	  activeSlot = slot;
+	  initialized = true;
+     } else {
+	  activeSlot = -1;
+	  initialized = readLegacy();
+     }
+
+     commit();
+}
+
+//
+// commit() - write the record to EEPROM if anything has changed.  It always
+//	      goes to the slot that is NOT in use, so the old settings are
+//	      still there if this write doesn't finish, and it only writes
+//	      the bytes that differ (at 3.3ms each).
+//
+void settings::commit()
+{
+     if (!dirty){
+	  return;
+     }
+
+     int slot = (activeSlot == 0)? 1 : 0;
+     int addr = EEPROM_SLOT0 + slot * EEPROM_SLOTSIZE;
+
+     record.version = SETTINGS_VERSION;
+     record.size = sizeof(record);
+     record.seq++;
+     record.crc = crc8(CRC8_INIT, ((byte *) &record) + 1, sizeof(record) - 1);
+
+     for (unsigned int i = 0; i < sizeof(record); i++){
+	  byte b = ((byte *) &record)[i];
+	  if (EEPROM.read(addr + i) != b){
+	       EEPROM.write(addr + i, b);
+	  }
+     }
+
+     activeSlot = slot;
+     initialized = true;
+     dirty = false;
 }
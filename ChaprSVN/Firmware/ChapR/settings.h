@@ -7,33 +7,74 @@
 //
 // bytes(inclusive)   description
 // ------------------------------
-// 0 - 15              null-terminated ChapR name
-// 16                  minutes before timeout (0 means it never times out and the maximum is 255)
-// 17                  personality (numbered based on information from the website)
-// 18 - 23             null-terminated "ChapR" to verify EEPROM has been written
+// 0 - 63              legacy (pre-record) settings - only read to migrate them
+// 64 - 111            settings record, slot A
+// 112 - 159           settings record, slot B
+// 160 - 196           watchdog crash records (see watchdog.h)
+//
+// The settings live in RAM (see settingsRecord below) and the setters only
+// change that copy.  commit() writes the whole record, with a CRC and a
+// sequence number, to whichever slot ISN'T the current one, and only the
+// bytes that actually changed get written.  At boot the valid slot with the
+// newest sequence number wins, so a write torn by a brownout just leaves the
+// previous settings in place.
+
+#define EEPROM_SLOT0           64	// first settings record slot
+#define EEPROM_SLOTSIZE        48	// bytes per slot (room for the record to grow)
+#define EEPROM_SLOTS            2
+#define EEPROM_CRASH          160	// crash record count, then the records
+
+#define SETTINGS_VERSION        1	// bump when a field changes meaning (not when one is added)
+
+// legacy layout (for migration only)
 
 #define EEPROM_NAME             0	// 15 characters + null termination
 #define EEPROM_TIMEOUT         16	// byte
 #define EEPROM_PERSONALITY     17	// byte
 #define EEPROM_MAGIC           18	// magic string to identify version
-#define EEPROM_RSTATUS         24	// reset status used for self-rebooting
 #define EEPROM_SPEED           25	// byte (lag)
 #define EEPROM_MODE            26	// byte (bool) - (NXT definition) true(1) is teleop, false(0) is auto
-// there is a long story as to why there are 10 bytes of space here...
+#define EEPROM_TETHER          27	// byte (bool) - true(1) means a USB connected NXT is driven over USB
 #define EEPROM_AUTOLEN         36	// byte
 #define EEPROM_TELELEN         37	// byte
 #define EEPROM_ENDLEN          38       // byte
 #define EEPROM_MATCHMODE       39       // byte (determines whether matchMode is enabled)
+#define EEPROM_MAGICSTRING   "Chap3"	// the last legacy layout
 
 //constants
-#define EEPROM_NAMELENGTH      15 //without null terminator (15 - 0)
-#define EEPROM_MAGICLENGTH      5 //without null terminator (23 - 18)
-#define EEPROM_MAXSTRINGLENGTH (max(EEPROM_NAMELENGTH, EEPROM_MAGICLENGTH) + 1)
+#define EEPROM_NAMELENGTH      15 //without null terminator
+#define EEPROM_MAGICLENGTH      5 //without null terminator
 #define EEPROM_MAXTIMEOUT      120 //says timeout cannot be longer than two hours
 #define EEPROM_LASTPERSON      PERSONALITYCOUNT //last personality that has been coded
 #define EEPROM_MAXLAG          255
 #define EEPROM_MAXMODE         1
-#define EEPROM_MAGICSTRING   "Chap3" //number shows a new set of EEPROM settings
+#define EEPROM_MAXTETHER       1
+#define EEPROM_MAXLOGGING      1
+
+//
+// settingsRecord - the settings as they are kept in RAM and in each EEPROM slot.
+//		    The crc covers everything after it, up to "size".  New
+//		    settings are ALWAYS added at the end - a record written by
+//		    older code is then just shorter, and the missing settings
+//		    get their defaults when it is loaded.
+//
+typedef struct {
+     byte crc;
+     byte version;		// SETTINGS_VERSION that wrote it
+     byte size;			// sizeof(settingsRecord) that wrote it
+     byte seq;			// bumped on each commit, the newest slot wins
+     char name[EEPROM_NAMELENGTH+1];
+     byte timeout;
+     byte personality;
+     byte speed;
+     byte mode;
+     byte autoLen;
+     byte teleLen;
+     byte endLen;
+     byte matchModeEnable;	// 0 is false, 1 is true
+     byte tether;		// 1 is true, anything else is false
+     byte logging;		// 1 logs to a flash drive (see logger.h)
+} settingsRecord;
 
 class settings
 {
@@ -63,29 +104,31 @@ public:
      byte getAutoLen();
      void setMatchModeEnable(int);
      bool matchModeIsEnabled();
+     void setTether(byte);
+     bool tetherIsEnabled();
+     void setLogging(byte);
+     bool loggingIsEnabled();
      void setDefaults(char *,unsigned int,unsigned int,unsigned int,unsigned int,unsigned int,unsigned int,unsigned int,unsigned int);
      void loadCache();
+     void commit();
+     byte getField(byte);
+     bool checkField(byte, byte);
+     bool setField(byte, byte);
      
  private:
-     byte mode;              // copies of EEPROM settings (initialized during setup, then
-     byte speed;             // updated every time EEPROM changes)
-     byte personality;
-     byte timeout;
-     long autoLen;             
-     long teleLen; 
-     long endLen;
-     int matchModeEnable; // 0 is false, 1 is true
+     settingsRecord record;	// the settings, changes go to EEPROM on commit()
+     bool dirty;		// record has changed since the last commit()
+     bool initialized;		// a good record (or legacy settings) was found
+     int  activeSlot;		// slot the record came from, -1 if none
 
      void hitReturn();
      void doSetting(int,const __FlashStringHelper *, const __FlashStringHelper *,unsigned int,unsigned int,uint8_t);
      void printCurrentValue(int,unsigned int, uint8_t);
      int  getStringFromMonitor(char*, int);
-     void setString(int, int, char*);
-     char *getString(int, int);
-     void markInitialized();
+     void setByte(byte *, byte);
+     bool readSlot(int);
+     bool readLegacy();
      void flushSerial();
-     void setShort(int, short);
-     short getShort(int);
      void hitReturnForDefault();
 };
 
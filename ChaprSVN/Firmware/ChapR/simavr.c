@@ -0,0 +1,35 @@
+//
+// simavr.c
+//
+//   Only compiled into the image with -DSIMAVR (see the Makefile).  This
+//   fills the ".mmcu" section of the ELF, which simavr reads to know the
+//   part, the clock and what to trace - none of it is loaded into the
+//   flash.  Pins are named per config.h (V02 board), and PHASE is the
+//   GPIOR0 marker written by PHASE() (see debug.h).
+//
+//   This is C rather than C++ because the simavr macros use designated
+//   initializers.
+//
+
+#ifdef SIMAVR
+
+#include <avr/io.h>
+#include <simavr/avr/avr_mcu_section.h>
+
+AVR_MCU(F_CPU, "atmega328p");
+AVR_MCU_VCD_FILE("chapr.vcd", 1000);
+
+AVR_MCU_VCD_PORT_PIN('B', 5, "BT_TX");		// pin 13
+AVR_MCU_VCD_PORT_PIN('B', 4, "BT_RX");		// pin 12
+AVR_MCU_VCD_PORT_PIN('D', 3, "BT_CONNECTED");	// pin 3
+AVR_MCU_VCD_PORT_PIN('D', 6, "VDIP_CLOCK");	// pin 6
+AVR_MCU_VCD_PORT_PIN('B', 1, "VDIP_CS");	// pin 9
+
+AVR_MCU_VCD_ALL_IRQ();				// running vectors
+AVR_MCU_VCD_ALL_IRQ_PENDING();			// raised, but not yet running
+
+const struct avr_mmcu_vcd_trace_t _chaprTrace[] _MMCU_ = {
+     { AVR_MCU_VCD_SYMBOL("PHASE"), .what = (void *) &GPIOR0, },
+};
+
+#endif /* SIMAVR */
@@ -0,0 +1,57 @@
+//
+// stack.cpp
+//
+//   Before anything else runs, the RAM between the end of the variables and
+//   the top of the stack is painted with STACK_PAINT.  Whatever the stack
+//   has used since has been written over, so counting the paint that is
+//   still there (from the bottom) gives the least free stack there has ever
+//   been - the high-water mark, without checking anything as it runs.
+//
+//   The painting is done in .init3, after the stack pointer is set up and
+//   before the variables are filled in and the constructors are run.
+//
+
+#include <Arduino.h>
+#include "stack.h"
+
+#define STACK_PAINT	0xC5
+
+extern uint8_t	_end;			// the end of the variables (from the linker)
+extern uint8_t	__stack;		// the top of RAM, where the stack starts
+
+void stackPaint() __attribute__ ((naked, used, section(".init3")));
+
+//
+// stackPaint() - never called, the startup code runs into it.  It is naked (no
+//		  return), and can't call anything.
+//
+void stackPaint()
+{
+     uint8_t	*p = &_end;
+
+     while (p <= &__stack) {
+	  *p++ = STACK_PAINT;
+     }
+}
+
+//
+// stackFree() - the least free stack there has been since power on (bytes).
+//
+unsigned int stackFree()
+{
+     uint8_t	*p = &_end;
+
+     while (p <= &__stack && *p == STACK_PAINT) {
+	  p++;
+     }
+     return(p - &_end);
+}
+
+void stackPrint()
+{
+     Serial.print(F("stack: "));
+     Serial.print(stackFree());
+     Serial.print(F(" of "));
+     Serial.print(&__stack - &_end + 1);
+     Serial.println(F(" bytes never used"));
+}
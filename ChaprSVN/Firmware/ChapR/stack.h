@@ -0,0 +1,16 @@
+//
+// stack.h
+//
+//   How close the stack has come to running into the variables (see
+//   stack.cpp).  There is no heap on the ChapR (the personalities are
+//   built in a static arena) so everything between the end of the
+//   variables and the stack is the stack's to grow into.
+//
+
+#ifndef STACK_H
+#define STACK_H
+
+extern unsigned int stackFree();
+extern void stackPrint();
+
+#endif STACK_H
@@ -0,0 +1,72 @@
+//
+// Arduino.h
+//
+//   Just enough of the Arduino core for the encoder tests to compile the
+//   firmware files on the host (see test_encoders.cpp).  PROGMEM is plain
+//   memory here and all printing goes nowhere.
+//
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define PGM_P			const char *
+#define PSTR(s)			(s)
+#define pgm_read_byte(p)	(*(const uint8_t *)(p))
+
+// an int is 16 bits on the AVR - the table may be of wider ones here, but
+// the host is little-endian too, so the first two bytes are the same word
+
+static inline uint16_t pgm_read_word(const void *p)
+{
+     uint16_t	w;
+
+     memcpy(&w,p,sizeof(w));
+     return(w);
+}
+
+#define DEC	10
+#define HEX	16
+
+#define min(a,b)	((a)<(b)?(a):(b))
+#define max(a,b)	((a)>(b)?(a):(b))
+#define lowByte(w)	((uint8_t) ((w) & 0xff))
+#define highByte(w)	((uint8_t) ((w) >> 8))
+
+class __FlashStringHelper;
+#define F(s)	(reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+unsigned long millis();
+
+class Print
+{
+ public:
+     template <class T> size_t print(T, int = DEC) { return(0); }
+     template <class T> size_t println(T, int = DEC) { return(0); }
+     size_t println() { return(0); }
+     size_t write(uint8_t) { return(0); }
+};
+
+class Stream : public Print
+{
+ public:
+     int available() { return(0); }
+     int read() { return(-1); }
+};
+
+class HardwareSerial : public Stream
+{
+ public:
+     void begin(unsigned long) {}
+};
+
+extern HardwareSerial Serial;
+
+#endif ARDUINO_H
@@ -0,0 +1,20 @@
+//
+// SoftwareSerial.h
+//
+//   The host stand-in for the Arduino library, for the encoder tests.  Nothing
+//   in them talks to the BT module, so it only has to declare the class.
+//
+
+#ifndef SOFTWARESERIAL_H
+#define SOFTWARESERIAL_H
+
+#include <Arduino.h>
+
+class SoftwareSerial : public Stream
+{
+ public:
+     SoftwareSerial(uint8_t, uint8_t) {}
+     void begin(long) {}
+};
+
+#endif SOFTWARESERIAL_H
@@ -0,0 +1,149 @@
+//
+// test_encoders.cpp
+//
+//   Host tests for the integer-only encoders in the firmware ("make test" in
+//   the directory above).  Each one is checked over its whole input range
+//   against the expression it replaced:
+//
+//	nxtGInt()	- every 16-bit int must come out byte for byte the same
+//			  as the (float) conversion the AVR used to do
+//	GPADSCALE()	- every joystick value (-128 to 127) must scale the same
+//			  as (x+((x<0)?0:1))*100/128
+//	tophat		- the degrees RIO::createPacket() puts in a frame must
+//			  be 0xFFFF for not pressed, then (th-1)*45 for 1 to 8,
+//			  and anything past 8 must read as not pressed
+//
+//   nxtg.cpp, RIO.cpp and crc.cpp are compiled as they are, with the
+//   Arduino.h and SoftwareSerial.h in this directory standing in for the
+//   real ones.  Exits non-zero if anything fails.
+//
+
+#include <stdio.h>
+#include <Arduino.h>
+#include "nxtg.h"
+#include "VDIP.h"
+#include "gamepad.h"
+#include "RIO.h"
+
+static int failures = 0;
+
+// what RIO.cpp needs from the rest of the firmware - none of it matters here
+
+HardwareSerial Serial;
+
+unsigned long millis()
+{
+     return(0);
+}
+
+Gamepad::Gamepad(int _id) : translator(NULL), init(NULL), id(_id), initialized(false)
+{
+     clear();
+     type = 0;
+}
+
+void Gamepad::clear()
+{
+     x1 = y1 = x2 = y2 = x3 = y3 = 0;
+     buttons = 0;
+     tophat = 0;
+}
+
+//
+// testNxtGInt() - the NXT-G float for every int16 against the compiler's.
+//
+static void testNxtGInt()
+{
+     int	bad = 0;
+
+     for (long v = -32768; v <= 32767; v++) {
+	  byte	msgbuff[5];
+	  byte	expect[5];
+	  float	f = (float) v;
+
+	  memcpy(expect,&f,4);		// the host is little-endian, like the AVR
+	  expect[4] = 0;
+
+	  memset(msgbuff,0xAA,sizeof(msgbuff));
+	  int size = nxtGInt(msgbuff,(int) v);
+
+	  if (size != 5 || memcmp(msgbuff,expect,5) != 0) {
+	       if (bad++ < 5) {
+		    printf("nxtGInt(%ld): size %d, %02x %02x %02x %02x %02x, expected %02x %02x %02x %02x %02x\n",
+			   v, size, msgbuff[0], msgbuff[1], msgbuff[2], msgbuff[3], msgbuff[4],
+			   expect[0], expect[1], expect[2], expect[3], expect[4]);
+	       }
+	  }
+     }
+
+     printf("nxtGInt: %s (%d bad)\n", bad? "FAILED" : "passed", bad);
+     failures += bad;
+}
+
+//
+// testGpadScale() - GPADSCALE() for every int8 against the divide.
+//
+static void testGpadScale()
+{
+     int	bad = 0;
+
+     for (int x = -128; x <= 127; x++) {
+	  int	got = GPADSCALE(x);
+	  int	expect = (x+((x<0)?0:1))*100/128;
+
+	  if (got != expect) {
+	       if (bad++ < 5) {
+		    printf("GPADSCALE(%d): %d, expected %d\n", x, got, expect);
+	       }
+	  }
+     }
+
+     printf("GPADSCALE: %s (%d bad)\n", bad? "FAILED" : "passed", bad);
+     failures += bad;
+}
+
+//
+// testTophat() - the degrees in a legacy frame for every tophat value.  Both
+//		  gamepads are checked, they go through different bytes.
+//
+static void testTophat()
+{
+     int	bad = 0;
+
+     for (unsigned int th = 0; th <= 0xFF; th++) {
+	  RIO		rio;
+	  Gamepad	g1(1), g2(2);
+	  byte		msgbuff[64];	// max size of a BT message
+	  unsigned int	expect = (th == 0 || th > 8)? 0xFFFF : (th-1)*45;
+
+	  g1.tophat = th;
+	  g2.tophat = th;
+	  rio.createPacket(msgbuff,true,&g1,&g2,true,true);
+
+	  unsigned int got1 = (msgbuff[4] << 8) | msgbuff[5];
+	  unsigned int got2 = (msgbuff[16] << 8) | msgbuff[17];
+
+	  if (got1 != expect || got2 != expect) {
+	       if (bad++ < 5) {
+		    printf("tophat %u: %04x / %04x, expected %04x\n", th, got1, got2, expect);
+	       }
+	  }
+     }
+
+     printf("tophat: %s (%d bad)\n", bad? "FAILED" : "passed", bad);
+     failures += bad;
+}
+
+int main()
+{
+     testNxtGInt();
+     testGpadScale();
+     testTophat();
+
+     if (failures) {
+	  printf("%d FAILED\n", failures);
+	  return(EXIT_FAILURE);
+     }
+     printf("all passed\n");
+     return(EXIT_SUCCESS);
+}
@@ -9,15 +9,116 @@
 //	plugging/unplugging joysticks.  If a joystick is "whacked" it
 //	will often lock-up the ChapR because the VDIP stops responding.
 //
+//	Before it does, it leaves a crash record in the EEPROM (see
+//	watchdog.h) so that there is something to go on afterwards.
+//
 //	NOTE - these are coded as simple C functions, so the include
 //	file doesn't instantiate a class.
 //
 
 #include <Arduino.h>
+#include <EEPROM.h>
 #include <avr/wdt.h>
 #include "watchdog.h"
 #include "power.h"
 #include "sound.h"
+#include "settings.h"
+#include "BT.h"
+
+volatile watchdogCrumbs	crumbs;
+
+//
+// Each crash record is:  phase, vdip, bt, loops (LSB first), millis() (LSB first).  The
+// byte at EEPROM_CRASH counts the records, which go round-robin after it.
+//
+#define WD_RECORD_SIZE	9
+
+static int watchdogRecord(byte n)
+{
+     return(EEPROM_CRASH + 1 + (n % WATCHDOG_RECORDS) * WD_RECORD_SIZE);
+}
+
+static byte watchdogCount()
+{
+     byte	count = EEPROM.read(EEPROM_CRASH);
+
+     return((count == 0xff)? 0 : count);		// 0xff is erased EEPROM
+}
+
+//
+// watchdogSave() - write the crumbs to the next crash record.  This is about 40ms of
+//		    EEPROM writes, which is fine since the ChapR is going down anyway.
+//
+static void watchdogSave()
+{
+     extern BT		bt;
+     byte		count = watchdogCount();
+     int		addr = watchdogRecord(count);
+     unsigned long	now = millis();
+
+     EEPROM.write(addr++, GPIOR0);			// the PHASE() (see debug.h)
+     EEPROM.write(addr++, crumbs.vdip);
+     EEPROM.write(addr++, crumbs.bt | (bt.connected()? WD_BT_CONNECTED : 0));
+     EEPROM.write(addr++, (byte) crumbs.loops);
+     EEPROM.write(addr++, (byte) (crumbs.loops >> 8));
+     for (byte i = 0; i < 4; i++, now >>= 8) {
+	  EEPROM.write(addr++, (byte) now);
+     }
+
+     // the count only needs to say where the next record goes, and whether the
+     // ring is full, so it goes around again before it gets to 0xff
+
+     if (++count >= 0xff - WATCHDOG_RECORDS) {
+	  count = WATCHDOG_RECORDS + count % WATCHDOG_RECORDS;
+     }
+     EEPROM.write(EEPROM_CRASH, count);
+}
+
+//
+// watchdogPrint() - dump the crash records, newest first, to the serial console.
+//
+void watchdogPrint()
+{
+     byte	count = watchdogCount();
+
+     Serial.print(F("watchdog: "));
+     if (count == 0) {
+	  Serial.println(F("no crashes"));
+	  return;
+     }
+     Serial.println(F("crashes (newest first)"));
+
+     for (byte i = 1; i <= min(count, WATCHDOG_RECORDS); i++) {
+	  int		addr = watchdogRecord(count - i);
+	  byte		phase = EEPROM.read(addr++);
+	  byte		vdip = EEPROM.read(addr++);
+	  byte		bt = EEPROM.read(addr++);
+	  unsigned int	loops = EEPROM.read(addr++);
+	  unsigned long	when = 0;
+
+	  loops |= EEPROM.read(addr++) << 8;
+	  for (byte j = 0; j < 4; j++) {
+	       when |= (unsigned long) EEPROM.read(addr++) << (8 * j);
+	  }
+
+	  Serial.print(F("  phase "));
+	  Serial.print(phase);
+	  Serial.print(F(", VDIP cmd "));
+	  Serial.print(vdip & ~WD_VDIP_BUSY);
+	  if (vdip & WD_VDIP_BUSY) {
+	       Serial.print(F(" (stuck in it)"));
+	  }
+	  Serial.print((bt & WD_BT_CONNECTED)? F(", BT connected") : F(", BT not connected"));
+	  if (bt & WD_BT_WRITING) {
+	       Serial.print(F(" (writing)"));
+	  }
+	  Serial.print(F(", loop "));
+	  Serial.print(loops);
+	  Serial.print(F(", at "));
+	  Serial.print(when);
+	  Serial.println(F("ms"));
+     }
+}
 
 //
 // watchdogFeed() - "feed" the watchdog.  If the watchdog isn't fed enough
@@ -90,17 +191,19 @@ void watchdogOn()
 
 //
 // Watch Dog Bite! - So the watchdog bite is worse than its bark!  This is the interrupt
-//		    routine that is called when the watchdog goes off.  It simply issues
-//		    the icky sound and shuts down the ChapR.  Note that this routine is
-//		    running as a interrupt - so interrupts are normally off during processing.
-//		    So we have to turn them back on so our sounds will work.
+//		    routine that is called when the watchdog goes off.  It saves the
+//		    crash record, issues the icky sound and shuts down the ChapR.  Note
+//		    that this routine is running as a interrupt - so interrupts are normally
+//		    off during processing.  So we have to turn them back on so our sounds
+//		    will work (the EEPROM writes don't need them).
 //
 //		    The declaration is a bit weird - this instructs the compiler to put
 //		    a pointer to this routine in the interrupt vector table - specifically
 //		    the entry for the watchdog timer.
 //
 ISR(WDT_vect) {
-  Serial.println("bite");
+     watchdogSave();
+  Serial.println(F("bite"));
      extern sound beeper;
 
      // OK - this is weird - but we need to turn on interrupts, even though we are in an interrupt
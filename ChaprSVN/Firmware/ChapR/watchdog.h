@@ -7,9 +7,33 @@
 #ifndef WATCHDOG_H
 #define WATCHDOG_H
 
+//
+// CRASH RECORDS - a few "breadcrumbs" are kept up to date in RAM as the ChapR runs:
+//   the last VDIP command (and whether it is still waiting on it), what the BT is
+//   doing, and a count of the trips through loop().  When the watchdog bites, these,
+//   the PHASE() of loop() (see debug.h) and millis() are written to the EEPROM
+//   (EEPROM_CRASH, see settings.h) before powering down, so that the next time
+//   around watchdogPrint() can tell where things were stuck.  The last
+//   WATCHDOG_RECORDS crashes are kept.
+//
+#define WATCHDOG_RECORDS	4
+
+#define WD_VDIP_BUSY		0x80	// or'd into the VDIP command while waiting on the VDIP
+#define WD_BT_CONNECTED		0x01	// filled in when the record is written
+#define WD_BT_WRITING		0x02	// in the middle of a btWrite()
+
+typedef struct {
+     byte		vdip;		// last VDIP command (VDIP_XXX, see VDIP.h)
+     byte		bt;		// WD_BT_XXX
+     unsigned int	loops;		// trips through loop()
+} watchdogCrumbs;
+
+extern volatile watchdogCrumbs	crumbs;
+
 void watchdogFeed();
 void watchdogOn();
 void watchdogOff();
 void watchdogBite();
+void watchdogPrint();
 
 #endif
@@ -0,0 +1,479 @@
+/*
+ * chaprlink.c
+ *
+ *   Talks to a ChapR over its serial port (the FTDI header, or anything
+ *   that looks like a tty) using the host link protocol described in
+ *   Firmware/ChapR/hostlink.h.
+ *
+ *	usage: chaprlink [-d device] command [args]
+ *
+ *	  ping			protocol version and settings record size
+ *	  get [key]		settings, as chapr.cfg lines
+ *	  set key value		change a setting (used right away, and saved)
+ *	  dump addr count	hex dump of the raw EEPROM
+ *	  stream [period]	state frames as CSV until interrupted, which
+ *				turns the stream off (period in ms, default 50)
+ *	  rescan		have the ChapR look at its USB ports again
+ *
+ *   The device defaults to /dev/ttyUSB0.
+ *
+ *   Opening the port raises DTR, which resets the ChapR if DTR was down -
+ *   and that drops BT, so the robot link goes too.  This leaves HUPCL off
+ *   so DTR stays up when it exits: only the first run after the FTDI cable
+ *   is plugged in (or after something else closed the port with HUPCL on)
+ *   resets the ChapR.  Do that one before the robot is connected - after
+ *   it, settings can be changed and the gamepads watched with the robot
+ *   running.  When the ChapR did reset, this waits for setup() to finish
+ *   (see SETUP_WAIT) before the command goes out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/select.h>
+
+/* these must match Firmware/ChapR/hostlink.h */
+
+#define HL_SYNC		0xA5
+#define HL_VERSION	1
+#define HL_MAX_PAYLOAD	32
+
+#define HL_PING		0x01
+#define HL_READ		0x02
+#define HL_GET		0x03
+#define HL_SET		0x04
+#define HL_STREAM	0x05
+#define HL_RESCAN	0x06
+#define HL_STATE	0x10
+#define HL_NAK		0x7F
+#define HL_REPLY	0x80
+
+#define HL_NAK_RANGE	3
+
+#define HL_STATE_CONNECTED	0x01
+#define HL_STATE_LOW		0x02
+#define HL_STATE_SIZE		32
+
+/*
+ * After a reset the ChapR only answers once setup() is done: the bootloader
+ * (about 1s), then the VDIP's 2s reset delay (RESET_DELAY_SECS, counted from
+ * power on), then about 1s to reset the RN-42 and put it in its mode - and
+ * longer if the VDIP is slow to sync.  So it is pinged until it answers, for
+ * up to SETUP_WAIT.  If it didn't reset, the first ping answers right away.
+ */
+#define SETUP_WAIT	8000	/* ms for setup() after a reset */
+#define REPLY_WAIT	500	/* ms to wait for a reply */
+#define TRIES		3
+
+/*
+ * The settings, by their offset in the settings record (settingsRecord in
+ * Firmware/ChapR/settings.h) and with the chapr.cfg key for each.
+ */
+#define NAME_LENGTH	16	/* with the null */
+
+static const struct {
+  const char *key;
+  int offset;
+} settings[] = {
+  { "name",	4 },
+  { "person",	21 },
+  { "timeout",	20 },
+  { "lag",	22 },
+  { "mode",	23 },
+  { "canMMode",	27 },
+  { "auto",	24 },
+  { "tele",	25 },
+  { "endgame",	26 },
+  { "tether",	28 },
+  { "log",	29 },
+};
+
+#define SETTINGS (int)(sizeof(settings)/sizeof(settings[0]))
+
+static int fd;
+static volatile sig_atomic_t stop = 0;
+
+static void interrupted(int sig)
+{
+  (void) sig;
+  stop = 1;
+}
+
+static unsigned char crc8(unsigned char crc, const unsigned char *data, int size)
+{
+  for (; size > 0; size--, data++){
+    crc ^= *data;
+    for (int i = 0; i < 8; i++){
+      crc = (crc & 0x80)? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+static void sendFrame(int cmd, const unsigned char *payload, int len)
+{
+  unsigned char frame[HL_MAX_PAYLOAD + 4];
+
+  frame[0] = HL_SYNC;
+  frame[1] = len;
+  frame[2] = cmd;
+  memcpy(frame + 3, payload, len);
+  frame[3 + len] = crc8(0, frame + 1, len + 2);
+
+  if (write(fd, frame, len + 4) != len + 4){
+    perror("write");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/*
+ * readByte() - the next byte from the port, or -1 after waiting ms for it.
+ */
+static int readByte(int ms)
+{
+  fd_set fds;
+  struct timeval tv;
+  unsigned char c;
+
+  FD_ZERO(&fds);
+  FD_SET(fd, &fds);
+  tv.tv_sec = ms / 1000;
+  tv.tv_usec = (ms % 1000) * 1000;
+
+  if (select(fd + 1, &fds, NULL, NULL, &tv) <= 0){
+    return -1;
+  }
+  if (read(fd, &c, 1) != 1){
+    return -1;
+  }
+  return c;
+}
+
+/*
+ * readFrame() - the next good frame.  Anything that isn't a frame (console
+ *		 output) and frames with a bad crc are skipped.  Returns the
+ *		 cmd, or -1 on a timeout.
+ */
+static int readFrame(unsigned char *payload, int *len, int ms)
+{
+  unsigned char frame[HL_MAX_PAYLOAD + 2];
+  int c;
+
+  while ((c = readByte(ms)) >= 0){
+    if (c != HL_SYNC){
+      continue;
+    }
+    if ((c = readByte(ms)) < 0 || c > HL_MAX_PAYLOAD){
+      continue;
+    }
+    frame[0] = c;
+
+    int i;
+    for (i = 1; i < frame[0] + 2; i++){
+      if ((c = readByte(ms)) < 0){
+	break;
+      }
+      frame[i] = c;
+    }
+    if (i < frame[0] + 2 || (c = readByte(ms)) < 0 || c != crc8(0, frame, frame[0] + 2)){
+      continue;
+    }
+
+    memcpy(payload, frame + 2, frame[0]);
+    *len = frame[0];
+    return frame[1];
+  }
+  return -1;
+}
+
+/*
+ * command() - send a command and wait for its reply, trying again on a
+ *	       timeout.  State frames that come in meanwhile are dropped.
+ *	       Exits on a NAK.  Returns the reply payload size.
+ */
+static int command(int cmd, const unsigned char *args, int argLen, unsigned char *reply)
+{
+  for (int tries = 0; tries < TRIES; tries++){
+    int rcmd, len;
+
+    sendFrame(cmd, args, argLen);
+    while ((rcmd = readFrame(reply, &len, REPLY_WAIT)) >= 0){
+      if (rcmd == (cmd | HL_REPLY)){
+	return len;
+      }
+      if (rcmd == HL_NAK && len == 2 && reply[0] == cmd){
+	if (reply[1] == HL_NAK_RANGE){
+	  fprintf(stderr, "value out of range\n");
+	} else {
+	  fprintf(stderr, "command %02x refused (reason %d)\n", cmd, reply[1]);
+	}
+	exit(EXIT_FAILURE);
+      }
+    }
+  }
+
+  fprintf(stderr, "no reply from the ChapR\n");
+  exit(EXIT_FAILURE);
+}
+
+/*
+ * waitForChapR() - ping until loop() is running.  The pings sent while it
+ *		    was in setup() are all answered at once when it gets
+ *		    there, so those replies are read and dropped.
+ */
+static void waitForChapR()
+{
+  unsigned char reply[HL_MAX_PAYLOAD];
+  int len;
+
+  for (int waited = 0; waited < SETUP_WAIT; waited += REPLY_WAIT){
+    sendFrame(HL_PING, NULL, 0);
+    if (readFrame(reply, &len, REPLY_WAIT) == (HL_PING | HL_REPLY)){
+      while (readFrame(reply, &len, REPLY_WAIT) >= 0){
+	;
+      }
+      return;
+    }
+  }
+
+  fprintf(stderr, "no reply from the ChapR\n");
+  exit(EXIT_FAILURE);
+}
+
+static int recordSize()
+{
+  unsigned char reply[HL_MAX_PAYLOAD];
+
+  command(HL_PING, NULL, 0, reply);
+  if (reply[0] != HL_VERSION){
+    fprintf(stderr, "ChapR speaks host link version %d, not %d\n", reply[0], HL_VERSION);
+    exit(EXIT_FAILURE);
+  }
+  return reply[1];
+}
+
+static int findKey(const char *key)
+{
+  for (int i = 0; i < SETTINGS; i++){
+    if (strcasecmp(key, settings[i].key) == 0){
+      return i;
+    }
+  }
+  fprintf(stderr, "no such setting: %s\n", key);
+  exit(EXIT_FAILURE);
+}
+
+static void doPing()
+{
+  unsigned char reply[HL_MAX_PAYLOAD];
+
+  command(HL_PING, NULL, 0, reply);
+  printf("host link version %d, settings record %d bytes\n", reply[0], reply[1]);
+}
+
+static void doGet(const char *key)
+{
+  unsigned char args[2], reply[HL_MAX_PAYLOAD];
+  unsigned char record[256];
+  int size = recordSize();
+
+  for (int offset = 0; offset < size; offset += HL_MAX_PAYLOAD - 1){
+    args[0] = offset;
+    args[1] = (size - offset < HL_MAX_PAYLOAD - 1)? size - offset : HL_MAX_PAYLOAD - 1;
+    command(HL_GET, args, 2, reply);
+    memcpy(record + offset, reply + 1, args[1]);
+  }
+
+  for (int i = 0; i < SETTINGS; i++){
+    if (key != NULL && strcasecmp(key, settings[i].key) != 0){
+      continue;
+    }
+    if (settings[i].offset >= size){
+      continue;			/* older firmware - not in its record */
+    }
+    if (i == 0){
+      printf("%s=%.*s\n", settings[i].key, NAME_LENGTH - 1, (char *) record + settings[i].offset);
+    } else {
+      printf("%s=%d\n", settings[i].key, record[settings[i].offset]);
+    }
+  }
+}
+
+static void doSet(const char *key, const char *value)
+{
+  unsigned char args[HL_MAX_PAYLOAD], reply[HL_MAX_PAYLOAD];
+  int i = findKey(key);
+  int len;
+
+  args[0] = settings[i].offset;
+  if (i == 0){
+    if (strlen(value) >= NAME_LENGTH){
+      fprintf(stderr, "the name can only be %d characters\n", NAME_LENGTH - 1);
+      exit(EXIT_FAILURE);
+    }
+    memset(args + 1, 0, NAME_LENGTH - 1);
+    memcpy(args + 1, value, strlen(value));
+    len = NAME_LENGTH - 1;	/* the null at the end stays */
+  } else {
+    int num = atoi(value);
+    if (num < 0 || num > 255){
+      fprintf(stderr, "%s must be 0 to 255\n", key);
+      exit(EXIT_FAILURE);
+    }
+    args[1] = num;
+    len = 1;
+  }
+
+  command(HL_SET, args, len + 1, reply);
+  if (reply[1] != len){
+    fprintf(stderr, "only %d of %d bytes were set\n", reply[1], len);
+    exit(EXIT_FAILURE);
+  }
+  doGet(key);
+}
+
+static void doDump(int addr, int count)
+{
+  unsigned char args[3], reply[HL_MAX_PAYLOAD];
+
+  while (count > 0){
+    int n = (count < 16)? count : 16;
+
+    args[0] = addr & 0xff;
+    args[1] = addr >> 8;
+    args[2] = n;
+    command(HL_READ, args, 3, reply);
+
+    printf("%04x:", addr);
+    for (int i = 0; i < n; i++){
+      printf(" %02x", reply[2 + i]);
+    }
+    printf("\n");
+    addr += n;
+    count -= n;
+  }
+}
+
+static void doStream(int period)
+{
+  unsigned char args[2], p[HL_MAX_PAYLOAD];
+  int len;
+
+  args[0] = period & 0xff;
+  args[1] = period >> 8;
+  command(HL_STREAM, args, 2, p);
+  fprintf(stderr, "streaming every %d ms\n", p[0] | (p[1] << 8));
+
+  printf("seq,time,connected,low,loop_us,personality_us,battery_mv");
+  for (int g = 1; g <= 2; g++){
+    printf(",g%d_type,g%d_x1,g%d_y1,g%d_x2,g%d_y2,g%d_x3,g%d_y3,g%d_buttons,g%d_tophat",
+	   g, g, g, g, g, g, g, g, g);
+  }
+  printf("\n");
+
+  signal(SIGINT, interrupted);
+  signal(SIGTERM, interrupted);
+
+  while (!stop){
+    if (readFrame(p, &len, 5000) < 0){
+      if (stop){
+	break;
+      }
+      fprintf(stderr, "no state from the ChapR\n");
+      exit(EXIT_FAILURE);
+    }
+    if (len != HL_STATE_SIZE){
+      continue;
+    }
+
+    printf("%d,%lu,%d,%d,%d,%d,%d", p[0],
+	   p[1] | (p[2] << 8) | (p[3] << 16) | ((unsigned long) p[4] << 24),
+	   (p[5] & HL_STATE_CONNECTED) != 0, (p[5] & HL_STATE_LOW) != 0,
+	   p[6] | (p[7] << 8), p[8] | (p[9] << 8), p[10] | (p[11] << 8));
+    for (int g = 12; g < 32; g += 10){
+      printf(",%d,%d,%d,%d,%d,%d,%d,%d,%d", p[g],
+	     (signed char) p[g+1], (signed char) p[g+2], (signed char) p[g+3],
+	     (signed char) p[g+4], (signed char) p[g+5], (signed char) p[g+6],
+	     p[g+7] | (p[g+8] << 8), p[g+9]);
+    }
+    printf("\n");
+    fflush(stdout);
+  }
+
+  args[0] = args[1] = 0;
+  command(HL_STREAM, args, 2, p);
+}
+
+static void usage(const char *me)
+{
+  fprintf(stderr,
+	  "usage: %s [-d device] command [args]\n"
+	  "  ping | get [key] | set key value | dump addr count | stream [period] | rescan\n", me);
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+  const char *device = "/dev/ttyUSB0";
+  unsigned char reply[HL_MAX_PAYLOAD];
+  int opt;
+
+  while ((opt = getopt(argc, argv, "d:")) != -1){
+    switch (opt){
+    case 'd': device = optarg; break;
+    default:  usage(argv[0]);
+    }
+  }
+  if (optind >= argc){
+    usage(argv[0]);
+  }
+
+  fd = open(device, O_RDWR | O_NOCTTY);
+  if (fd < 0){
+    perror(device);
+    exit(EXIT_FAILURE);
+  }
+
+  // the same settings as chaprmon (LOCAL_SERIAL_BAUD in config.h) - HUPCL
+  // is left off so that DTR stays up on close and the next open doesn't
+  // reset the ChapR (see the top of the file)
+  struct termios t;
+  memset(&t, 0, sizeof(t));
+  t.c_iflag = IGNBRK | IGNPAR;
+  t.c_cflag = CS8 | CREAD | CLOCAL | B38400;
+  t.c_cflag &= ~HUPCL;
+  t.c_cc[VMIN] = 1;
+  tcsetattr(fd, TCSANOW, &t);
+
+  tcflush(fd, TCIFLUSH);
+  waitForChapR();
+
+  const char *cmd = argv[optind];
+  int args = argc - optind - 1;
+  char **arg = argv + optind + 1;
+
+  if (strcmp(cmd, "ping") == 0 && args == 0){
+    doPing();
+  } else if (strcmp(cmd, "get") == 0 && args <= 1){
+    doGet(args? arg[0] : NULL);
+  } else if (strcmp(cmd, "set") == 0 && args == 2){
+    doSet(arg[0], arg[1]);
+  } else if (strcmp(cmd, "dump") == 0 && args == 2){
+    doDump(strtol(arg[0], NULL, 0), strtol(arg[1], NULL, 0));
+  } else if (strcmp(cmd, "stream") == 0 && args <= 1){
+    doStream(args? atoi(arg[0]) : 50);
+  } else if (strcmp(cmd, "rescan") == 0 && args == 0){
+    command(HL_RESCAN, NULL, 0, reply);
+  } else {
+    usage(argv[0]);
+  }
+
+  close(fd);
+  exit(EXIT_SUCCESS);
+}
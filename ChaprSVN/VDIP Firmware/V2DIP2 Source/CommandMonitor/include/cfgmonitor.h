@@ -41,6 +41,12 @@
 #define CFGMONITOR_DATA_MODE
 #define CFGMONITOR_FIRMWARE_UPDATE
 
+// keep an interrupt IN transfer queued on each HID device and answer DRD
+// from the latest report rather than waiting up to 250ms for one
+#ifdef V2DAP_FIRMWARE
+#define CFGMONITOR_HID_POLL
+#endif
+
 // monitor display
 // use #undef to disable
 #define CFGMONITOR_SHOW_PROMPT
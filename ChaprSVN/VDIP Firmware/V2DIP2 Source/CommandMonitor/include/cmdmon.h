@@ -69,6 +69,7 @@ unsigned char cmd_qd();
 unsigned char cmd_sc();
 unsigned char cmd_dsd();
 unsigned char cmd_drd();
+unsigned char cmd_dra();
 unsigned char cmd_ssu();
 unsigned char cmd_sf();
 unsigned char cmd_qss();
@@ -21,6 +21,10 @@
 
 #define DEV_LIST_SIZE 16
 
+// HID devices polled in the background (CFGMONITOR_HID_POLL)
+#define HID_POLL_MAX	 4
+#define HID_REPORT_SIZE	 64
+
 typedef struct _usbDevList
 {
 	usbhost_device_handle_ex ifDev;
@@ -31,6 +35,7 @@ typedef struct _usbDevList
 extern unsigned char curDevice;
 extern usbDevList deviceList[DEV_LIST_SIZE];
 
+void hostInit(void);
 unsigned char hostConnected(VOS_HANDLE hUsbHost);
 unsigned char hostAddToDeviceList(VOS_HANDLE hUsbHost);
 unsigned char hostRemoveFromDeviceList(VOS_HANDLE hUsbHost);
@@ -40,6 +45,9 @@ unsigned char hostSetDeviceFtdi(unsigned char device);
 unsigned char hostSelectDevice(unsigned char device);
 unsigned char hostSuspend(VOS_HANDLE hUSB);
 unsigned char hostWake(VOS_HANDLE hUSB);
+unsigned char hostHidRead(unsigned char device, unsigned char *buf, unsigned char *len);
+unsigned char hostHidPolled(void);
+unsigned char hostHidReport(unsigned char slot, unsigned char *hdr, unsigned char *buf);
 
 #define hostHasFTDI		 0x01          // 00000001b
 #define hostHasPrnClass	 0x04          // 00000100b
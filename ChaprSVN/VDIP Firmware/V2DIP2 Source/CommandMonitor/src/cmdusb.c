@@ -428,11 +428,14 @@ unsigned char cmd_dsd()
 ** Comments: Uses current device (SC command).
 **  Maximum 64 bytes to be received in one operation.
 **  Size of received data, followed by data dumped to monitor.
+**  HID devices polled in the background return their latest report straight
+**  away, or no data if it has not changed since the last DRD.
 */
 unsigned char cmd_drd()
 {
 	usbhost_xfer_t xfer;
 	unsigned char i;
+	unsigned char hidLen;
 	vos_semaphore_t s;
 	usbhost_ep_handle_ex epHandle = 0;     // Handle to our endpoint.
 	usbhost_device_handle_ex ifDev;
@@ -457,7 +460,13 @@ unsigned char cmd_drd()
 		ifDev = deviceList[curDevice].ifDev;
 		hDev = deviceList[curDevice].host;
 
-		if (ifDev)
+		if (ifDev && (hostHidRead(curDevice, buf, &hidLen) == MON_SUCCESS))
+		{
+			xfer.len = hidLen;
+			pbuf = buf;
+			status = MON_SUCCESS;
+		}
+		else if (ifDev)
 		{
 			// Pipe In Endpoint
 			host_ioctl_cb.ioctl_code = VOS_IOCTL_USBHOST_DEVICE_GET_BULK_IN_ENDPOINT_HANDLE;
@@ -564,6 +573,66 @@ unsigned char cmd_drd()
 	return status;
 }
 
+/*
+** cmd_dra
+**
+** Read the latest report from every HID device polled in the background.
+**
+** Parameters: none
+** Returns: MON_SUCCESS
+** Comments: Does not change the current device (SC command) and never waits.
+**  Number of reports, followed by each report as the device number, the
+**  count of reports from that device so far, the size of the report and
+**  the report itself. The size is 0 if the device has not sent a report
+**  since the last DRA. A device removed while this is being sent has a
+**  device number of 0xff.
+**  Replaces an SC and DRD per device for the ChapR.
+*/
+unsigned char cmd_dra()
+{
+	unsigned char hdr[3];
+	unsigned char buf[HID_REPORT_SIZE];
+	unsigned char polled;
+	unsigned char count = 0;
+	unsigned char i;
+	char cr = 0x0d;
+
+	// no- parameters purge input until CR
+	monReadCr();
+
+	polled = hostHidPolled();
+
+	for (i = 0; i < HID_POLL_MAX; i++)
+	{
+		if (polled & (1 << i))
+		{
+			count++;
+		}
+	}
+
+	monAddNumberToConsole(&count, 1);
+	monWrite(&cr, 1);
+
+	for (i = 0; i < HID_POLL_MAX; i++)
+	{
+		if (polled & (1 << i))
+		{
+			if (hostHidReport(i, hdr, buf) != MON_SUCCESS)
+			{
+				// removed since hostHidPolled
+				hdr[0] = 0xff;
+				hdr[1] = 0;
+				hdr[2] = 0;
+			}
+
+			monWrite((char *) hdr, 3);
+			monWrite((char *) buf, hdr[2]);
+		}
+	}
+
+	return MON_SUCCESS;
+}
+
 /*
 ** cmd_ssu
 **
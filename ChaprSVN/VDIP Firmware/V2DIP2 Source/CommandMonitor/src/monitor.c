@@ -46,7 +46,7 @@ rom unsigned short maskCodePage[8] = {0x0000, 0x0000, 0xe3ff, 0x03ff, 0xffff, 0x
 #define MON_CMDDISKREQ(A)			(A | 0x0100)
 // macro for command short codes (SCS) that do not require a disk
 #define MON_CMDNORESTR(A)			(A)
-rom struct stCommand commands[81] =
+rom struct stCommand commands[82] =
 {
 	// Monitor Operations
 	{MON_COMMANDCODE(0,	  0,	0,	 0),	MON_CMDDISKREQ(0x00), cmd_cr  },
@@ -97,6 +97,7 @@ rom struct stCommand commands[81] =
 	{MON_COMMANDCODE(0,	  0,	'S', 'C'),	MON_CMDNORESTR(0x86), cmd_sc  },
 	{MON_COMMANDCODE(0,	  'D',	'S', 'D'),	MON_CMDNORESTR(0x83), cmd_dsd },
 	{MON_COMMANDCODE(0,	  'D',	'R', 'D'),	MON_CMDNORESTR(0x84), cmd_drd },
+	{MON_COMMANDCODE(0,	  'D',	'R', 'A'),	MON_CMDNORESTR(0x9B), cmd_dra },
 	{MON_COMMANDCODE(0,	  'S',	'S', 'U'),	MON_CMDNORESTR(0x9A), cmd_ssu },
 	{MON_COMMANDCODE(0,	  0,	'S', 'F'),	MON_CMDNORESTR(0x87), cmd_sf  },
 	{MON_COMMANDCODE(0,	  'Q',	'S', 'S'),	MON_CMDNORESTR(0x98), cmd_qss },
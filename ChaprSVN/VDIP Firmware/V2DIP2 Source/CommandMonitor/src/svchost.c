@@ -32,6 +32,277 @@ unsigned char curDevice;
 // table of handles to devices
 usbDevList deviceList[DEV_LIST_SIZE];
 
+#ifdef CFGMONITOR_HID_POLL
+#define HID_POLL_NONE 0xff
+
+// HID devices with an interrupt IN transfer kept queued by hostHidThread
+typedef struct _hidPoll
+{
+	unsigned char			 active;  // thread running
+	unsigned char			 device;  // deviceList index, HID_POLL_NONE once removed
+	VOS_HANDLE				 host;
+	usbhost_ep_handle_ex	 ep;
+	unsigned short			 maxSize;
+	unsigned char			 len;     // latest report
+	unsigned char			 fresh;   // not yet returned by hostHidRead
+	unsigned char			 count;   // reports so far (wraps)
+	unsigned char			 draCount; // count at the last DRA
+	unsigned char			 report[HID_REPORT_SIZE];
+} hidPoll;
+
+hidPoll hidPolls[HID_POLL_MAX];
+vos_mutex_t mHidPoll;
+
+/*
+** hostHidThread
+**
+** Keeps a transfer queued on the interrupt IN endpoint of a HID device and
+** stores each report that comes back.
+**
+** Parameters: poll: the device's entry in hidPolls
+** Returns: when the device is removed
+** Comments: VOS polls the endpoint at its bInterval while the transfer is
+**  queued, so there is always a report waiting for DRD.
+*/
+void hostHidThread(hidPoll *poll)
+{
+	usbhost_xfer_t xfer;
+	vos_semaphore_t s;
+	unsigned char buf[HID_REPORT_SIZE];
+	unsigned char status;
+
+	vos_init_semaphore(&s, 0);
+
+	while (poll->device != HID_POLL_NONE)
+	{
+		vos_memset(&xfer, 0, sizeof(usbhost_xfer_t));
+		xfer.buf = buf;
+		xfer.len = poll->maxSize;
+		xfer.ep = poll->ep;
+		xfer.s = &s;
+		xfer.cond_code = USBHOST_CC_NOTACCESSED;
+		xfer.flags = USBHOST_XFER_FLAG_ROUNDING;
+		status = vos_dev_read(poll->host, (unsigned char *) &xfer, sizeof(usbhost_xfer_t), NULL);
+
+		if (status == USBHOST_NOT_FOUND)
+		{
+			break;
+		}
+
+		if ((status != USBHOST_OK) || (xfer.cond_code != USBHOST_CC_NOERROR))
+		{
+			// a STALL or a bad packet, give the device a moment and try again
+			vos_delay_msecs(10);
+			continue;
+		}
+
+		if (xfer.len)
+		{
+			vos_lock_mutex(&mHidPoll);
+			vos_memcpy(poll->report, buf, xfer.len);
+			poll->len = xfer.len;
+			poll->fresh = 1;
+			poll->count++;
+			vos_unlock_mutex(&mHidPoll);
+		}
+	}
+
+	vos_lock_mutex(&mHidPoll);
+	poll->device = HID_POLL_NONE;
+	poll->active = 0;
+	vos_unlock_mutex(&mHidPoll);
+}
+
+/*
+** hostHidStart
+**
+** Starts a hostHidThread for a HID device just added to the device list.
+**
+** Parameters: device: deviceList index
+** Returns: void
+** Comments: Devices past HID_POLL_MAX, or without an interrupt IN endpoint,
+**  are read by DRD the old way.
+*/
+void hostHidStart(unsigned char device)
+{
+	usbhost_ioctl_cb_t host_ioctl_cb;
+	usbhost_ioctl_cb_ep_info_t epInfo;
+	usbhost_ep_handle_ex epHandle = 0;
+	hidPoll *poll;
+	unsigned char i;
+
+	for (i = 0; i < HID_POLL_MAX; i++)
+	{
+		if (hidPolls[i].active == 0)
+		{
+			break;
+		}
+	}
+
+	if (i == HID_POLL_MAX)
+	{
+		return;
+	}
+
+	poll = &hidPolls[i];
+
+	host_ioctl_cb.ioctl_code = VOS_IOCTL_USBHOST_DEVICE_GET_INT_IN_ENDPOINT_HANDLE;
+	host_ioctl_cb.handle.dif = deviceList[device].ifDev;
+	host_ioctl_cb.get = &epHandle;
+	vos_dev_ioctl(deviceList[device].host, &host_ioctl_cb);
+
+	if (!epHandle)
+	{
+		return;
+	}
+
+	host_ioctl_cb.ioctl_code = VOS_IOCTL_USBHOST_DEVICE_GET_ENDPOINT_INFO;
+	host_ioctl_cb.handle.ep = epHandle;
+	host_ioctl_cb.get = &epInfo;
+	vos_dev_ioctl(deviceList[device].host, &host_ioctl_cb);
+
+	poll->active = 1;
+	poll->device = device;
+	poll->host = deviceList[device].host;
+	poll->ep = epHandle;
+	poll->maxSize = epInfo.max_size;
+	if (poll->maxSize > HID_REPORT_SIZE)
+	{
+		poll->maxSize = HID_REPORT_SIZE;
+	}
+	poll->len = 0;
+	poll->fresh = 0;
+	poll->count = 0;
+	poll->draCount = 0;
+
+	vos_create_thread_ex(24, 400, hostHidThread, "HID poll", sizeof(hidPoll *), poll);
+}
+#endif // CFGMONITOR_HID_POLL
+
+void hostInit(void)
+{
+#ifdef CFGMONITOR_HID_POLL
+	vos_memset(hidPolls, 0, sizeof(hidPolls));
+	vos_init_mutex(&mHidPoll, 0);
+#endif // CFGMONITOR_HID_POLL
+}
+
+/*
+** hostHidRead
+**
+** Gets the latest report from a HID device polled in the background.
+**
+** Parameters: device: deviceList index
+**  buf: HID_REPORT_SIZE bytes for the report
+**  len: set to the size of the report, 0 if it has already been read
+** Returns: MON_SUCCESS, MON_ERROR_CMD_FAILED if the device is not polled
+** Comments: Never waits for the device.
+*/
+unsigned char hostHidRead(unsigned char device, unsigned char *buf, unsigned char *len)
+{
+	unsigned char status = MON_ERROR_CMD_FAILED;
+#ifdef CFGMONITOR_HID_POLL
+	unsigned char i;
+
+	vos_lock_mutex(&mHidPoll);
+
+	for (i = 0; i < HID_POLL_MAX; i++)
+	{
+		if (hidPolls[i].active && (hidPolls[i].device == device))
+		{
+			*len = 0;
+
+			if (hidPolls[i].fresh)
+			{
+				vos_memcpy(buf, hidPolls[i].report, hidPolls[i].len);
+				*len = hidPolls[i].len;
+				hidPolls[i].fresh = 0;
+			}
+
+			status = MON_SUCCESS;
+			break;
+		}
+	}
+
+	vos_unlock_mutex(&mHidPoll);
+#endif // CFGMONITOR_HID_POLL
+
+	return status;
+}
+
+/*
+** hostHidPolled
+**
+** Finds the HID devices polled in the background.
+**
+** Parameters: none
+** Returns: bitmap of the hostHidReport slots with a device
+** Comments:
+*/
+unsigned char hostHidPolled(void)
+{
+	unsigned char mask = 0;
+#ifdef CFGMONITOR_HID_POLL
+	unsigned char i;
+
+	vos_lock_mutex(&mHidPoll);
+
+	for (i = 0; i < HID_POLL_MAX; i++)
+	{
+		if (hidPolls[i].active && (hidPolls[i].device != HID_POLL_NONE))
+		{
+			mask |= (1 << i);
+		}
+	}
+
+	vos_unlock_mutex(&mHidPoll);
+#endif // CFGMONITOR_HID_POLL
+
+	return mask;
+}
+
+/*
+** hostHidReport
+**
+** Gets the latest report in a slot for DRA.
+**
+** Parameters: slot: 0 to HID_POLL_MAX - 1
+**  hdr: set to the deviceList index, the report count and the report size
+**  buf: HID_REPORT_SIZE bytes for the report
+** Returns: MON_SUCCESS, MON_ERROR_CMD_FAILED if the slot has no device
+** Comments: The size is 0 if no report has come in since the last DRA.
+**  Independent of hostHidRead, so DRD and DRA can both be used.
+*/
+unsigned char hostHidReport(unsigned char slot, unsigned char *hdr, unsigned char *buf)
+{
+	unsigned char status = MON_ERROR_CMD_FAILED;
+#ifdef CFGMONITOR_HID_POLL
+	hidPoll *poll = &hidPolls[slot];
+
+	vos_lock_mutex(&mHidPoll);
+
+	if (poll->active && (poll->device != HID_POLL_NONE))
+	{
+		hdr[0] = poll->device;
+		hdr[1] = poll->count;
+		hdr[2] = 0;
+
+		if (poll->count != poll->draCount)
+		{
+			vos_memcpy(buf, poll->report, poll->len);
+			hdr[2] = poll->len;
+			poll->draCount = poll->count;
+		}
+
+		status = MON_SUCCESS;
+	}
+
+	vos_unlock_mutex(&mHidPoll);
+#endif // CFGMONITOR_HID_POLL
+
+	return status;
+}
+
 unsigned char hostConnected(VOS_HANDLE hUsbHost)
 {
 	usbhost_ioctl_cb_t usbhost_iocb;
@@ -85,6 +356,12 @@ unsigned char hostAddToDeviceList(VOS_HANDLE hUsbHost)
 					deviceList[i].host = hUsbHost;
 					deviceList[i].type = hostGetDevType(hUsbHost, ifDev);
 
+#ifdef CFGMONITOR_HID_POLL
+					if (deviceList[i].type == hostHasHIDClass)
+					{
+						hostHidStart(i);
+					}
+#endif
 					// move the currently selected device to the first inserted device
 #ifdef CFGMONITOR_SC_SET_FOR_INSERTED_DEVICES
 					if (curSet == 0)
@@ -114,6 +391,26 @@ unsigned char hostRemoveFromDeviceList(VOS_HANDLE hUsbHost)
 	// go throught device list and remove all devices that are on this usb host
 	// might be able to do an IOCTL on the deivce handle and see if it returns an error?
 	unsigned char i;
+#ifdef CFGMONITOR_HID_POLL
+	usbhost_ioctl_cb_t hc_iocb;
+
+	// stop polling the HID devices on this host, clearing the queued
+	// transfer wakes the thread up to notice
+	for (i = 0; i < HID_POLL_MAX; i++)
+	{
+		if (hidPolls[i].active && (hidPolls[i].host == hUsbHost))
+		{
+			vos_lock_mutex(&mHidPoll);
+			hidPolls[i].device = HID_POLL_NONE;
+			hidPolls[i].fresh = 0;
+			vos_unlock_mutex(&mHidPoll);
+
+			hc_iocb.ioctl_code = VOS_IOCTL_USBHOST_DEVICE_CLEAR_ENDPOINT_TRANSFER;
+			hc_iocb.handle.ep = hidPolls[i].ep;
+			vos_dev_ioctl(hUsbHost, &hc_iocb);
+		}
+	}
+#endif
 
 	for (i = 0; i < DEV_LIST_SIZE; i++)
 	{
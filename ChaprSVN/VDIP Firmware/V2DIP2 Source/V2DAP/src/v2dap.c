@@ -97,7 +97,8 @@ void main(void)
 	// initialise USB Host device driver
 	usb_ctx.if_count = 16;
 	usb_ctx.ep_count = 32;
-	usb_ctx.xfer_count = 2;
+	// plus one always queued on each HID device polled in the background
+	usb_ctx.xfer_count = 2 + HID_POLL_MAX;
 	usb_ctx.iso_xfer_count = 1;
 	usbhost_init(VOS_DEV_USB1, VOS_DEV_USB2, &usb_ctx);
 
@@ -340,6 +341,8 @@ void main(void)
 		vos_iomux_define_input(30, IOMUX_IN_GPIO_PORT_B_1);
 	}
 
+	hostInit();
+
 	// create threads for firmware application
 	tcbMonitor = vos_create_thread_ex(20, SIZEOF_FIRMWARE_TASK_MEMORY, firmware, "Application", 0);
 